@@ -0,0 +1,7 @@
+#!/bin/sh
+
+mkdir -p ../../build
+cd ../../build
+
+# Compile 64-bit
+gcc -std=gnu11 -fgnu89-inline -O0 -g ../corsac/code/linux_corsac.c -o corsac -DCORSAC_SLOW=1 -pthread
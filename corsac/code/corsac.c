@@ -8,713 +8,1328 @@
 
 #include "corsac.h"
 
-internal uint64
-StringToNumber(char *Start, uint32 Lenght)
+inline memory_index
+AlignPow2(memory_index Value, memory_index Alignment)
 {
-    uint64 Result = 0;
+    memory_index Result = (Value + Alignment - 1) & ~(Alignment - 1);
+    return Result;
+}
 
-    if(Lenght >= 3 && Start[0] == '0' && Start[1] == 'x')
+internal void
+ZeroSize(void *Memory, memory_index Size)
+{
+    uint8 *Byte = (uint8 *)Memory;
+    while(Size--)
+    {
+        *Byte++ = 0;
+    }
+}
+
+inline void *
+PushSize_(memory_arena *Arena, memory_index Size, memory_index Alignment)
+{
+    if(!Arena->Memory)
     {
-        Start += 2;
-        Lenght -= 2;
+        // NOTE(felipe): Arenas are reserved lazily on the first push, so a
+        // zero-initialized memory_arena is ready to use.
+        Arena->ReservedSize = ARENA_RESERVE_SIZE;
+        Arena->Memory = (uint8 *)PlatformReserveMemory(Arena->ReservedSize);
+        if(!Arena->Memory)
+        {
+            Error("out of memory");
+        }
+    }
+    
+    memory_index Start = AlignPow2(Arena->Used, Alignment);
+    memory_index End = Start + Size;
+    
+    if(End > Arena->CommittedSize)
+    {
+        if(End > Arena->ReservedSize)
+        {
+            Error("out of memory");
+        }
         
-        while(Lenght--)
+        memory_index CommitEnd = AlignPow2(End, ARENA_COMMIT_SIZE);
+        if(CommitEnd > Arena->ReservedSize)
         {
-            Result *= 16;
-            
-            if(*Start >= '0' &&
-               *Start <= '9')
-            {
-                Result += *Start - '0';
-            }
-            else if(*Start >= 'a' &&
-                    *Start <= 'f')
+            CommitEnd = Arena->ReservedSize;
+        }
+        
+        if(!PlatformCommitMemory(Arena->Memory + Arena->CommittedSize, CommitEnd - Arena->CommittedSize))
+        {
+            Error("out of memory");
+        }
+        
+        Arena->CommittedSize = CommitEnd;
+        ++Arena->CommitCount;
+    }
+    
+    void *Result = Arena->Memory + Start;
+    Arena->Used = End;
+    
+    return Result;
+}
+
+internal void
+ReleaseArena(memory_arena *Arena)
+{
+    Assert(Arena->TemporaryCount == 0);
+    
+    if(Arena->Memory)
+    {
+        PlatformReleaseMemory(Arena->Memory, Arena->ReservedSize);
+    }
+    
+    memory_arena Empty = {0};
+    *Arena = Empty;
+}
+
+internal temporary_memory
+BeginTemporaryMemory(memory_arena *Arena)
+{
+    temporary_memory Result;
+    
+    Result.Arena = Arena;
+    Result.Used = Arena->Used;
+    
+    ++Arena->TemporaryCount;
+    
+    return Result;
+}
+
+internal void
+EndTemporaryMemory(temporary_memory Temporary)
+{
+    memory_arena *Arena = Temporary.Arena;
+    
+    Assert(Arena->Used >= Temporary.Used);
+    Assert(Arena->TemporaryCount > 0);
+    
+    // NOTE(felipe): Keep the promise that pushed memory is always zeroed.
+    ZeroSize(Arena->Memory + Temporary.Used, Arena->Used - Temporary.Used);
+    
+    Arena->Used = Temporary.Used;
+    --Arena->TemporaryCount;
+}
+
+internal void
+KeepTemporaryMemory(temporary_memory Temporary)
+{
+    // NOTE(felipe): Ends the temporary memory but keeps what was pushed.
+    memory_arena *Arena = Temporary.Arena;
+    
+    Assert(Arena->Used >= Temporary.Used);
+    Assert(Arena->TemporaryCount > 0);
+    
+    --Arena->TemporaryCount;
+}
+
+internal char *
+StringDuplicate(memory_arena *Arena, char *String, uint32 Length)
+{
+    // NOTE(felipe): Null termination comes from the zeroed arena memory.
+    char *Result = (char *)PushSize(Arena, Length + 1);
+    MemCopy(Result, String, Length);
+    
+    return Result;
+}
+
+typedef struct file_slot
+{
+    uint32 Hash;
+    char *Path;
+    loaded_file *File;
+} file_slot;
+
+#define MIN_FILE_SLOT_COUNT 64
+
+// NOTE(felipe): Loaded files are pushed one after the other on their own
+// arena, so they form an array sorted by BaseLocation.
+typedef struct file_table
+{
+    memory_arena Arena;
+    memory_arena LineArena;
+    
+    uint32 Count;
+    loaded_file *Files;
+    
+    source_location NextLocation;
+    
+    // NOTE(felipe): Most lookups land in the same file as the one before.
+    loaded_file *LastFile;
+    
+    // NOTE(felipe): Open addressing hash table of the files loaded through
+    // LoadCachedFile, keyed by canonical path. Paths live on PathArena.
+    memory_arena PathArena;
+    uint32 CachedCount;
+    uint32 SlotCount;
+    file_slot *Slots;
+} file_table;
+
+// TODO(felipe): Remove globals.
+global_variable file_table GlobalFiles;
+
+internal loaded_file *
+AddFile(loaded_file File)
+{
+    // NOTE(felipe): File.Memory holds File.Size bytes and the terminator
+    // past them.
+    file_table *Table = &GlobalFiles;
+    
+    if(File.Size >= (uint64)(0xFFFFFFFF - Table->NextLocation))
+    {
+        Error("source locations exhausted loading: %s", File.Filename);
+    }
+    
+    loaded_file *Result = PushStruct(&Table->Arena, loaded_file);
+    if(!Table->Files)
+    {
+        Table->Files = Result;
+    }
+    Assert(Result == Table->Files + Table->Count);
+    
+    *Result = File;
+    Result->BaseLocation = Table->NextLocation;
+    
+    Table->NextLocation += (uint32)File.Size + 1;
+    ++Table->Count;
+    
+    return Result;
+}
+
+internal loaded_file *
+LoadFile(char *Filename)
+{
+    loaded_file *Result = 0;
+    
+    loaded_file File = PlatformReadEntireFile(Filename);
+    if(File.Memory)
+    {
+        Result = AddFile(File);
+    }
+    
+    return Result;
+}
+
+internal loaded_file *
+GetFileForLocation(source_location Location)
+{
+    file_table *Table = &GlobalFiles;
+    
+    loaded_file *Result = Table->LastFile;
+    if(!Result ||
+       (Location < Result->BaseLocation) ||
+       (Location > Result->BaseLocation + Result->Size))
+    {
+        Assert(Table->Count);
+        
+        // NOTE(felipe): Last file that starts at or before Location.
+        uint32 Low = 0;
+        uint32 High = Table->Count;
+        while(High - Low > 1)
+        {
+            uint32 Middle = Low + (High - Low) / 2;
+            if(Table->Files[Middle].BaseLocation <= Location)
             {
-                Result += *Start - 'a' + 10;
+                Low = Middle;
             }
             else
             {
-                Error("not a valid number");
+                High = Middle;
             }
-            
-            ++Start;
         }
+        
+        Result = Table->Files + Low;
+        Table->LastFile = Result;
     }
-    else
+    
+    Assert(Location <= Result->BaseLocation + Result->Size);
+    
+    return Result;
+}
+
+internal char *
+GetSourcePointer(source_location Location)
+{
+    loaded_file *File = GetFileForLocation(Location);
+    char *Result = (char *)File->Memory + (Location - File->BaseLocation);
+    
+    return Result;
+}
+
+// TODO(felipe): Remove globals.
+global_variable atom_table GlobalAtoms;
+
+// NOTE(felipe): FNV-1a, one byte at a time so that the lexer can hash an
+// identifier while it scans it.
+#define ATOM_HASH_SEED 2166136261u
+#define AtomHashStep(Hash, Byte) (((Hash) ^ (uint8)(Byte))*16777619u)
+
+inline uint32
+HashString(char *String, uint32 Length)
+{
+    uint32 Result = ATOM_HASH_SEED;
+    for(uint32 Index = 0;
+        Index < Length;
+        ++Index)
     {
-        while(Lenght--)
-        {
-            Result *= 10;
-            Result += *Start - '0';
-            
-            ++Start;
-        }
+        Result = AtomHashStep(Result, String[Index]);
     }
     
     return Result;
 }
 
-internal token *
-Tokenize(loaded_file *File)
+internal void
+GrowAtomSlots(atom_table *Table, uint32 SlotCount)
 {
-    token Head = {0};
-    token *Current = &Head;
+    // NOTE(felipe): The old slots are left behind in the arena, they take
+    // less than the strings.
+    atom *Slots = PushArray(&Table->Arena, SlotCount, atom);
+    uint32 Mask = SlotCount - 1;
+    
+    for(atom Atom = 1;
+        Atom <= Table->Count;
+        ++Atom)
+    {
+        uint32 Slot = Table->Entries[Atom].Hash & Mask;
+        while(Slots[Slot])
+        {
+            Slot = (Slot + 1) & Mask;
+        }
+        
+        Slots[Slot] = Atom;
+    }
+    
+    Table->Slots = Slots;
+    Table->SlotCount = SlotCount;
+}
 
-    bool32 AtBeginningOfLine = true;
+internal atom
+InternHashedAtom(char *String, uint32 Length, uint32 Hash)
+{
+    atom_table *Table = &GlobalAtoms;
+    
+    if(!Table->Slots)
+    {
+        GrowAtomSlots(Table, MIN_ATOM_SLOT_COUNT);
+    }
     
-    char *Iterator = File->Memory;
+    uint32 Mask = Table->SlotCount - 1;
+    uint32 Slot = Hash & Mask;
+    
+    atom Result = 0;
+    for(;;)
+    {
+        atom Atom = Table->Slots[Slot];
+        if(!Atom)
+        {
+            break;
+        }
+        
+        atom_entry *Entry = Table->Entries + Atom;
+        if(Entry->Hash == Hash && Entry->Length == Length &&
+           !StringCompare(Entry->String, String, Length))
+        {
+            Result = Atom;
+            break;
+        }
+        
+        Slot = (Slot + 1) & Mask;
+    }
     
-    Assert(Iterator);
-    while(*Iterator)
+    if(!Result)
     {
-        // NOTE(felipe): Skip space and new lines.
-        while(*Iterator &&
-              (*Iterator == ' ' || *Iterator == '\t'|| *Iterator == '\n' || *Iterator == '\r'))
+        // NOTE(felipe): Entry 0 is never used.
+        if(Table->Count + 1 >= Table->EntryCapacity)
         {
-            if(*Iterator == '\n')
+            uint32 Capacity = Table->EntryCapacity ? 2*Table->EntryCapacity : MIN_ATOM_SLOT_COUNT/2;
+            atom_entry *Entries = PushArray(&Table->Arena, Capacity, atom_entry);
+            if(Table->Count)
             {
-                AtBeginningOfLine = true;
+                MemCopy(Entries, Table->Entries, (Table->Count + 1)*sizeof(atom_entry));
             }
             
-            ++Iterator;
+            Table->Entries = Entries;
+            Table->EntryCapacity = Capacity;
         }
         
-        if(*Iterator)
+        Result = ++Table->Count;
+        
+        atom_entry *Entry = Table->Entries + Result;
+        Entry->String = StringDuplicate(&Table->Arena, String, Length);
+        Entry->Length = Length;
+        Entry->Hash = Hash;
+        
+        Table->Slots[Slot] = Result;
+        
+        // NOTE(felipe): Keep the table at most half full.
+        if(2*Table->Count > Table->SlotCount)
         {
-            // NOTE(felipe): Ignore comments.
-            if(*Iterator == '/' && *(Iterator + 1) == '/')
-            {
-                ++Iterator;
-                while(*Iterator && *Iterator != '\n')
-                {
-                    ++Iterator;
-                }
-            }
-            else if(*Iterator == '/' && *(Iterator + 1) == '*')
-            {
-                bool32 FoundCommentEnd = false;
-                while(!FoundCommentEnd)
-                {
-                    ++Iterator;
-                        
-                    if(*Iterator && *(Iterator + 1))
-                    {
-                        if(*Iterator == '*' && *(Iterator + 1) == '/')
-                        {
-                            Iterator += 2;
-                                
-                            FoundCommentEnd = true;
-                        }
-                    }
-                    else
-                    {
-                        Error("unclosed comment");
-                    }
-                }
-            }
-            else if(*Iterator == '\\')
+            GrowAtomSlots(Table, 2*Table->SlotCount);
+        }
+    }
+    
+    return Result;
+}
+
+inline atom
+InternAtom(char *String, uint32 Length)
+{
+    atom Result = InternHashedAtom(String, Length, HashString(String, Length));
+    return Result;
+}
+
+inline char *
+GetAtomString(atom Atom)
+{
+    Assert(Atom && Atom <= GlobalAtoms.Count);
+    char *Result = GlobalAtoms.Entries[Atom].String;
+    
+    return Result;
+}
+
+inline uint32
+GetAtomLength(atom Atom)
+{
+    Assert(Atom && Atom <= GlobalAtoms.Count);
+    uint32 Result = GlobalAtoms.Entries[Atom].Length;
+    
+    return Result;
+}
+
+inline uint32
+HashAtom(atom Name)
+{
+    // NOTE(felipe): Atoms are handed out in order, multiplying by an odd
+    // constant keeps consecutive ones in distinct slots.
+    uint32 Result = Name*2654435769u;
+    return Result;
+}
+
+inline void *
+FindAtomSlotIn(uint8 *Slots, uint32 SlotCount, uint32 SlotSize, atom Name)
+{
+    // NOTE(felipe): Returns the slot of Name, or the empty slot where it
+    // would go.
+    uint32 Mask = SlotCount - 1;
+    uint32 Slot = HashAtom(Name) & Mask;
+    
+    atom SlotName;
+    while((SlotName = *(atom *)(Slots + Slot*SlotSize)) && (SlotName != Name))
+    {
+        Slot = (Slot + 1) & Mask;
+    }
+    
+    void *Result = Slots + Slot*SlotSize;
+    return Result;
+}
+
+inline void *
+FindAtomSlot(atom_map *Map, atom Name)
+{
+    void *Result = FindAtomSlotIn(Map->Slots, Map->SlotCount, Map->SlotSize, Name);
+    return Result;
+}
+
+internal void
+GrowAtomMap(memory_arena *Arena, atom_map *Map, uint32 SlotCount)
+{
+    uint8 *Slots = (uint8 *)PushSize_(Arena, (memory_index)SlotCount*Map->SlotSize, AlignOf(void *));
+    
+    for(uint32 Slot = 0;
+        Slot < Map->SlotCount;
+        ++Slot)
+    {
+        uint8 *Source = Map->Slots + Slot*Map->SlotSize;
+        atom Name = *(atom *)Source;
+        if(Name)
+        {
+            MemCopy(FindAtomSlotIn(Slots, SlotCount, Map->SlotSize, Name), Source, Map->SlotSize);
+        }
+    }
+    
+    Map->Slots = Slots;
+    Map->SlotCount = SlotCount;
+}
+
+internal void
+BeginAtomMap(memory_arena *Arena, atom_map *Map, uint32 SlotSize, uint32 SlotCount)
+{
+    atom_map Empty = {0};
+    *Map = Empty;
+    
+    Map->SlotSize = SlotSize;
+    GrowAtomMap(Arena, Map, SlotCount);
+}
+
+internal void *
+AddAtomSlot(memory_arena *Arena, atom_map *Map, atom Name)
+{
+    // NOTE(felipe): Returns the slot of Name, giving Name the empty slot if
+    // it had none. Slots move when the table grows, a pointer to one is good
+    // until the next add.
+    void *Result = FindAtomSlot(Map, Name);
+    if(!*(atom *)Result)
+    {
+        // NOTE(felipe): Keep the table at most half full.
+        if(2*(Map->UsedSlotCount + 1) > Map->SlotCount)
+        {
+            GrowAtomMap(Arena, Map, 2*Map->SlotCount);
+            Result = FindAtomSlot(Map, Name);
+        }
+        
+        *(atom *)Result = Name;
+        ++Map->UsedSlotCount;
+    }
+    
+    return Result;
+}
+
+internal void
+GrowFileSlots(file_table *Table, uint32 SlotCount)
+{
+    file_slot *Slots = PushArray(&Table->PathArena, SlotCount, file_slot);
+    uint32 Mask = SlotCount - 1;
+    
+    for(uint32 Index = 0;
+        Index < Table->SlotCount;
+        ++Index)
+    {
+        file_slot *Old = Table->Slots + Index;
+        if(Old->File)
+        {
+            uint32 Slot = Old->Hash & Mask;
+            while(Slots[Slot].File)
             {
-                // TODO(felipe): If escape caracter is encountered ignore newline.
-                ++Iterator;
-            
-                bool32 ValidSequence = false;
-                if(*Iterator == '\r')
-                {
-                    ValidSequence = true;
-                    ++Iterator;
-                }
-                if(*Iterator == '\n')
-                {
-                    ValidSequence = true;
-                    ++Iterator;
-                }
-                
-                if(!ValidSequence)
-                {
-                    Error("illegal escape sequence");
-                }
+                Slot = (Slot + 1) & Mask;
             }
-            else
-            {
-                // TODO(felipe): More sane memory management!
-                // NOTE(felipe): Allocate new token.
-                Current->Next = (token *)calloc(sizeof(token), 1);
-                Current = Current->Next;
-                
-                Current->SourceFile = File;
-                Current->Location = Iterator;
-                Current->AtBeginningOfLine = AtBeginningOfLine;
-                AtBeginningOfLine = false;
-                
-                if((*Iterator >= 'a' && *Iterator <= 'z') ||
-                   (*Iterator >= 'A' && *Iterator <= 'Z') ||
-                   *Iterator == '_')
-                {
-                    // NOTE(felipe): Token is an Identifier or Keyword.
-                    Current->TokenType = TokenType_Identifier;
-                
-                    while((*Iterator >= 'a' && *Iterator <= 'z') ||
-                          (*Iterator >= 'A' && *Iterator <= 'Z') ||
-                          (*Iterator >= '0' && *Iterator <= '9') ||
-                          *Iterator == '_')
-                    {
-                        ++Iterator;
-                    }
-                }
-                else if(*Iterator >= '0' && *Iterator <= '9')
-                {
-                    // NOTE(felipe): Token is a number.
-                    Current->TokenType = TokenType_Number;
-                    
-                    while((*Iterator >= '0' && *Iterator <= '9') ||
-                          (*Iterator >= 'a' && *Iterator <= 'f') ||
-                          *Iterator == 'x')
-                    {
-                        ++Iterator;
-                    }
-                    
-                    Current->NumericalValue = StringToNumber(Current->Location,
-                                                             SafeTruncateUInt64(Iterator - Current->Location));
-                }
-                else if(*Iterator == '\'')
-                {
-                    Current->TokenType = TokenType_Number;
-                    
-                    // TODO(felipe): Multi-character constant? (C99 spec. 6.4.4.4p10).
-                    
-                    char *Start = Iterator;
-                        
-                    ++Iterator;
-                    if(*Iterator == '\\')
-                    {
-                        ++Iterator;
-                        switch(*Iterator)
-                        {
-                            case 'r': { Current->NumericalValue = '\r'; } break;
-                            case 'n': { Current->NumericalValue = '\n'; } break;
-                            case 't': { Current->NumericalValue = '\t'; } break;
-                                    
-                            case '\'': { Current->NumericalValue = '\''; } break;
-                            case '\"': { Current->NumericalValue = '\"'; } break;
-                            
-                            case '\\': { Current->NumericalValue = '\\'; } break;
-                            
-                            case '0': { Current->NumericalValue = 0; } break;
-                            
-                            default:
-                            {
-                                Error("unknown escape sequence");
-                            } break;
-                        }
-                    
-                        Iterator += 2;
-                    }
-                    else
-                    {
-                        if(*(Iterator + 1) == '\'')
-                        {
-                            Current->Location = Iterator + 1;
-                            Current->Length = 1;
-                        
-                            Iterator += 2;
-                        }
-                        else
-                        {
-                            Error("invalid constant char");
-                        }
-                    }
-                }
-                else
-                {
-                    Current->TokenType = TokenType_Punctuation;
-                    
-                    // NOTE(felipe): Some forms of punctuation are
-                    // more than just one character e.i. '=='.
-                    if(*Iterator == '=' &&
-                       (*(Iterator + 1) == '=' ||
-                        *(Iterator + 1) == '<' ||
-                        *(Iterator + 1) == '>'))
-                    {
-                        Iterator += 2;
-                    }
-                    else if(*Iterator == '!' &&
-                            *(Iterator + 1) == '=')
-                    {
-                        Iterator += 2;
-                    }    
-                    else
-                    {
-                        ++Iterator;
-                    }
-                }
             
-                Current->Length = SafeTruncateUInt64(Iterator - Current->Location);
-            }
+            Slots[Slot] = *Old;
         }
     }
     
-    char *Keywords[] =
-        {
-            "return",
-            "if",
-            "else",
-            "for",
-            "while",
-        };
+    Table->Slots = Slots;
+    Table->SlotCount = SlotCount;
+}
+
+internal file_slot *
+FindFileSlot(file_table *Table, char *Path)
+{
+    // NOTE(felipe): The slot of Path, or the empty slot it would go in.
+    if(!Table->Slots)
+    {
+        GrowFileSlots(Table, MIN_FILE_SLOT_COUNT);
+    }
     
-    for(token *Token = Head.Next;
-        Token;
-        Token = Token->Next)
-    {    
-        for(uint32 Index = 0;
-            Index < ArrayCount(Keywords);
-            ++Index)
+    uint32 Length = StringLength(Path);
+    uint32 Hash = HashString(Path, Length);
+    
+    uint32 Mask = Table->SlotCount - 1;
+    uint32 Slot = Hash & Mask;
+    
+    file_slot *Result = Table->Slots + Slot;
+    while(Result->File &&
+          !((Result->Hash == Hash) && !StringCompare(Result->Path, Path, Length + 1)))
+    {
+        Slot = (Slot + 1) & Mask;
+        Result = Table->Slots + Slot;
+    }
+    
+    return Result;
+}
+
+internal void
+CacheFile(file_table *Table, file_slot *Slot, char *Path, loaded_file *File)
+{
+    // NOTE(felipe): Slot is the empty slot FindFileSlot gave for Path.
+    uint32 Length = StringLength(Path);
+    
+    Slot->Hash = HashString(Path, Length);
+    Slot->Path = StringDuplicate(&Table->PathArena, Path, Length);
+    Slot->File = File;
+    
+    // NOTE(felipe): Keep the table at most half full.
+    if(2*++Table->CachedCount > Table->SlotCount)
+    {
+        GrowFileSlots(Table, 2*Table->SlotCount);
+    }
+}
+
+internal loaded_file *
+LoadCachedFile(char *Filename)
+{
+    // NOTE(felipe): A file is read only once, loading it again through any
+    // path that leads to it returns the same loaded_file.
+    file_table *Table = &GlobalFiles;
+    
+    loaded_file *Result = 0;
+    
+    char Path[MAX_PATH_LENGTH];
+    if(PlatformGetCanonicalPath(Filename, Path, sizeof(Path)))
+    {
+        file_slot *Slot = FindFileSlot(Table, Path);
+        Result = Slot->File;
+        
+        if(!Result)
         {
-            if(TokenIs(Token, Keywords[Index]))
+            // NOTE(felipe): The name the file was first loaded by is kept
+            // for diagnostics, it has to outlive whoever passed it.
+            char *Name = StringDuplicate(&Table->PathArena, Filename, StringLength(Filename));
+            
+            Result = LoadFile(Name);
+            if(Result)
             {
-                Token->TokenType = TokenType_Keyword;
+                CacheFile(Table, Slot, Path, Result);
             }
         }
     }
     
-    // NOTE(felipe): Last token is EOF.
-    Current->Next = (token *)calloc(sizeof(token), 1);
-    Current = Current->Next;
-    
-    Current->TokenType = TokenType_EOF;
-    Current->SourceFile = File;
-
-    return Head.Next;
+    return Result;
 }
 
-#if 0
-typedef struct string_list_element
+typedef struct directory_entry
 {
-    // NOTE(felipe): Size in bytes, including null char.
+    uint32 Hash;
     uint32 Length;
-    char *String;
+    char *Name;
+} directory_entry;
+
+#define MIN_DIRECTORY_SLOT_COUNT 16
+
+// NOTE(felipe): The names in one directory, an open addressing hash set
+// filled by listing the directory the first time something is searched for
+// in it. Prefix is the directory as it is put in front of a name, empty for
+// the working directory and ending in a separator otherwise.
+typedef struct directory_index
+{
+    char *Prefix;
+    uint32 PrefixLength;
+    uint32 Hash;
+    
+    uint32 EntryCount;
+    uint32 SlotCount;
+    directory_entry *Slots;
     
-    struct string_list_element *Next;
-} string_list_element;
+    struct directory_index *NextInHash;
+} directory_index;
 
-typedef struct string_list
+#define DIRECTORY_HASH_COUNT 256
+#define MAX_SEARCH_DIRECTORY_COUNT 256
+
+typedef struct directory_table
 {
-    uint32 Count;
+    memory_arena Arena;
+    directory_index *IndexHash[DIRECTORY_HASH_COUNT];
+    uint32 ListedCount;
     
-    string_list_element *First;
-    string_list_element *Last;
-} string_list;
+    // NOTE(felipe): Prefixes of the include search directories, the -I ones
+    // come before the -isystem ones.
+    uint32 SearchCount;
+    uint32 UserSearchCount;
+    char *Search[MAX_SEARCH_DIRECTORY_COUNT];
+} directory_table;
+
+// TODO(felipe): Remove globals.
+global_variable directory_table GlobalDirectories;
+
+inline bool32
+IsPathSeparator(char Character)
+{
+    bool32 Result = ((Character == '/') || (Character == '\\'));
+    return Result;
+}
+
+inline bool32
+IsAbsolutePath(char *Path)
+{
+    bool32 Result = (IsPathSeparator(Path[0]) ||
+                     (Path[0] && (Path[1] == ':') && IsPathSeparator(Path[2])));
+    return Result;
+}
 
 internal void
-PushString(string_list *List, char *String)
+AddSearchDirectory(char *Directory, bool32 System)
 {
-    string_list_element *ListElement = (string_list_element *)malloc(sizeof(string_list_element));
+    directory_table *Table = &GlobalDirectories;
+    if(Table->SearchCount == MAX_SEARCH_DIRECTORY_COUNT)
+    {
+        Error("too many include directories, at most %d", MAX_SEARCH_DIRECTORY_COUNT);
+    }
     
-    if(!List->First)
+    uint32 Length = StringLength(Directory);
+    char *Prefix = (char *)PushSize(&Table->Arena, Length + 3);
+    if(Length)
     {
-        List->First = ListElement;
-        List->Last = ListElement;
+        MemCopy(Prefix, Directory, Length);
     }
     else
     {
-        List->Last->Next = ListElement;
-        List->Last = ListElement;
+        Prefix[Length++] = '.';
     }
     
-    uint32 Length = StringLength(String);
-    char *NewString = StringDuplicate(String, Length);
+    if(!IsPathSeparator(Prefix[Length - 1]))
+    {
+        Prefix[Length++] = '/';
+    }
+    Prefix[Length] = 0;
     
-    ListElement->Length = Length;
-    ListElement->String = NewString;
-    ++List->Count;
+    uint32 Slot = Table->SearchCount++;
+    if(!System)
+    {
+        for(;
+            Slot > Table->UserSearchCount;
+            --Slot)
+        {
+            Table->Search[Slot] = Table->Search[Slot - 1];
+        }
+        ++Table->UserSearchCount;
+    }
+    Table->Search[Slot] = Prefix;
 }
 
 internal void
-PushStringN(string_list *List, char *String, uint32 Length)
+GrowDirectorySlots(directory_index *Index, uint32 SlotCount)
 {
-    string_list_element *ListElement = (string_list_element *)malloc(sizeof(string_list_element));
+    directory_entry *Slots = PushArray(&GlobalDirectories.Arena, SlotCount, directory_entry);
+    uint32 Mask = SlotCount - 1;
     
-    if(!List->First)
-    {
-        List->First = ListElement;
-        List->Last = ListElement;
-    }
-    else
+    for(uint32 Old = 0;
+        Old < Index->SlotCount;
+        ++Old)
     {
-        List->Last->Next = ListElement;
-        List->Last = ListElement;
+        directory_entry *Entry = Index->Slots + Old;
+        if(Entry->Name)
+        {
+            uint32 Slot = Entry->Hash & Mask;
+            while(Slots[Slot].Name)
+            {
+                Slot = (Slot + 1) & Mask;
+            }
+            
+            Slots[Slot] = *Entry;
+        }
     }
     
-    char *NewString = StringDuplicate(String, Length);
-    
-    ListElement->Length = Length;
-    ListElement->String = NewString;
-    ++List->Count;
+    Index->Slots = Slots;
+    Index->SlotCount = SlotCount;
 }
-#endif
 
-inline bool32
-TokenIsCharacter(token *Token, char Test)
+internal directory_entry *
+FindDirectorySlot(directory_index *Index, char *Name, uint32 Length, uint32 Hash)
 {
-    bool32 Result = Token->Length == 1 && *Token->Location == Test;
-
+    // NOTE(felipe): The slot of Name, or the empty slot it would go in.
+    uint32 Mask = Index->SlotCount - 1;
+    uint32 Slot = Hash & Mask;
+    
+    directory_entry *Result = Index->Slots + Slot;
+    while(Result->Name &&
+          !((Result->Hash == Hash) && (Result->Length == Length) && !StringCompare(Result->Name, Name, Length)))
+    {
+        Slot = (Slot + 1) & Mask;
+        Result = Index->Slots + Slot;
+    }
+    
     return Result;
 }
 
-inline bool32
-TokenIs(token *Token, char *Test)
+internal
+PLATFORM_DIRECTORY_ENTRY_CALLBACK(IndexDirectoryEntry)
 {
-    bool32 Result = false;
+    directory_index *Index = (directory_index *)Data;
+    
+    // NOTE(felipe): Keep the set at most half full.
+    if(2*(Index->EntryCount + 1) > Index->SlotCount)
+    {
+        GrowDirectorySlots(Index, 2*Index->SlotCount);
+    }
+    
+    uint32 Length = StringLength(Name);
+    uint32 Hash = HashString(Name, Length);
+    directory_entry *Entry = FindDirectorySlot(Index, Name, Length, Hash);
+    if(!Entry->Name)
+    {
+        Entry->Hash = Hash;
+        Entry->Length = Length;
+        Entry->Name = StringDuplicate(&GlobalDirectories.Arena, Name, Length);
+        ++Index->EntryCount;
+    }
+}
 
-    uint32 Length = StringLength(Test);
-    if(Token->Length == Length)
+internal directory_index *
+GetDirectoryIndex(char *Prefix, uint32 PrefixLength)
+{
+    // NOTE(felipe): The directory is listed only the first time its index is
+    // asked for, one that cannot be listed gets an empty index.
+    directory_table *Table = &GlobalDirectories;
+    
+    uint32 Hash = HashString(Prefix, PrefixLength);
+    directory_index **Bucket = Table->IndexHash + (Hash & (DIRECTORY_HASH_COUNT - 1));
+    
+    directory_index *Result = *Bucket;
+    while(Result &&
+          !((Result->Hash == Hash) && (Result->PrefixLength == PrefixLength) &&
+            !StringCompare(Result->Prefix, Prefix, PrefixLength)))
+    {
+        Result = Result->NextInHash;
+    }
+    
+    if(!Result)
     {
-        Result = true;
+        Result = PushStruct(&Table->Arena, directory_index);
+        Result->Prefix = StringDuplicate(&Table->Arena, Prefix, PrefixLength);
+        Result->PrefixLength = PrefixLength;
+        Result->Hash = Hash;
+        Result->NextInHash = *Bucket;
+        *Bucket = Result;
         
-        for(uint32 Index = 0;
-            Index < Length;
-            ++Index)
+        GrowDirectorySlots(Result, MIN_DIRECTORY_SLOT_COUNT);
+        
+        // NOTE(felipe): The separator at the end stays only for a root.
+        char Path[MAX_PATH_LENGTH];
+        uint32 Length = PrefixLength;
+        if(!Length)
+        {
+            Path[Length++] = '.';
+        }
+        else
         {
-            if(Token->Location[Index] != Test[Index])
+            MemCopy(Path, Prefix, Length);
+            if((Length > 1) && (Path[Length - 2] != ':'))
             {
-                Result = false;
-                break;
+                --Length;
             }
         }
+        Path[Length] = 0;
+        
+        PlatformListDirectory(Path, IndexDirectoryEntry, Result);
+        ++Table->ListedCount;
     }
     
     return Result;
 }
 
-internal char *
-StringFromToken(token *Token)
+internal bool32
+SearchDirectory(char *Prefix, char *Filename, char *Path)
 {
-    char *Result = StringDuplicate(Token->Location, Token->Length);
+    // NOTE(felipe): Joins Prefix and Filename in Path, then checks every
+    // component of Filename against the index of the directory it is in.
+    // Only directories that were never listed cost a system call.
+    uint32 PrefixLength = StringLength(Prefix);
+    uint32 FilenameLength = StringLength(Filename);
+    
+    bool32 Result = (PrefixLength + FilenameLength < MAX_PATH_LENGTH);
+    if(Result)
+    {
+        MemCopy(Path, Prefix, PrefixLength);
+        MemCopy(Path + PrefixLength, Filename, FilenameLength + 1);
+        
+        uint32 Start = PrefixLength;
+        while(Result && Path[Start])
+        {
+            uint32 End = Start;
+            while(Path[End] && !IsPathSeparator(Path[End]))
+            {
+                ++End;
+            }
+            
+            if(End > Start)
+            {
+                directory_index *Index = GetDirectoryIndex(Path, Start);
+                uint32 Length = End - Start;
+                Result = (FindDirectorySlot(Index, Path + Start, Length, HashString(Path + Start, Length))->Name != 0);
+            }
+            
+            Start = End + (Path[End] != 0);
+        }
+    }
     
     return Result;
 }
 
-internal char *
-StringFromTokens(token *Token, token *End)
+internal loaded_file *
+FindIncludeFile(char *Filename, loaded_file *Includer, bool32 Angled)
 {
-    // NOTE(felipe): Includes Token but not End.
-    char *Result = 0;
+    // NOTE(felipe): "" includes look in the directory of the including file
+    // first, then both kinds look in the -I directories and after them in
+    // the -isystem ones.
+    directory_table *Table = &GlobalDirectories;
     
-    uint32 Length = 0;
-    for(token *Test = Token;
-        Test != End;
-        Test = Test->Next)
+    loaded_file *Result = 0;
+    char Path[MAX_PATH_LENGTH];
+    
+    if(IsAbsolutePath(Filename))
     {
-        Length += Test->Length;
+        Result = LoadCachedFile(Filename);
     }
-    
-    Result = (char *)malloc(Length + 1);
-    
-    uint32 Index = 0;
-    for(token *Test = Token;
-        Test != End;
-        Test = Test->Next)
+    else
     {
-        for(uint32 J = 0;
-            J < Test->Length;
-            ++J)
+        if(!Angled && Includer)
         {
-            Result[J] = Test->Location[J];
+            char Prefix[MAX_PATH_LENGTH];
+            uint32 Length = StringLength(Includer->Filename);
+            while(Length && !IsPathSeparator(Includer->Filename[Length - 1]))
+            {
+                --Length;
+            }
+            
+            if(Length < sizeof(Prefix))
+            {
+                MemCopy(Prefix, Includer->Filename, Length);
+                Prefix[Length] = 0;
+                
+                if(SearchDirectory(Prefix, Filename, Path))
+                {
+                    Result = LoadCachedFile(Path);
+                }
+            }
         }
         
-        Index += Test->Length;
+        for(uint32 Index = 0;
+            !Result && (Index < Table->SearchCount);
+            ++Index)
+        {
+            if(SearchDirectory(Table->Search[Index], Filename, Path))
+            {
+                Result = LoadCachedFile(Path);
+            }
+        }
     }
-
-    Result[Index] = 0;
     
     return Result;
 }
 
-internal token *
-CopyToken(token *Token)
+#include "corsac_lexer.c"
+
+internal void
+BuildLineTable(loaded_file *File)
 {
-    token *T = (token *)malloc(sizeof(token));
+    // NOTE(felipe): Counts the lines first so that the table takes exactly
+    // what it needs. The scanner also stops at NUL bytes, which are skipped.
+    char *Memory = (char *)File->Memory;
+    char *End = Memory + File->Size;
+    
+    uint32 LineCount = 1;
+    for(char *At = GlobalScanner.FindNewline(Memory);
+        At < End;
+        At = GlobalScanner.FindNewline(At + 1))
+    {
+        if(*At == '\n')
+        {
+            ++LineCount;
+        }
+    }
     
-    *T = *Token;
-    T->Next = 0;
+    uint32 *LineStarts = PushArray(&GlobalFiles.LineArena, LineCount, uint32);
+    
+    uint32 Line = 0;
+    LineStarts[Line++] = 0;
+    for(char *At = GlobalScanner.FindNewline(Memory);
+        At < End;
+        At = GlobalScanner.FindNewline(At + 1))
+    {
+        if(*At == '\n')
+        {
+            LineStarts[Line++] = (uint32)(At + 1 - Memory);
+        }
+    }
+    Assert(Line == LineCount);
     
-    return T;
+    File->LineStarts = LineStarts;
+    File->LineCount = LineCount;
 }
 
-internal token *
-AppendToken(token *Token1, token *Token2)
+internal source_position
+GetSourcePosition(source_location Location)
 {
-    token *Result = 0;
+    source_position Result = {0};
     
-    if(Token1->TokenType == TokenType_EOF)
+    loaded_file *File = GetFileForLocation(Location);
+    if(!File->LineStarts)
     {
-        Result = Token2;
+        BuildLineTable(File);
     }
-    else
-    {    
-        token Head = {0};
-        token *Current = &Head;
     
-        for (;
-             Token1->TokenType != TokenType_EOF;
-             Token1 = Token1->Next)
+    // NOTE(felipe): Last line that starts at or before Offset.
+    uint32 Offset = Location - File->BaseLocation;
+    uint32 Low = 0;
+    uint32 High = File->LineCount;
+    while(High - Low > 1)
+    {
+        uint32 Middle = Low + (High - Low) / 2;
+        if(File->LineStarts[Middle] <= Offset)
+        {
+            Low = Middle;
+        }
+        else
         {
-            Current->Next = CopyToken(Token1);
-            Current = Current->Next;
+            High = Middle;
         }
+    }
     
-        Current->Next = Token2;
-        Result = Head.Next;
+    char *Memory = (char *)File->Memory;
+    uint32 LineEnd = (Low + 1 < File->LineCount) ? (File->LineStarts[Low + 1] - 1) : (uint32)File->Size;
+    if((LineEnd > File->LineStarts[Low]) && (Memory[LineEnd - 1] == '\r'))
+    {
+        --LineEnd;
     }
     
+    Result.File = File;
+    Result.Line = Low + 1;
+    Result.Column = Offset - File->LineStarts[Low] + 1;
+    Result.LineStart = Memory + File->LineStarts[Low];
+    Result.LineLength = LineEnd - File->LineStarts[Low];
+    
     return Result;
 }
 
-internal token *
-IncludeFile(token *Token, char *Path, token *IncludeToken)
+internal char *
+StringFromTokens(memory_arena *Arena, token_buffer *Tokens, token_index Token, token_index End)
 {
-    token *Result = 0;
-        
-    loaded_file IncludeFile = Win32ReadEntireFile(Path);
-    if(IncludeFile.Memory)
+    // NOTE(felipe): Includes Token but not End.
+    char *Result = 0;
+    
+    uint32 Length = 0;
+    for(token_index Test = Token;
+        Test != End;
+        ++Test)
     {
-        token *Token2 = Tokenize(&IncludeFile);
-        if(!Token2)
-        {
-            ErrorInToken(IncludeToken, "could not open include file: %s", Path);
-        }        
-        
-        Result = AppendToken(Token2, Token);
+        Length += GetTokenLength(Tokens, Test);
     }
-    else
+    
+    Result = (char *)PushSize(Arena, Length + 1);
+    
+    uint32 Index = 0;
+    for(token_index Test = Token;
+        Test != End;
+        ++Test)
     {
-        ErrorInToken(IncludeToken, "could not open include file: %s", Path);
+        MemCopy(Result + Index, GetTokenText(Tokens, Test), GetTokenLength(Tokens, Test));
+        Index += GetTokenLength(Tokens, Test);
     }
-
+    
     return Result;
 }
 
-typedef struct macro
-{
-    token *Identifier;
-    
-    // NOTE(felipe): Does include Start, does not include End.
-    token *Start;
-    token *End;
+#include "corsac_preprocessor.c"
+#include "corsac_pch.c"
 
-    struct macro *Next;
-} macro;
+// TODO(felipe): Remove globals.
+global_variable corsac_options GlobalOptions;
 
-typedef struct macro_list
+internal void
+PrintArenaStats(char *Name, memory_arena *Arena)
 {
-    uint32 Count;
+    printf("  %-14s %10zu bytes used %10zu bytes committed %6u commits\n",
+           Name, Arena->Used, Arena->CommittedSize, Arena->CommitCount);
+}
 
-    macro *First;
-    macro *Last;
-} macro_list;
+#include "corsac_parser.c"
+#include "corsac_ir.c"
 
-internal void
-PushMacro(macro_list *List, macro *SourceMacro)
+internal char *
+GetOutputName(memory_arena *Arena, char *InputFilename, char *Extension)
 {
-    macro *ListElement = (macro *)malloc(sizeof(macro));
-    
-    if(!List->First)
+    // NOTE(felipe): The name of the input without its directory and with
+    // Extension in place of its own, the way cc names what it writes.
+    char *Name = InputFilename;
+    for(char *At = InputFilename;
+        *At;
+        ++At)
     {
-        List->First = ListElement;
-        List->Last = ListElement;
+        if(IsPathSeparator(*At))
+        {
+            Name = At + 1;
+        }
     }
-    else
+    
+    uint32 NameLength = StringLength(Name);
+    for(uint32 Index = NameLength;
+        Index;
+        --Index)
     {
-        List->Last->Next = ListElement;
-        List->Last = ListElement;
+        if(Name[Index - 1] == '.')
+        {
+            NameLength = Index - 1;
+            break;
+        }
     }
     
-    MemCopy(ListElement, SourceMacro, sizeof(macro));
+    uint32 ExtensionLength = StringLength(Extension);
+    char *Result = (char *)PushSize(Arena, NameLength + ExtensionLength + 1);
+    MemCopy(Result, Name, NameLength);
+    MemCopy(Result + NameLength, Extension, ExtensionLength + 1);
     
-    ++List->Count;
+    return Result;
 }
 
-#include "corsac_parser.c"
-#include "corsac_ir.c"
+internal void
+EndDependencies(memory_arena *Arena, preprocessor *Preprocessor, loaded_file *InputFile)
+{
+    if(GlobalOptions.EmitDependencies)
+    {
+        char *Filename = GlobalOptions.DependencyFilename;
+        if(!Filename)
+        {
+            Filename = GetOutputName(Arena, InputFile->Filename, ".d");
+        }
+        
+        char *Target = GlobalOptions.DependencyTarget;
+        bool32 QuoteTarget = GlobalOptions.QuoteDependencyTarget;
+        if(!Target)
+        {
+            Target = GetOutputName(Arena, InputFile->Filename, ".o");
+            QuoteTarget = true;
+        }
+        
+        WriteDependencies(Preprocessor, Filename, Target, QuoteTarget, InputFile, GlobalOptions.IncludePchFilename);
+    }
+}
 
 internal int
-CorsacMain(char *InputFilename)
+CorsacMain(int ArgumentCount, char **ArgumentVector)
 {
-    if(InputFilename)
+    for(int ArgumentIndex = 1;
+        ArgumentIndex < ArgumentCount;
+        ++ArgumentIndex)
     {
-        loaded_file InputFile = Win32ReadEntireFile(InputFilename);
+        char *Argument = ArgumentVector[ArgumentIndex];
         
-        if((char *)InputFile.Memory)
+        if(!StringCompare(Argument, "-stats", 7))
         {
-            // NOTE(felipe): Tokenize file
-            token *Tokens = Tokenize(&InputFile);
-            
-            // NOTE(felipe): Preprocess
-#if 0
-            string_list IncludeDirs = {0};
+            GlobalOptions.PrintStats = true;
+        }
+        else if(!StringCompare(Argument, "-E", 3))
+        {
+            GlobalOptions.Preprocess = true;
+        }
+        else if(!StringCompare(Argument, "-dump-tokens", 13))
+        {
+            GlobalOptions.DumpTokens = true;
+        }
+        else if(!StringCompare(Argument, "-dump-ast", 10))
+        {
+            GlobalOptions.DumpAST = true;
+        }
+        else if(!StringCompare(Argument, "-lex-bench", 11))
+        {
+            GlobalOptions.BenchmarkLexer = true;
+        }
+        else if(!StringCompare(Argument, "-parse-bench", 13))
+        {
+            GlobalOptions.BenchmarkParser = true;
+        }
+        else if(!StringCompare(Argument, "-pp-bench", 10))
+        {
+            GlobalOptions.BenchmarkPreprocessor = true;
+        }
+        else if(!StringCompare(Argument, "-emit-pch", 10) || !StringCompare(Argument, "-include-pch", 13))
+        {
+            if(ArgumentIndex + 1 >= ArgumentCount)
+            {
+                Error("%s expects a file name", Argument);
+            }
             
-            // TODO(felipe): This should not be hard-coded.
-            // PushString(&State->IncludeDirs, ".\\include");
-            PushString(&IncludeDirs, "C:\\Program Files (x86)\\Windows Kits\\10\\Include\\10.0.19041.0\\ucrt");
-            PushString(&IncludeDirs, "C:\\Program Files (x86)\\Microsoft Visual Studio\\2019\\Community\\VC\\Tools\\MSVC\\14.29.30133\\include");
-            PushString(&IncludeDirs, "C:\\Program Files (x86)\\Windows Kits\\10\\Include\\10.0.19041.0\\um");
-#endif
+            char *Filename = ArgumentVector[++ArgumentIndex];
+            if(Argument[1] == 'e')
+            {
+                GlobalOptions.EmitPchFilename = Filename;
+            }
+            else
+            {
+                GlobalOptions.IncludePchFilename = Filename;
+            }
+        }
+        else if(!StringCompare(Argument, "-MD", 4))
+        {
+            GlobalOptions.EmitDependencies = true;
+        }
+        else if(!StringCompare(Argument, "-MF", 4) || !StringCompare(Argument, "-MT", 4) ||
+                !StringCompare(Argument, "-MQ", 4))
+        {
+            if(ArgumentIndex + 1 >= ArgumentCount)
+            {
+                Error("%s expects a %s", Argument, (Argument[2] == 'F') ? "file name" : "target");
+            }
             
-            token *Token = Tokens;
+            char *Name = ArgumentVector[++ArgumentIndex];
+            if(Argument[2] == 'F')
+            {
+                GlobalOptions.DependencyFilename = Name;
+            }
+            else
+            {
+                GlobalOptions.DependencyTarget = Name;
+                GlobalOptions.QuoteDependencyTarget = (Argument[2] == 'Q');
+            }
+        }
+        else if(!StringCompare(Argument, "-I", 2) || !StringCompare(Argument, "-isystem", 9))
+        {
+            // NOTE(felipe): -Idir and -I dir are both taken.
+            bool32 System = (Argument[1] == 'i');
+            char *Directory = Argument + 2;
+            if(System || !*Directory)
+            {
+                if(ArgumentIndex + 1 >= ArgumentCount)
+                {
+                    Error("%s expects a directory", Argument);
+                }
+                
+                Directory = ArgumentVector[++ArgumentIndex];
+            }
             
-            token Head = {0};
-            token *Current = &Head;
+            AddSearchDirectory(Directory, System);
+        }
+        else if(!StringCompare(Argument, "-j", 3))
+        {
+            bool32 Valid = false;
+            if(ArgumentIndex + 1 < ArgumentCount)
+            {
+                char *Count = ArgumentVector[++ArgumentIndex];
+                Valid = true;
+                GlobalOptions.ThreadCount = (uint32)StringToNumber(Count, StringLength(Count), &Valid);
+            }
             
-            macro_list Macros = {0};
+            if(!Valid || !GlobalOptions.ThreadCount || (GlobalOptions.ThreadCount > MAX_THREAD_COUNT))
+            {
+                Error("-j expects a thread count between 1 and %d", MAX_THREAD_COUNT);
+            }
+        }
+        else if(Argument[0] == '-')
+        {
+            Error("unknown option: %s", Argument);
+        }
+        else
+        {
+            GlobalOptions.InputFilename = Argument;
+        }
+    }
+    
+    InitializeLexer();
+    
+    char *InputFilename = GlobalOptions.InputFilename;
+    if(InputFilename)
+    {
+        // NOTE(felipe): Every phase allocates from its own arena, the whole
+        // compile is released at the end with one call per arena.
+        memory_arena TokenArena = {0};
+        memory_arena PreprocessorArena = {0};
+        memory_arena ParserArena = {0};
+        memory_arena ASTArena = {0};
+        memory_arena IRArena = {0};
+        
+        // NOTE(felipe): The precompiled header brings its own files and
+        // atoms, they have to come first.
+        precompiled_header *PrecompiledHeader = 0;
+        if(GlobalOptions.IncludePchFilename)
+        {
+            if(GlobalOptions.EmitPchFilename)
+            {
+                Error("-emit-pch cannot be used with -include-pch");
+            }
             
-            token *LastToken = 0;
-            while(Token->TokenType != TokenType_EOF)
+            PrecompiledHeader = LoadPrecompiledHeader(&PreprocessorArena, GlobalOptions.IncludePchFilename);
+        }
+        
+        loaded_file *InputFile = LoadCachedFile(InputFilename);
+        
+        if(InputFile && GlobalOptions.BenchmarkLexer)
+        {
+            BenchmarkLexer(&TokenArena, InputFile);
+        }
+        else if(InputFile && GlobalOptions.BenchmarkParser)
+        {
+            BenchmarkParser(&ParserArena, &ASTArena, InputFile);
+        }
+        else if(InputFile && GlobalOptions.BenchmarkPreprocessor)
+        {
+            BenchmarkPreprocessor(&PreprocessorArena, InputFile, PrecompiledHeader);
+        }
+        else if(InputFile && GlobalOptions.EmitPchFilename)
+        {
+            preprocessor Preprocessor = {0};
+            token_buffer *Tokens = BeginPreprocessor(&Preprocessor, &TokenArena, &PreprocessorArena,
+                                                     InputFile, 0);
+            EmitPrecompiledHeader(&TokenArena, &Preprocessor, Tokens, GlobalOptions.EmitPchFilename);
+        }
+        else if(InputFile && GlobalOptions.Preprocess)
+        {
+            preprocessor Preprocessor = {0};
+            token_buffer *Tokens = BeginPreprocessor(&Preprocessor, &TokenArena, &PreprocessorArena,
+                                                     InputFile, 0);
+            if(PrecompiledHeader)
             {
-                if(!TokenIsCharacter(Token, '#'))
-                {
-                    bool32 ReplacedWithMacro = false;
-                    for(macro *Macro = Macros.First;
-                        Macro;
-                        Macro = Macro->Next)
-                    {
-                        if(Token->Length == Macro->Identifier->Length &&
-                           !StringCompare(Token->Location, Macro->Identifier->Location, Token->Length))
-                        {
-                            // NOTE(felipe): Found an instance of a
-                            // macro, copy it.
-                            token *Cursor = LastToken;
-                            for (token *Iterator = Macro->Start;
-                                 Iterator != Macro->End;
-                                 Iterator = Iterator->Next)
-                            {
-                                Cursor->Next = CopyToken(Iterator);
-                                Cursor = Cursor->Next;
-                                
-                                Current->Next = Cursor;
-                                Current = Current->Next;
-                            }
-                            
-                            Cursor->Next = Token->Next;
-                            Token = Cursor->Next;
-                            
-                            ReplacedWithMacro = true;
-//                            Error("Macro match");
-                            break;
-                        }
-                    }
-                    
-                    LastToken = Token;
-                    
-                    if(!ReplacedWithMacro)
-                    {
-                        Current->Next = Token;
-                        Current = Current->Next;
-                        Token = Token->Next;
-                    }
-                }
-                else
-                {
-                    // NOTE(felipe): This token is a preprocessor directive.
-                    token *Start = Token;
-                    Token = Token->Next;
-                    
-                    if(TokenIs(Token, "define"))
-                    {
-                        if(!Token->Next->AtBeginningOfLine)
-                        {
-                            Token = Token->Next;
-                            
-                            macro Macro = {0};
-                            Macro.Identifier = Token;
-                            
-                            Token = Token->Next;                   
-                            token *StringEnd = Token;
-                            while(!StringEnd->AtBeginningOfLine)
-                            {
-                                StringEnd = StringEnd->Next;
-                            }
-                            
-                            if(Macro.Identifier != StringEnd)
-                            {
-                                // NOTE(felipe): There is a string to
-                                // replace in every instance of identifier.
-                                
-                                Macro.Start = Token;
-                                Macro.End = StringEnd;
-                                
-                                Token = StringEnd;
-                            }
-                            
-                            PushMacro(&Macros, &Macro);
-                        }
-                        else
-                        {
-                            ErrorInToken(Token, "invalid define directive");
-                        }
-                    }
-                    else if(TokenIs(Token, "include"))
-                    {
-                        Token = Token->Next;
-                        
-                        char *Filename = 0;
-                        if(TokenIs(Token, "\""))
-                        {
-                            // Pattern 1: #include "foo.h"
-                            
-                            Filename = StringFromToken(Token->Next);
-                            AssertNext(Token, "\"");
-                            Token = Token->Next;
-                        }
-                        else if(TokenIsCharacter(Token, '<'))
-                        {
-                            ErrorInToken(Token, "<filename> is unsupported");
-                        }
-                        else
-                        {
-                            ErrorInToken(Token, "unexpected \"filename\" or <filename>");
-                        }
-                        
-                        Token = IncludeFile(Token, Filename, Start->Next->Next);
-                    }
-                    else if(TokenIs(Token, "error"))
-                    {
-                        ErrorInToken(Token->Next, "error preprocessor directive");
-                    }
-                    else if(TokenIs(Token, "warning"))
-                    {
-                        WarningInToken(Token->Next, "warning preprocessor directive");
-                    }
-                    else
-                    {
-                        ErrorInToken(Token, "unsupported preprocessor directive");
-                    }
-                }
+                UsePrecompiledHeader(&Preprocessor, PrecompiledHeader);
             }
             
-            // DEBUG: Print produced tokens.
-            char *TokenTypes[] =
-                {
-                    "Ident",
-                    "Punct",
-                    "Keywo",
-                    "Numbe",
-                    "EOF  ",
-                };
+            WritePreprocessedTokens(&PreprocessorArena, &Preprocessor, Tokens);
+            EndDependencies(&PreprocessorArena, &Preprocessor, InputFile);
+        }
+        else if(InputFile)
+        {
+            // NOTE(felipe): Lexing, preprocessing and parsing run as one
+            // pipeline, the parser pulls tokens from the preprocessor which
+            // pulls them from the lexer.
+            // NOTE(felipe): With more than one thread the main file is lexed
+            // up front, in chunks, unless it has a lexer error. Those are
+            // left to the on demand lexer, which knows about conditionals.
+            token_buffer *FileTokens = 0;
+            if(GlobalOptions.ThreadCount > 1)
+            {
+                platform_work_queue *Queue = PlatformCreateWorkQueue(GlobalOptions.ThreadCount);
+                FileTokens = TokenizeParallel(&TokenArena, InputFile, Queue, 4*GlobalOptions.ThreadCount);
+                PlatformDestroyWorkQueue(Queue);
+            }
             
-            for(token *Token = Head.Next;
-                Token;
-                Token = Token->Next)
+            preprocessor Preprocessor = {0};
+            Preprocessor.PrintTokens = GlobalOptions.DumpTokens;
+            token_buffer *Tokens = BeginPreprocessor(&Preprocessor, &TokenArena, &PreprocessorArena,
+                                                     InputFile, FileTokens);
+            if(PrecompiledHeader)
             {
-                printf(" Token %c (%s): %.*s\n", Token->AtBeginningOfLine?'Y':'N', TokenTypes[Token->TokenType], Token->Length, Token->Location);
+                UsePrecompiledHeader(&Preprocessor, PrecompiledHeader);
             }
-            //
             
             // NOTE(felipe): Parse
-            program *Program = ParseTokens(Head.Next);
+            program *Program = ParseTokens(&ParserArena, &ASTArena, Tokens);
             
             // NOTE(felipe): Generate Intermediate Representation.
-            GenerateIR(Program);
+            GenerateIR(&IRArena, Program);
+            
+            // NOTE(felipe): The parser read the whole preprocessed stream, so
+            // every include was seen by now.
+            EndDependencies(&PreprocessorArena, &Preprocessor, InputFile);
+            
+            if(GlobalOptions.PrintStats)
+            {
+                PrintHeaderStats(&Preprocessor);
+                
+                printf("\nMemory\n");
+                PrintArenaStats("tokens", &TokenArena);
+                PrintArenaStats("atoms", &GlobalAtoms.Arena);
+                PrintArenaStats("preprocessor", &PreprocessorArena);
+                PrintArenaStats("directories", &GlobalDirectories.Arena);
+                PrintArenaStats("parser", &ParserArena);
+                PrintArenaStats("ast", &ASTArena);
+                PrintArenaStats("ir", &IRArena);
+            }
+        }
+        else
+        {
+            Error("could not open input file: %s", InputFilename);
         }
+        
+        ReleaseArena(&TokenArena);
+        ReleaseArena(&PreprocessorArena);
+        ReleaseArena(&ParserArena);
+        ReleaseArena(&ASTArena);
+        ReleaseArena(&IRArena);
+        ReleaseArena(&GlobalFiles.Arena);
+        ReleaseArena(&GlobalFiles.LineArena);
+        ReleaseArena(&GlobalFiles.PathArena);
+        ReleaseArena(&GlobalDirectories.Arena);
+        ReleaseArena(&GlobalAtoms.Arena);
+        ReleaseArena(&GlobalSpellingArena);
     }
     else
     {
@@ -25,6 +25,9 @@ typedef int16_t int16;
 typedef int8_t int8;
 typedef int32 bool32;
 
+typedef float real32;
+typedef double real64;
+
 typedef size_t memory_index;
 
 #if CORSAC_SLOW
@@ -42,14 +45,106 @@ typedef size_t memory_index;
 #define Gigabytes(Value) (Megabytes(Value) * 1024LL)
 #define Terabytes(Value) (Gigabytes(Value) * 1024LL)
 
+#if defined(_MSC_VER)
+    #define AlignOf(Type) __alignof(Type)
+#else
+    #define AlignOf(Type) __alignof__(Type)
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+    #define CORSAC_X64 1
+    #include <immintrin.h>
+    
+    // NOTE(felipe): gcc only emits AVX2 instructions inside functions that
+    // ask for them, msvc emits them anywhere.
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define TARGET_AVX2
+    #else
+        #include <cpuid.h>
+        #define TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+// NOTE(felipe): Arenas reserve a big range of address space up front and
+// commit it in ARENA_COMMIT_SIZE steps as they grow, so pushed memory never
+// moves and a whole arena is released with a single call. Memory handed out
+// by an arena is always zeroed.
+#define ARENA_RESERVE_SIZE Gigabytes(4)
+#define ARENA_COMMIT_SIZE Megabytes(1)
+
+typedef struct memory_arena
+{
+    uint8 *Memory;
+    memory_index Used;
+    memory_index CommittedSize;
+    memory_index ReservedSize;
+    
+    uint32 CommitCount;
+    uint32 TemporaryCount;
+} memory_arena;
+
+typedef struct temporary_memory
+{
+    memory_arena *Arena;
+    memory_index Used;
+} temporary_memory;
+
+#define PushStruct(Arena, Type) (Type *)PushSize_(Arena, sizeof(Type), AlignOf(Type))
+#define PushArray(Arena, Count, Type) (Type *)PushSize_(Arena, (Count)*sizeof(Type), AlignOf(Type))
+#define PushSize(Arena, Size) PushSize_(Arena, Size, 1)
+
+// NOTE(felipe): Work queues run callbacks on a pool of worker threads. The
+// thread calling PlatformCompleteAllWork works on the queue too, so a queue
+// with a thread count of one has no workers and runs everything there.
+struct platform_work_queue;
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(struct platform_work_queue *Queue, void *Data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(platform_work_queue_callback);
+
+#define MAX_THREAD_COUNT 64
+
+// NOTE(felipe): Listing a directory calls back once per name in it, "." and
+// ".." included.
+#define PLATFORM_DIRECTORY_ENTRY_CALLBACK(name) void name(void *Data, char *Name)
+typedef PLATFORM_DIRECTORY_ENTRY_CALLBACK(platform_directory_entry_callback);
+
+// NOTE(felipe): Longest canonical path of a source file.
+#define MAX_PATH_LENGTH 4096
+
+// NOTE(felipe): Every loaded file owns the range [BaseLocation,
+// BaseLocation + Size] of one location space shared by the whole compile, so
+// a 32-bit source_location is enough to find the file, the line and the
+// column of anything. The extra location past the end belongs to EOF.
+typedef uint32 source_location;
+
 typedef struct loaded_file
 {
     char *Filename;
     
     void *Memory;
     uint64 Size;
+    
+    source_location BaseLocation;
+    
+    // NOTE(felipe): Offsets of the first byte of every line, built the first
+    // time a location in the file is turned into a line and a column.
+    uint32 LineCount;
+    uint32 *LineStarts;
 } loaded_file;
 
+// NOTE(felipe): Line and Column start at one, LineStart and LineLength are
+// the text of the line without its newline.
+typedef struct source_position
+{
+    loaded_file *File;
+    
+    uint32 Line;
+    uint32 Column;
+    
+    char *LineStart;
+    uint32 LineLength;
+} source_position;
+
 typedef enum token_type
 {
     TokenType_Identifier,
@@ -58,23 +153,244 @@ typedef enum token_type
     TokenType_Keyword,
     
     TokenType_Number,         // Number literal
+    TokenType_String,         // String literal, quotes included
     
     TokenType_EOF,            // End-of-file markers
 } token_type;
 
-typedef struct token
+// NOTE(felipe): C89 keywords.
+typedef enum keyword
+{
+    Keyword_None,
+    
+    Keyword_Auto,
+    Keyword_Break,
+    Keyword_Case,
+    Keyword_Char,
+    Keyword_Const,
+    Keyword_Continue,
+    Keyword_Default,
+    Keyword_Do,
+    Keyword_Double,
+    Keyword_Else,
+    Keyword_Enum,
+    Keyword_Extern,
+    Keyword_Float,
+    Keyword_For,
+    Keyword_Goto,
+    Keyword_If,
+    Keyword_Int,
+    Keyword_Long,
+    Keyword_Register,
+    Keyword_Return,
+    Keyword_Short,
+    Keyword_Signed,
+    Keyword_Sizeof,
+    Keyword_Static,
+    Keyword_Struct,
+    Keyword_Switch,
+    Keyword_Typedef,
+    Keyword_Union,
+    Keyword_Unsigned,
+    Keyword_Void,
+    Keyword_Volatile,
+    Keyword_While,
+    
+    Keyword_Count,
+} keyword;
+
+// NOTE(felipe): Punctuators are numbered after the keywords, so keyword and
+// punctuator tokens share one dense range of kinds.
+typedef enum punctuator
+{
+    Punctuator_OpenBracket = Keyword_Count,     // [
+    Punctuator_CloseBracket,                    // ]
+    Punctuator_OpenParen,                       // (
+    Punctuator_CloseParen,                      // )
+    Punctuator_OpenBrace,                       // {
+    Punctuator_CloseBrace,                      // }
+    Punctuator_Dot,                             // .
+    Punctuator_Arrow,                           // ->
+    Punctuator_Increment,                       // ++
+    Punctuator_Decrement,                       // --
+    Punctuator_Ampersand,                       // &
+    Punctuator_Star,                            // *
+    Punctuator_Plus,                            // +
+    Punctuator_Minus,                           // -
+    Punctuator_Tilde,                           // ~
+    Punctuator_Bang,                            // !
+    Punctuator_Slash,                           // /
+    Punctuator_Percent,                         // %
+    Punctuator_ShiftLeft,                       // <<
+    Punctuator_ShiftRight,                      // >>
+    Punctuator_Less,                            // <
+    Punctuator_Greater,                         // >
+    Punctuator_LessEqual,                       // <=
+    Punctuator_GreaterEqual,                    // >=
+    Punctuator_EqualEqual,                      // ==
+    Punctuator_NotEqual,                        // !=
+    Punctuator_Caret,                           // ^
+    Punctuator_Pipe,                            // |
+    Punctuator_AndAnd,                          // &&
+    Punctuator_OrOr,                            // ||
+    Punctuator_Question,                        // ?
+    Punctuator_Colon,                           // :
+    Punctuator_Semicolon,                       // ;
+    Punctuator_Ellipsis,                        // ...
+    Punctuator_Equal,                           // =
+    Punctuator_StarEqual,                       // *=
+    Punctuator_SlashEqual,                      // /=
+    Punctuator_PercentEqual,                    // %=
+    Punctuator_PlusEqual,                       // +=
+    Punctuator_MinusEqual,                      // -=
+    Punctuator_ShiftLeftEqual,                  // <<=
+    Punctuator_ShiftRightEqual,                 // >>=
+    Punctuator_AmpersandEqual,                  // &=
+    Punctuator_CaretEqual,                      // ^=
+    Punctuator_PipeEqual,                       // |=
+    Punctuator_Comma,                           // ,
+    Punctuator_Hash,                            // #
+    Punctuator_HashHash,                        // ##
+    
+    Punctuator_Count,
+} punctuator;
+
+#define PUNCTUATOR_COUNT (Punctuator_Count - Keyword_Count)
+
+typedef enum token_flags
 {
-    token_type TokenType;
-    struct token *Next;
+    TokenFlag_AtBeginningOfLine = 0x1,
     
-    loaded_file *SourceFile;
+    // NOTE(felipe): The name of a macro found while that macro was being
+    // expanded, or of no macro at all, it is never expanded again.
+    TokenFlag_NoExpand = 0x2,
     
-    char *Location;
+    // NOTE(felipe): Blanks or comments come before the token, always set at
+    // the beginning of a line.
+    TokenFlag_SpaceBefore = 0x4,
+    
+    // NOTE(felipe): A name with line continuations in it, its text has to be
+    // spliced before it is compared, interned or written.
+    TokenFlag_Spliced = 0x8,
+} token_flags;
+
+typedef uint32 token_index;
+
+// NOTE(felipe): Identifiers are interned, equal names get the same atom. The
+// keywords are interned first, so the atom of a keyword is its keyword.
+typedef uint32 atom;
+
+typedef struct atom_entry
+{
+    char *String;
     uint32 Length;
-    bool32 AtBeginningOfLine;
+    uint32 Hash;
+} atom_entry;
+
+// NOTE(felipe): Slots is an open addressing hash table of atoms, Entries is
+// indexed by atom. Atom 0 is no atom.
+typedef struct atom_table
+{
+    memory_arena Arena;
     
-    uint64 NumericalValue;
-} token;
+    uint32 Count;
+    uint32 EntryCapacity;
+    atom_entry *Entries;
+    
+    uint32 SlotCount;
+    atom *Slots;
+} atom_table;
+
+#define MIN_ATOM_SLOT_COUNT 1024
+
+// NOTE(felipe): Open addressing hash table keyed by atom, for tables whose
+// slots are structs of SlotSize bytes that start with their atom. A slot
+// keeps its name once used, only what it holds gets cleared, so there are no
+// tombstones and a name that comes back lands in the same slot.
+typedef struct atom_map
+{
+    uint32 SlotSize;
+    uint32 UsedSlotCount;
+    uint32 SlotCount;
+    uint8 *Slots;
+} atom_map;
+
+struct token_buffer;
+typedef void token_fill_function(struct token_buffer *Buffer, void *Context);
+
+// NOTE(felipe): Tokens are kept as parallel arrays and referred to by their
+// index. The text of a token is found through its location, number literals
+// live in a side table: Values holds the atom of an identifier, the keyword
+// or punctuator of keyword and punctuation tokens and the index into Literals
+// of a number token.
+//
+// A buffer can also be a window over a stream of tokens: reading past the
+// last token calls Fill to produce more, and ReleaseTokens drops the ones the
+// reader is done with. Indices keep counting from the start of the stream,
+// First is the index of the oldest token still in the arrays.
+typedef struct token_buffer
+{
+    memory_arena *Arena;
+    
+    token_index First;
+    uint32 Count;
+    uint32 Capacity;
+    
+    token_fill_function *Fill;
+    void *FillContext;
+    
+    uint8 *Types;
+    uint8 *Flags;
+    source_location *Locations;
+    uint32 *Lengths;
+    uint32 *Values;
+    
+    uint32 LiteralCount;
+    uint32 LiteralCapacity;
+    uint64 *Literals;
+} token_buffer;
+
+internal loaded_file *GetFileForLocation(source_location Location);
+internal char *GetSourcePointer(source_location Location);
+internal source_position GetSourcePosition(source_location Location);
+inline source_location GetTokenLocation(token_buffer *Buffer, token_index Token);
+
+typedef struct corsac_options
+{
+    char *InputFilename;
+    
+    bool32 PrintStats;
+    bool32 BenchmarkLexer;
+    bool32 BenchmarkParser;
+    bool32 BenchmarkPreprocessor;
+    
+    // NOTE(felipe): -E writes the preprocessed input to the standard output
+    // instead of compiling it.
+    bool32 Preprocess;
+    
+    // NOTE(felipe): Debug dumps, -dump-tokens prints the preprocessed tokens
+    // and -dump-ast the functions and their syntax trees.
+    bool32 DumpTokens;
+    bool32 DumpAST;
+    
+    // NOTE(felipe): -emit-pch preprocesses the input into a precompiled
+    // header instead of compiling it, -include-pch puts one before the input.
+    char *EmitPchFilename;
+    char *IncludePchFilename;
+    
+    // NOTE(felipe): -MD writes a make rule with every file the input depends
+    // on, to the -MF file and for the -MT target, or the -MQ one with the
+    // characters make treats specially quoted. They default to the name of
+    // the input with .d and with .o, quoted.
+    bool32 EmitDependencies;
+    char *DependencyFilename;
+    char *DependencyTarget;
+    bool32 QuoteDependencyTarget;
+    
+    // NOTE(felipe): Threads lexing the main file, it is lexed on demand
+    // when this is one.
+    uint32 ThreadCount;
+} corsac_options;
 
 inline uint32
 SafeTruncateUInt64(uint64 Value)
@@ -89,12 +405,26 @@ inline void
 MemCopy(void *Destination, void *Source, uint32 Size)
 {
     // TODO(felipe): Max 4 Gigs.
-    for(uint32 Index = 0;
-        Index < Size;
-        ++Index)
-    {
-        *((uint8 *)Destination + Index) = *((uint8 *)Source + Index);
-    }
+    // NOTE(felipe): The byte loop was never vectorized because the compiler
+    // can not rule out overlap, memcpy is an intrinsic on every compiler we
+    // care about. Source and Destination must not overlap.
+    memcpy(Destination, Source, Size);
+}
+
+inline uint32
+FindLeastSignificantSetBit(uint32 Value)
+{
+    Assert(Value);
+    
+#if defined(_MSC_VER)
+    unsigned long Index;
+    _BitScanForward(&Index, Value);
+    uint32 Result = (uint32)Index;
+#else
+    uint32 Result = (uint32)__builtin_ctz(Value);
+#endif
+    
+    return Result;
 }
 
 inline uint32
@@ -114,24 +444,6 @@ StringLength(char *String)
     return Result;
 }
 
-inline char *
-StringDuplicate(char *String, uint32 Length)
-{
-    char *Result = 0;
-    
-    char *Destination = (char *)malloc(Length + 1);
-    
-    if(Destination)
-    {
-        // NOTE(felipe): Null termination.
-        Destination[Length] = 0;
-        MemCopy(Destination, String, Length);
-        Result = Destination;
-    }
-    
-    return Result;
-}
-
 inline int32
 StringCompare(char *StringA, char *StringB, uint32 Bytes)
 {
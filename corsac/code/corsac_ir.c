@@ -26,12 +26,17 @@ PushString(memory_arena *Arena, char *String, ...)
     va_list Arguments;
     va_start(Arguments, String);
     
-    uint32 Lenght = vsnprintf(0, 0, String, Arguments) + 1;
-    Assert((Arena->Size - Arena->Used) > Lenght);
+    va_list LengthArguments;
+    va_copy(LengthArguments, Arguments);
+    uint32 Lenght = vsnprintf(0, 0, String, LengthArguments) + 1;
+    va_end(LengthArguments);
     
-    vsnprintf((char *)Arena->Memory + Arena->Used, Lenght, String, Arguments);
+    char *Destination = (char *)PushSize(Arena, Lenght);
+    vsnprintf(Destination, Lenght, String, Arguments);
     
-    Arena->Used += Lenght - 1;
+    // NOTE(felipe): Drop the null terminator, the next string is appended
+    // right after this one.
+    Arena->Used -= 1;
     
     va_end(Arguments);
 }
@@ -53,53 +58,58 @@ NewInstruction(ir_section *Instructions, operation Op)
     return Result;
 }
 
+internal atom
+InternSymbolName(char *Format, va_list Args)
+{
+    // NOTE(felipe): Symbol names are interned like identifiers, so that
+    // resolving a symbol compares atoms.
+    char Buffer[256];
+    int32 Length = vsnprintf(Buffer, sizeof(Buffer), Format, Args);
+    Assert((Length >= 0) && (Length < (int32)sizeof(Buffer)));
+    
+    atom Result = InternAtom(Buffer, (uint32)Length);
+    return Result;
+}
+
 internal ir_symbol *
 NewSymbol(ir_section *Section, char *Name, ...)
 {
     va_list Args;
     va_start(Args, Name);
     
-    uint32 Lenght = vsnprintf(0, 0, Name, Args) + 1;
-    
     ir_symbol *Result = 0;
     if(Section->Symbols)
     {
-        // TODO(felipe): remove malloc
-        char *Buffer = malloc(Lenght);
-        vsprintf_s(Buffer, Lenght, Name, Args);
-        
         Result = Section->Symbols + Section->SymbolCount;
-        Result->Name = Buffer;
+        Result->Name = InternSymbolName(Name, Args);
     }
     
     ++Section->SymbolCount;
     
+    va_end(Args);
+    
     return Result;
 }
 
 internal ir_symbol *
-NewSymbolEx(memory_arena *Arena, ir_section *Section, symbol_flags Flags, char *Name, ...)
+NewSymbolEx(ir_section *Section, symbol_flags Flags, char *Name, ...)
 {
     va_list Args;
     va_start(Args, Name);
     
-    uint32 Lenght = vsnprintf(0, 0, Name, Args) + 1;
-    
     ir_symbol *Result = 0;
     if(Section->Symbols)
     {
-        // TODO(felipe): remove malloc
-        char *Buffer = malloc(Lenght);
-        vsprintf_s(Buffer, Lenght, Name, Args);
-        
         Result = Section->Symbols + Section->SymbolCount;
-        Result->Name = Buffer;
+        Result->Name = InternSymbolName(Name, Args);
         Result->Flags = Flags;
         Result->InstructionIndex = Section->Count;
     }
     
     ++Section->SymbolCount;
     
+    va_end(Args);
+    
     return Result;    
 }
 
@@ -252,26 +262,29 @@ AlignTo(int32 Value, uint32 Align)
     return Result;
 }
 
-internal void GenerateExpression(ast_node *Node);
+internal void GenerateExpression(node_index Index);
 
 // Compute the absolute address of a given node.
 // It's an error if a given node does not reside in memory.
 inline void
-GenerateAddress(ast_node *Node)
+GenerateAddress(node_index Index)
 {
+    ast_node *Node = GetNode(Index);
     switch(Node->NodeType)
     {
         case ASTNodeType_Variable:
         {
+            object *Variable = ((ast_variable *)Node)->Variable;
+            
             NewInstruction(GlobalText, Op_Lea);
             AddOperandRegister(GlobalText, Operand_Rax);
-            AddOperandRegisterMemoryOffset(GlobalText, Operand_Rbp, Node->Variable->StackBaseOffset);
-            PushString(GlobalFileArena, "  lea rax, [rbp + %d]\n", (int32)Node->Variable->StackBaseOffset);
+            AddOperandRegisterMemoryOffset(GlobalText, Operand_Rbp, Variable->StackBaseOffset);
+            PushString(GlobalFileArena, "  lea rax, [rbp + %d]\n", (int32)Variable->StackBaseOffset);
         } break;
         
         case ASTNodeType_Dereference:
         {
-            GenerateExpression(Node->LeftHandSide);
+            GenerateExpression(((ast_unary *)Node)->Operand);
         } break;
         
         default:
@@ -283,8 +296,9 @@ GenerateAddress(ast_node *Node)
 
 // Generate code for a given node.
 internal void
-GenerateExpression(ast_node *Node)
+GenerateExpression(node_index Index)
 {
+    ast_node *Node = GetNode(Index);
     switch(Node->NodeType)
     {
         case ASTNodeType_Number:
@@ -292,13 +306,13 @@ GenerateExpression(ast_node *Node)
             // TODO(felipe): Make numerical value storing consistent.
             NewInstruction(GlobalText, Op_Move);
             AddOperandRegister(GlobalText, Operand_Rax);
-            AddOperandImmediate(GlobalText, Node->NumericalValue);
-            PushString(GlobalFileArena, "  mov rax, %d\n", (uint32)Node->NumericalValue);
+            AddOperandImmediate(GlobalText, ((ast_number *)Node)->Value);
+            PushString(GlobalFileArena, "  mov rax, %d\n", (uint32)((ast_number *)Node)->Value);
         } break;
         
         case ASTNodeType_Negate:
         {
-            GenerateExpression(Node->LeftHandSide);
+            GenerateExpression(((ast_unary *)Node)->Operand);
             
             NewInstruction(GlobalText, Op_Negate);
             AddOperandRegister(GlobalText, Operand_Rax);
@@ -307,7 +321,7 @@ GenerateExpression(ast_node *Node)
         
         case ASTNodeType_Variable:
         {
-            GenerateAddress(Node);
+            GenerateAddress(Index);
 
             NewInstruction(GlobalText, Op_Move);
             AddOperandRegister(GlobalText, Operand_Rax);
@@ -317,7 +331,7 @@ GenerateExpression(ast_node *Node)
 
         case ASTNodeType_Dereference:
         {
-            GenerateExpression(Node->LeftHandSide);
+            GenerateExpression(((ast_unary *)Node)->Operand);
 
             NewInstruction(GlobalText, Op_Move);
             AddOperandRegister(GlobalText, Operand_Rax);
@@ -326,18 +340,18 @@ GenerateExpression(ast_node *Node)
         } break;
         case ASTNodeType_Address:
         {
-            GenerateAddress(Node->LeftHandSide);
+            GenerateAddress(((ast_unary *)Node)->Operand);
         } break;
         
         case ASTNodeType_Assign:
         {
-            GenerateAddress(Node->LeftHandSide);
+            GenerateAddress(((ast_binary *)Node)->LeftHandSide);
             
             NewInstruction(GlobalText, Op_Push);
             AddOperandRegister(GlobalText, Operand_Rax);
             GeneratePush();
             
-            GenerateExpression(Node->RightHandSide);
+            GenerateExpression(((ast_binary *)Node)->RightHandSide);
             
             NewInstruction(GlobalText, Op_Pop);
             AddOperandRegister(GlobalText, Operand_Rdi);
@@ -351,13 +365,13 @@ GenerateExpression(ast_node *Node)
         
         default:
         {
-            GenerateExpression(Node->RightHandSide);
+            GenerateExpression(((ast_binary *)Node)->RightHandSide);
             
             NewInstruction(GlobalText, Op_Push);
             AddOperandRegister(GlobalText, Operand_Rax);
             GeneratePush();
 
-            GenerateExpression(Node->LeftHandSide);
+            GenerateExpression(((ast_binary *)Node)->LeftHandSide);
 
             NewInstruction(GlobalText, Op_Pop);
             AddOperandRegister(GlobalText, Operand_Rdi);
@@ -442,7 +456,7 @@ GenerateExpression(ast_node *Node)
                 
                 default:
                 {
-                    ErrorInToken(Node->Token, "invalid expression");
+                    ErrorAt(Node->Location, "invalid expression");
                 } break;
             }
         } break;
@@ -450,23 +464,26 @@ GenerateExpression(ast_node *Node)
 }
 
 internal void
-GenerateStatement(memory_arena *Arena, ast_node *Node)
+GenerateStatement(memory_arena *Arena, node_index Index)
 {
+    ast_node *Node = GetNode(Index);
     switch(Node->NodeType)
     {
         case ASTNodeType_Block:
         {
-            for(ast_node *ChildNode = Node->Body;
-                ChildNode;
-                ChildNode = ChildNode->Next)
+            ast_block *Block = (ast_block *)Node;
+            node_index *Statements = GetBlockStatements(Block);
+            for(uint32 StatementIndex = 0;
+                StatementIndex < Block->Count;
+                ++StatementIndex)
             {
-                GenerateStatement(Arena, ChildNode);
+                GenerateStatement(Arena, Statements[StatementIndex]);
             }
         } break;
         
         case ASTNodeType_Return:
         {
-            GenerateExpression(Node->LeftHandSide);
+            GenerateExpression(((ast_unary *)Node)->Operand);
             
             // TODO(felipe): Symbol reference.
             NewInstruction(GlobalText, Op_Jump);
@@ -476,8 +493,9 @@ GenerateStatement(memory_arena *Arena, ast_node *Node)
 
         case ASTNodeType_If:
         {
+            ast_if *If = (ast_if *)Node;
             uint32 ID = UniqueNumber();
-            GenerateExpression(Node->Condition);
+            GenerateExpression(If->Condition);
             
             NewInstruction(GlobalText, Op_Compare);
             AddOperandRegister(GlobalText, Operand_Rax);
@@ -487,37 +505,38 @@ GenerateStatement(memory_arena *Arena, ast_node *Node)
             PushString(GlobalFileArena, "  cmp rax, 0\n");
             PushString(GlobalFileArena, "  je  .L.else.%d\n", ID);
             
-            GenerateStatement(Arena, Node->Then);
+            GenerateStatement(Arena, If->Then);
             
             NewInstruction(GlobalText, Op_Jump);
             AddOperandSymbol(GlobalText, NewSymbol(GlobalText, ".L.end.%d", ID));
             PushString(GlobalFileArena, "  jmp .L.end.%d\n", ID);
             
-            NewSymbolEx(Arena, GlobalText, SymbolFlag_Local, ".L.else.%d", ID);
+            NewSymbolEx(GlobalText, SymbolFlag_Local, ".L.else.%d", ID);
             PushString(GlobalFileArena, ".L.else.%d:\n", ID);
-            if(Node->Else)
+            if(If->Else)
             {
-                GenerateStatement(Arena, Node->Else);
+                GenerateStatement(Arena, If->Else);
             }
             
-            NewSymbolEx(Arena, GlobalText, SymbolFlag_Local, ".L.end.%d", ID);
+            NewSymbolEx(GlobalText, SymbolFlag_Local, ".L.end.%d", ID);
             PushString(GlobalFileArena, ".L.end.%d:\n", ID);
         } break;
         
         case ASTNodeType_For:
         {
+            ast_for *For = (ast_for *)Node;
             uint32 ID = UniqueNumber();
             
-            if(Node->Init)
+            if(For->Init)
             {
-                GenerateStatement(Arena, Node->Init);
+                GenerateStatement(Arena, For->Init);
             }
             
-            NewSymbolEx(Arena, GlobalText, SymbolFlag_Local, ".L.end.%d", ID);
+            NewSymbolEx(GlobalText, SymbolFlag_Local, ".L.end.%d", ID);
             PushString(GlobalFileArena, ".L.begin.%d:\n", ID);
-            if(Node->Condition)
+            if(For->Condition)
             {
-                GenerateExpression(Node->Condition);
+                GenerateExpression(For->Condition);
                 
                 NewInstruction(GlobalText, Op_Compare);
                 AddOperandRegister(GlobalText, Operand_Rax);
@@ -528,28 +547,28 @@ GenerateStatement(memory_arena *Arena, ast_node *Node)
                 PushString(GlobalFileArena, "  je  .L.end.%d\n", ID);
             }
             
-            GenerateStatement(Arena, Node->Then);
+            GenerateStatement(Arena, For->Then);
             
-            if(Node->Increment)
+            if(For->Increment)
             {
-                GenerateExpression(Node->Increment);
+                GenerateExpression(For->Increment);
             }
 
             NewInstruction(GlobalText, Op_Jump);
             AddOperandAddress(GlobalText, 0xffff);
-            NewSymbolEx(Arena, GlobalText, SymbolFlag_Local, ".L.end.%d", ID);
+            NewSymbolEx(GlobalText, SymbolFlag_Local, ".L.end.%d", ID);
             PushString(GlobalFileArena, "  jmp .L.begin.%d\n", ID);
             PushString(GlobalFileArena, ".L.end.%d:\n", ID);
         } break;
         
         case ASTNodeType_Expression_Statement:
         {
-            GenerateExpression(Node->LeftHandSide);
+            GenerateExpression(((ast_unary *)Node)->Operand);
         } break;
         
         default:
         {
-            ErrorInToken(Node->Token, "invalid statement");
+            ErrorAt(Node->Location, "invalid statement");
         } break;
     }
 }
@@ -576,31 +595,23 @@ AssignLvarOffsets(program *Program)
     }
 }
 
+// NOTE(felipe): Machine code is packed, these never align.
 internal void
 PushByte(memory_arena *Arena, uint8 Byte)
 {
-    Assert((Arena->Size - Arena->Used) > 1);
-
-    *((uint8 *)Arena->Memory + Arena->Used) = Byte;
-    ++Arena->Used;
+    *(uint8 *)PushSize(Arena, 1) = Byte;
 }
 
 internal void
 PushWord(memory_arena *Arena, uint16 Word)
 {
-    Assert((Arena->Size - Arena->Used) > 2);
-
-    *(uint16 *)((uint8 *)Arena->Memory + Arena->Used) = Word;
-    Arena->Used += 2;
+    *(uint16 *)PushSize(Arena, 2) = Word;
 }
 
 internal void
 PushDWord(memory_arena *Arena, uint32 DWord)
 {
-    Assert((Arena->Size - Arena->Used) > 4);
-    
-    *(uint32 *)((uint8 *)Arena->Memory + Arena->Used) = DWord;
-    Arena->Used += 4;
+    *(uint32 *)PushSize(Arena, 4) = DWord;
 }
 
 typedef enum x64_register
@@ -624,7 +635,7 @@ typedef enum x64_register
     OperandRegister_R13,
     OperandRegister_R14,
     OperandRegister_R15,
-} operand_register;
+} x64_register;
     
 uint8 x64Registers[] =
 {
@@ -752,17 +763,19 @@ MIOperation(memory_arena *Arena, instruction *Instruction, uint8 Opcode, uint8 R
 }
 
 internal void
-GenerateIR(program *Program)
+GenerateIR(memory_arena *Arena, program *Program)
 {
-    // TODO(felipe): Resize arena as needed.
-    memory_arena FileArena = Win32AllocateArena(Megabytes(1));
+    // NOTE(felipe): Each output buffer gets its own arena so it stays
+    // contiguous while it grows. The IR itself lives in Arena.
+    memory_arena FileArena = {0};
     GlobalFileArena = &FileArena;
+    GlobalNodes = Program->Nodes;
     
     AssignLvarOffsets(Program);
     
-    memory_arena MainArena = Win32AllocateArena(Megabytes(1));
+    memory_arena MainArena = {0};
     
-    GlobalText = calloc(1, sizeof(ir_section));
+    GlobalText = PushStruct(Arena, ir_section);
     GlobalText->Name = ".text";
     PushString(GlobalFileArena, "  section .text\n");
     
@@ -773,14 +786,14 @@ GenerateIR(program *Program)
     {
         if(Pass == 1)
         {
-            GlobalText->Instructions = calloc(GlobalText->Count, sizeof(instruction));
+            GlobalText->Instructions = PushArray(Arena, GlobalText->Count, instruction);
             GlobalText->Count = 0;
             
-            GlobalText->Symbols = calloc(GlobalText->SymbolCount, sizeof(ir_symbol));
+            GlobalText->Symbols = PushArray(Arena, GlobalText->SymbolCount, ir_symbol);
             GlobalText->SymbolCount = 0;
         }
         
-        NewSymbolEx(&MainArena, GlobalText, SymbolFlag_Global, "main");
+        NewSymbolEx(GlobalText, SymbolFlag_Global, "main");
         PushString(GlobalFileArena, "  global main\n");
         
         // NOTE(felipe): The loop is run for every function.
@@ -788,8 +801,8 @@ GenerateIR(program *Program)
             Object;
             Object = Object->Next)
         {
-            NewSymbolEx(&MainArena, GlobalText, SymbolFlag_Local, Object->Name);
-            PushString(GlobalFileArena, "%s:\n", Object->Name);
+            NewSymbolEx(GlobalText, SymbolFlag_Local, "%s", GetAtomString(Object->Name));
+            PushString(GlobalFileArena, "%s:\n", GetAtomString(Object->Name));
             
             // Prologue
             NewInstruction(GlobalText, Op_Push);
@@ -804,15 +817,10 @@ GenerateIR(program *Program)
             PushString(GlobalFileArena, "  mov rbp, rsp\n");
             PushString(GlobalFileArena, "  sub rsp, %d\n", Object->StackSize);
             
-            for(ast_node *Node = Object->Body;
-                Node;
-                Node = Node->Next)
-            {
-                GenerateStatement(&MainArena, Node);
-                Assert(GlobalDepth == 0);
-            }
+            GenerateStatement(Arena, Object->Body);
+            Assert(GlobalDepth == 0);
             
-            NewSymbolEx(&MainArena, GlobalText, SymbolFlag_Local, ".L.return");
+            NewSymbolEx(GlobalText, SymbolFlag_Local, ".L.return");
             NewInstruction(GlobalText, Op_Move);
             AddOperandRegister(GlobalText, Operand_Rsp);
             AddOperandRegister(GlobalText, Operand_Rbp);
@@ -826,7 +834,7 @@ GenerateIR(program *Program)
         }
     }
     
-    Win32WriteEntireFile("main.asm", FileArena.Memory, FileArena.Used);
+    PlatformWriteEntireFile("main.asm", FileArena.Memory, FileArena.Used);
     
     
     // NOTE(felipe): x64 assembler.
@@ -1016,7 +1024,7 @@ GenerateIR(program *Program)
                 ++TestIndex)
             {
                 ir_symbol *TestSymbol = GlobalText->Symbols + TestIndex;
-                if(TestSymbol != Symbol && !StringCompare(Symbol->Name, TestSymbol->Name, StringLength(TestSymbol->Name)) &&
+                if(TestSymbol != Symbol && (Symbol->Name == TestSymbol->Name) &&
                    (TestSymbol->Flags & SymbolFlag_Local || TestSymbol->Flags & SymbolFlag_Global))
                 {
                     FoundSymbol = TestSymbol;
@@ -1034,12 +1042,12 @@ GenerateIR(program *Program)
             }
             else
             {
-                Error("Undefined symbol: %s", Symbol->Name);
+                Error("Undefined symbol: %s", GetAtomString(Symbol->Name));
             }
         }
     }
     
-    Win32WriteEntireFile("main.bin", MainArena.Memory, MainArena.Used);
+    PlatformWriteEntireFile("main.bin", MainArena.Memory, MainArena.Used);
     
     // NOTE(felipe): Merge Matching globals and locals.
     for(uint32 Index = 0;
@@ -1056,7 +1064,7 @@ GenerateIR(program *Program)
             {
                 ir_symbol *TestSymbol = GlobalText->Symbols + TestIndex;
                 
-                if(!StringCompare(Symbol->Name, TestSymbol->Name, StringLength(TestSymbol->Name)) &&
+                if((Symbol->Name == TestSymbol->Name) &&
                    TestSymbol->Flags == SymbolFlag_Local)
                 {
                     Symbol->Offset = TestSymbol->Offset;
@@ -1085,8 +1093,12 @@ GenerateIR(program *Program)
         }
     }
     
+    // NOTE(felipe): The section symbols are only needed until the object
+    // file is written.
+    temporary_memory SectionMemory = BeginTemporaryMemory(Arena);
+    
     uint32 InsertedSymbolCount = 0; 
-    Section.Symbols = malloc(Section.SymbolCount*sizeof(symbol));    
+    Section.Symbols = PushArray(Arena, Section.SymbolCount, symbol);
     
     for(uint32 Index = 0;
         Index < GlobalText->SymbolCount;
@@ -1098,7 +1110,7 @@ GenerateIR(program *Program)
         {
             symbol *Symbol = Section.Symbols + InsertedSymbolCount++;
             
-            Symbol->Name = IRSymbol->Name;
+            Symbol->Name = GetAtomString(IRSymbol->Name);
             Symbol->Flags = IRSymbol->Flags;
             Symbol->OffsetInSection = IRSymbol->Offset;
         }
@@ -1111,11 +1123,11 @@ GenerateIR(program *Program)
     
     
     // NOTE(felipe): COFF Header.
-    memory_arena CoffArena = Win32AllocateArena(Megabytes(1));
+    memory_arena CoffArena = {0};
     coff_header *Header = PushStruct(&CoffArena, coff_header);
     Header->Machine = COFF_MACHINE_AMD64;
     Header->NumberOfSections = 1;
-    Header->TimeDateStamp = Win32GetTime();
+    Header->TimeDateStamp = PlatformGetTime();
     Header->PointerToSymbolTable = 0;
     Header->NumberOfSymbols = Section.SymbolCount;
     Header->SizeOfOptionalHeader = 0;
@@ -1157,8 +1169,8 @@ GenerateIR(program *Program)
     SectionHeader->PointerToLinenumbers = 0;
     SectionHeader->NumberOfRelocations = 0;
     SectionHeader->NumberOfLinenumbers = 0;
-    SectionHeader->Flags = IMAGE_SCN_CNT_CODE|IMAGE_SCN_ALIGN_1BYTES|IMAGE_SCN_ALIGN_8BYTES|
-        IMAGE_SCN_MEM_EXECUTE|IMAGE_SCN_MEM_READ;
+    SectionHeader->Flags = COFF_SCN_CNT_CODE|COFF_SCN_ALIGN_1BYTES|COFF_SCN_ALIGN_8BYTES|
+        COFF_SCN_MEM_EXECUTE|COFF_SCN_MEM_READ;
     
     SectionHeader->PointerToRawData = CoffArena.Used;    
     uint8 *RawMemory = PushSize(&CoffArena, Section.BufferLength);
@@ -1175,7 +1187,7 @@ GenerateIR(program *Program)
     Entry->SectionNumber = 1;
     Entry->Type.MSB = 0x00;
     Entry->Type.LSB = 0x00;
-    Entry->StorageClass = IMAGE_SYM_CLASS_STATIC;
+    Entry->StorageClass = COFF_SYM_CLASS_STATIC;
     Entry->NumberOfAuxSymbols = 1;
     uint32 *Size = (uint32 *)PushStruct(&CoffArena, coff_symbol_table_entry);
     *Size = Section.BufferLength;
@@ -1186,7 +1198,7 @@ GenerateIR(program *Program)
     Entry->SectionNumber = -1;
     Entry->Type.MSB = 0x00;
     Entry->Type.LSB = 0x00;
-    Entry->StorageClass = IMAGE_SYM_CLASS_STATIC;
+    Entry->StorageClass = COFF_SYM_CLASS_STATIC;
     Entry->NumberOfAuxSymbols = 0;
 #endif
     
@@ -1205,11 +1217,11 @@ GenerateIR(program *Program)
         
         if(Symbol->Flags == SymbolFlag_Global)
         {
-            Entry->StorageClass = IMAGE_SYM_CLASS_EXTERNAL;
+            Entry->StorageClass = COFF_SYM_CLASS_EXTERNAL;
         }
         else
         {
-            Entry->StorageClass = IMAGE_SYM_CLASS_STATIC;
+            Entry->StorageClass = COFF_SYM_CLASS_STATIC;
         }
         
         Entry->NumberOfAuxSymbols = 0;
@@ -1234,7 +1246,7 @@ GenerateIR(program *Program)
                 Entry->SectionNumber = Symbol->SectionNumber;
                 Entry->Type.LSB = 0;
                 Entry->Type.MSB = 0;
-                Entry->StorageClass = IMAGE_SYM_CLASS_FILE;
+                Entry->StorageClass = COFF_SYM_CLASS_FILE;
                 Entry->NumberOfAuxSymbols = 1;
 
                 char *SectionEntry = (char *)PushStruct(&State->ObjectArena, coff_symbol_table_entry);
@@ -1252,7 +1264,7 @@ GenerateIR(program *Program)
                 Entry->SectionNumber = Symbol->SectionNumber;
                 Entry->Type.LSB = 0;
                 Entry->Type.MSB = 0;
-                Entry->StorageClass = IMAGE_SYM_CLASS_STATIC;
+                Entry->StorageClass = COFF_SYM_CLASS_STATIC;
                 Entry->NumberOfAuxSymbols = 1;
 
                 coff_symbol_table_entry_aux_section *SectionEntry = PushStruct(&State->ObjectArena, coff_symbol_table_entry_aux_section);                
@@ -1277,11 +1289,11 @@ GenerateIR(program *Program)
                 if(Symbol->Type == SymbolType_External ||
                    Symbol->Type == SymbolType_Global)
                 {
-                    Entry->StorageClass = IMAGE_SYM_CLASS_EXTERNAL;
+                    Entry->StorageClass = COFF_SYM_CLASS_EXTERNAL;
                 }
                 else
                 {
-                    Entry->StorageClass = IMAGE_SYM_CLASS_STATIC;
+                    Entry->StorageClass = COFF_SYM_CLASS_STATIC;
                 }
         
                 Entry->NumberOfAuxSymbols = 0;
@@ -1290,8 +1302,23 @@ GenerateIR(program *Program)
     }
 #endif
 
-    uint32 *StringTableSize = PushStruct(&CoffArena, uint32);
-    *StringTableSize = 4;
+    // NOTE(felipe): The string table comes right after the 18 byte symbols,
+    // its size is not aligned.
+    *(uint32 *)PushSize(&CoffArena, sizeof(uint32)) = 4;
+    
+    PlatformWriteEntireFile("main.obj", CoffArena.Memory, CoffArena.Used);
+    
+    EndTemporaryMemory(SectionMemory);
+    
+    if(GlobalOptions.PrintStats)
+    {
+        printf("\nOutput\n");
+        PrintArenaStats("main.asm", &FileArena);
+        PrintArenaStats("main.bin", &MainArena);
+        PrintArenaStats("main.obj", &CoffArena);
+    }
     
-    Win32WriteEntireFile("main.obj", CoffArena.Memory, CoffArena.Used);
+    ReleaseArena(&FileArena);
+    ReleaseArena(&MainArena);
+    ReleaseArena(&CoffArena);
 }
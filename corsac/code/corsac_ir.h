@@ -36,7 +36,7 @@ typedef enum symbol_flags
 
 typedef struct ir_symbol
 {
-    char *Name;
+    atom Name;
     symbol_flags Flags;
     uint32 Offset;
     
@@ -203,6 +203,22 @@ enum image_file_machine
     COFF_MACHINE_WCEMIPSV2 = 0x169,
 };
 
+enum coff_section_flags
+{
+    COFF_SCN_CNT_CODE      = 0x00000020,
+    COFF_SCN_ALIGN_1BYTES  = 0x00100000,
+    COFF_SCN_ALIGN_8BYTES  = 0x00400000,
+    COFF_SCN_MEM_EXECUTE   = 0x20000000,
+    COFF_SCN_MEM_READ      = 0x40000000,
+};
+
+enum coff_storage_class
+{
+    COFF_SYM_CLASS_EXTERNAL = 2,
+    COFF_SYM_CLASS_STATIC   = 3,
+    COFF_SYM_CLASS_FILE     = 103,
+};
+
 #pragma pack(push, 1)
 typedef struct coff_header
 {
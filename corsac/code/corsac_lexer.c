@@ -0,0 +1,2443 @@
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Felipe Carlin $
+   $Notice: Copyright  2022 Felipe Carlin $
+   ======================================================================== */
+
+#include "corsac_lexer.h"
+
+internal uint32
+GetIntegerSuffixLength(char *Start, uint32 Length)
+{
+    // NOTE(felipe): u or U, and l, L, ll or LL, in either order.
+    uint32 Result = 0;
+    
+    bool32 SawUnsigned = false;
+    bool32 SawLong = false;
+    while(Result < Length)
+    {
+        char *At = Start + Length - Result - 1;
+        if(!SawUnsigned && (*At == 'u' || *At == 'U'))
+        {
+            SawUnsigned = true;
+            ++Result;
+        }
+        else if(!SawLong && (*At == 'l' || *At == 'L'))
+        {
+            SawLong = true;
+            ++Result;
+            
+            if((Result < Length) && (At[-1] == *At))
+            {
+                ++Result;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+internal uint64
+StringToNumber(char *Start, uint32 Lenght, bool32 *Valid)
+{
+    // NOTE(felipe): Decimal, octal or hexadecimal, the type the suffix asks
+    // for is not kept.
+    uint64 Result = 0;
+    
+    Lenght -= GetIntegerSuffixLength(Start, Lenght);
+    if(!Lenght)
+    {
+        *Valid = false;
+    }
+
+    if(Lenght >= 2 && Start[0] == '0' && (Start[1] == 'x' || Start[1] == 'X'))
+    {
+        Start += 2;
+        Lenght -= 2;
+        
+        if(!Lenght)
+        {
+            *Valid = false;
+        }
+        
+        while(Lenght--)
+        {
+            Result *= 16;
+            
+            if(*Start >= '0' &&
+               *Start <= '9')
+            {
+                Result += *Start - '0';
+            }
+            else if(*Start >= 'a' &&
+                    *Start <= 'f')
+            {
+                Result += *Start - 'a' + 10;
+            }
+            else if(*Start >= 'A' &&
+                    *Start <= 'F')
+            {
+                Result += *Start - 'A' + 10;
+            }
+            else
+            {
+                *Valid = false;
+            }
+            
+            ++Start;
+        }
+    }
+    else
+    {
+        uint32 Base = (Start[0] == '0') ? 8 : 10;
+        while(Lenght--)
+        {
+            if(*Start < '0' ||
+               *Start >= '0' + Base)
+            {
+                *Valid = false;
+            }
+            
+            Result *= Base;
+            Result += *Start - '0';
+            
+            ++Start;
+        }
+    }
+    
+    return Result;
+}
+
+internal uint64
+EscapedCharacter(char Character, bool32 *Valid)
+{
+    uint64 Result = 0;
+    
+    switch(Character)
+    {
+        case 'r': { Result = '\r'; } break;
+        case 'n': { Result = '\n'; } break;
+        case 't': { Result = '\t'; } break;
+        
+        case '\'': { Result = '\''; } break;
+        case '\"': { Result = '\"'; } break;
+        
+        case '\\': { Result = '\\'; } break;
+        
+        case '0': { Result = 0; } break;
+        
+        default:
+        {
+            *Valid = false;
+        } break;
+    }
+    
+    return Result;
+}
+
+//
+// NOTE(felipe): Token buffer
+//
+
+internal void
+GrowTokenBuffer(token_buffer *Buffer, uint32 Capacity)
+{
+    // NOTE(felipe): The old arrays are left behind in the arena, capacity
+    // doubles so that waste stays below the final size of the buffer.
+    Assert(Capacity > Buffer->Count);
+    
+    uint8 *Types = PushArray(Buffer->Arena, Capacity, uint8);
+    uint8 *Flags = PushArray(Buffer->Arena, Capacity, uint8);
+    source_location *Locations = PushArray(Buffer->Arena, Capacity, source_location);
+    uint32 *Lengths = PushArray(Buffer->Arena, Capacity, uint32);
+    uint32 *Values = PushArray(Buffer->Arena, Capacity, uint32);
+    
+    if(Buffer->Count)
+    {
+        MemCopy(Types, Buffer->Types, Buffer->Count*sizeof(uint8));
+        MemCopy(Flags, Buffer->Flags, Buffer->Count*sizeof(uint8));
+        MemCopy(Locations, Buffer->Locations, Buffer->Count*sizeof(source_location));
+        MemCopy(Lengths, Buffer->Lengths, Buffer->Count*sizeof(uint32));
+        MemCopy(Values, Buffer->Values, Buffer->Count*sizeof(uint32));
+    }
+    
+    Buffer->Types = Types;
+    Buffer->Flags = Flags;
+    Buffer->Locations = Locations;
+    Buffer->Lengths = Lengths;
+    Buffer->Values = Values;
+    Buffer->Capacity = Capacity;
+}
+
+internal token_buffer *
+NewTokenBuffer(memory_arena *Arena, uint32 Capacity, uint32 LiteralCapacity)
+{
+    token_buffer *Result = PushStruct(Arena, token_buffer);
+    Result->Arena = Arena;
+    
+    GrowTokenBuffer(Result, Capacity ? Capacity : 64);
+    
+    if(LiteralCapacity)
+    {
+        Result->Literals = PushArray(Arena, LiteralCapacity, uint64);
+        Result->LiteralCapacity = LiteralCapacity;
+    }
+    
+    return Result;
+}
+
+internal void
+CopyDown(void *Destination, void *Source, memory_index Size)
+{
+    // NOTE(felipe): Arrays only ever move down. Copying in pieces no bigger
+    // than the distance moved keeps source and destination apart, so the
+    // copy never falls back to a byte at a time.
+    uint8 *To = (uint8 *)Destination;
+    uint8 *From = (uint8 *)Source;
+    Assert(To <= From);
+    
+    memory_index Distance = From - To;
+    while(Size && Distance)
+    {
+        memory_index Piece = (Size < Distance) ? Size : Distance;
+        MemCopy(To, From, SafeTruncateUInt64(Piece));
+        
+        To += Piece;
+        From += Piece;
+        Size -= Piece;
+    }
+}
+
+internal uint8 *
+PackArray(uint8 *At, void *Source, memory_index Size, memory_index Alignment)
+{
+    uint8 *Result = (uint8 *)AlignPow2((memory_index)At, Alignment);
+    ZeroSize(At, Result - At);
+    
+    CopyDown(Result, Source, Size);
+    
+    return Result;
+}
+
+internal void
+ZeroStaleArray(void *Array, memory_index Size, uint8 *End)
+{
+    uint8 *Start = (uint8 *)Array;
+    if(Start < End)
+    {
+        Start = End;
+    }
+    
+    if(Start < (uint8 *)Array + Size)
+    {
+        ZeroSize(Start, (uint8 *)Array + Size - Start);
+    }
+}
+
+internal void
+TrimTokenBuffer(token_buffer *Buffer)
+{
+    // NOTE(felipe): A buffer sized for the worst case gets its arrays packed
+    // back to back once the count is known, and the rest is given back to
+    // the arena. Only possible while the buffer is the last thing on it.
+    memory_arena *Arena = Buffer->Arena;
+    
+    uint8 *BufferEnd = (uint8 *)(Buffer->Literals + Buffer->LiteralCapacity);
+    if(Buffer->Literals &&
+       (BufferEnd == Arena->Memory + Arena->Used) &&
+       ((uint8 *)Buffer->Values < (uint8 *)Buffer->Literals))
+    {
+        uint32 Count = Buffer->Count;
+        uint32 LiteralCount = Buffer->LiteralCount;
+        
+        uint8 *OldFlags = Buffer->Flags;
+        source_location *OldLocations = Buffer->Locations;
+        uint32 *OldLengths = Buffer->Lengths;
+        uint32 *OldValues = Buffer->Values;
+        uint64 *OldLiterals = Buffer->Literals;
+        
+        uint8 *At = Buffer->Types + Count;
+        Buffer->Flags = PackArray(At, OldFlags, Count*sizeof(uint8), AlignOf(uint8));
+        At = Buffer->Flags + Count;
+        Buffer->Locations = (source_location *)PackArray(At, OldLocations, Count*sizeof(source_location),
+                                                         AlignOf(source_location));
+        At = (uint8 *)(Buffer->Locations + Count);
+        Buffer->Lengths = (uint32 *)PackArray(At, OldLengths, Count*sizeof(uint32), AlignOf(uint32));
+        At = (uint8 *)(Buffer->Lengths + Count);
+        Buffer->Values = (uint32 *)PackArray(At, OldValues, Count*sizeof(uint32), AlignOf(uint32));
+        At = (uint8 *)(Buffer->Values + Count);
+        Buffer->Literals = (uint64 *)PackArray(At, OldLiterals, LiteralCount*sizeof(uint64), AlignOf(uint64));
+        At = (uint8 *)(Buffer->Literals + LiteralCount);
+        
+        // NOTE(felipe): Keep the promise that pushed memory is always zeroed,
+        // only the parts that were written can be dirty.
+        ZeroStaleArray(OldFlags, Count*sizeof(uint8), At);
+        ZeroStaleArray(OldLocations, Count*sizeof(source_location), At);
+        ZeroStaleArray(OldLengths, Count*sizeof(uint32), At);
+        ZeroStaleArray(OldValues, Count*sizeof(uint32), At);
+        ZeroStaleArray(OldLiterals, LiteralCount*sizeof(uint64), At);
+        
+        Buffer->Capacity = Count;
+        Buffer->LiteralCapacity = LiteralCount;
+        Arena->Used = At - Arena->Memory;
+    }
+}
+
+inline token_index
+PushToken(token_buffer *Buffer, token_type Type, source_location Location, uint32 Length, uint32 Flags)
+{
+    if(Buffer->Count == Buffer->Capacity)
+    {
+        GrowTokenBuffer(Buffer, 2*Buffer->Capacity);
+    }
+    
+    uint32 Slot = Buffer->Count++;
+    
+    Buffer->Types[Slot] = (uint8)Type;
+    Buffer->Flags[Slot] = (uint8)Flags;
+    Buffer->Locations[Slot] = Location;
+    Buffer->Lengths[Slot] = Length;
+    Buffer->Values[Slot] = 0;
+    
+    token_index Result = Buffer->First + Slot;
+    return Result;
+}
+
+internal uint32
+PushLiteral(token_buffer *Buffer, uint64 Value)
+{
+    if(Buffer->LiteralCount == Buffer->LiteralCapacity)
+    {
+        uint32 Capacity = Buffer->LiteralCapacity ? 2*Buffer->LiteralCapacity : 64;
+        uint64 *Literals = PushArray(Buffer->Arena, Capacity, uint64);
+        if(Buffer->LiteralCount)
+        {
+            MemCopy(Literals, Buffer->Literals, Buffer->LiteralCount*sizeof(uint64));
+        }
+        
+        Buffer->Literals = Literals;
+        Buffer->LiteralCapacity = Capacity;
+    }
+    
+    uint32 Result = Buffer->LiteralCount++;
+    Buffer->Literals[Result] = Value;
+    
+    return Result;
+}
+
+inline void
+SetTokenValue(token_buffer *Buffer, token_index Token, uint32 Value)
+{
+    Assert(Token - Buffer->First < Buffer->Count);
+    Buffer->Values[Token - Buffer->First] = Value;
+}
+
+inline uint32
+GetTokenSlot(token_buffer *Buffer, token_index Token)
+{
+    // NOTE(felipe): Released tokens are gone, tokens that were not produced
+    // yet are pulled in on demand.
+    Assert(Token >= Buffer->First);
+    while(Token - Buffer->First >= Buffer->Count)
+    {
+        Assert(Buffer->Fill);
+        Buffer->Fill(Buffer, Buffer->FillContext);
+    }
+    
+    uint32 Result = Token - Buffer->First;
+    return Result;
+}
+
+internal void
+ReleaseTokens(token_buffer *Buffer, token_index Before)
+{
+    // NOTE(felipe): Live tokens are moved to the front only once the released
+    // ones outnumber them, so a reader that releases after every token pays
+    // O(1) per token.
+    Assert(Before >= Buffer->First);
+    uint32 Drop = Before - Buffer->First;
+    Assert(Drop <= Buffer->Count);
+    
+    uint32 Live = Buffer->Count - Drop;
+    if(Drop && (Drop >= Live))
+    {
+        uint32 LiteralCount = 0;
+        for(uint32 Slot = 0;
+            Slot < Live;
+            ++Slot)
+        {
+            uint32 From = Slot + Drop;
+            
+            Buffer->Types[Slot] = Buffer->Types[From];
+            Buffer->Flags[Slot] = Buffer->Flags[From];
+            Buffer->Locations[Slot] = Buffer->Locations[From];
+            Buffer->Lengths[Slot] = Buffer->Lengths[From];
+            Buffer->Values[Slot] = Buffer->Values[From];
+            
+            if(Buffer->Types[Slot] == TokenType_Number)
+            {
+                // NOTE(felipe): Literals were pushed in token order, so they
+                // also only move down.
+                Buffer->Literals[LiteralCount] = Buffer->Literals[Buffer->Values[Slot]];
+                Buffer->Values[Slot] = LiteralCount++;
+            }
+        }
+        
+        Buffer->First += Drop;
+        Buffer->Count = Live;
+        Buffer->LiteralCount = LiteralCount;
+    }
+}
+
+inline token_type
+GetTokenType(token_buffer *Buffer, token_index Token)
+{
+    token_type Result = (token_type)Buffer->Types[GetTokenSlot(Buffer, Token)];
+    return Result;
+}
+
+inline source_location
+GetTokenLocation(token_buffer *Buffer, token_index Token)
+{
+    source_location Result = Buffer->Locations[GetTokenSlot(Buffer, Token)];
+    return Result;
+}
+
+inline uint32
+GetTokenLength(token_buffer *Buffer, token_index Token)
+{
+    uint32 Result = Buffer->Lengths[GetTokenSlot(Buffer, Token)];
+    return Result;
+}
+
+inline char *
+GetTokenText(token_buffer *Buffer, token_index Token)
+{
+    char *Result = GetSourcePointer(GetTokenLocation(Buffer, Token));
+    return Result;
+}
+
+inline bool32
+TokenAtBeginningOfLine(token_buffer *Buffer, token_index Token)
+{
+    bool32 Result = Buffer->Flags[GetTokenSlot(Buffer, Token)] & TokenFlag_AtBeginningOfLine;
+    return Result;
+}
+
+inline uint32
+GetTokenFlags(token_buffer *Buffer, token_index Token)
+{
+    uint32 Result = Buffer->Flags[GetTokenSlot(Buffer, Token)];
+    return Result;
+}
+
+inline void
+SetTokenFlags(token_buffer *Buffer, token_index Token, uint32 Flags)
+{
+    Buffer->Flags[GetTokenSlot(Buffer, Token)] = (uint8)Flags;
+}
+
+inline keyword
+GetTokenKeyword(token_buffer *Buffer, token_index Token)
+{
+    keyword Result = Keyword_None;
+    
+    uint32 Slot = GetTokenSlot(Buffer, Token);
+    if(Buffer->Types[Slot] == TokenType_Keyword)
+    {
+        Result = (keyword)Buffer->Values[Slot];
+    }
+    
+    return Result;
+}
+
+inline uint32
+GetTokenKind(token_buffer *Buffer, token_index Token)
+{
+    // NOTE(felipe): The keyword or punctuator of the token, zero for any
+    // other token.
+    uint32 Result = 0;
+    
+    uint32 Slot = GetTokenSlot(Buffer, Token);
+    if(Buffer->Types[Slot] == TokenType_Keyword || Buffer->Types[Slot] == TokenType_Punctuation)
+    {
+        Result = Buffer->Values[Slot];
+    }
+    
+    return Result;
+}
+
+inline atom
+GetTokenAtom(token_buffer *Buffer, token_index Token)
+{
+    // NOTE(felipe): Keyword tokens have the atom of their keyword.
+    atom Result = 0;
+    
+    uint32 Slot = GetTokenSlot(Buffer, Token);
+    if(Buffer->Types[Slot] == TokenType_Identifier || Buffer->Types[Slot] == TokenType_Keyword)
+    {
+        Result = Buffer->Values[Slot];
+    }
+    
+    return Result;
+}
+
+inline uint64
+GetTokenNumber(token_buffer *Buffer, token_index Token)
+{
+    uint32 Slot = GetTokenSlot(Buffer, Token);
+    Assert(Buffer->Types[Slot] == TokenType_Number);
+    
+    uint64 Result = Buffer->Literals[Buffer->Values[Slot]];
+    return Result;
+}
+
+internal token_index
+CopyTokenWithFlags(token_buffer *Destination, token_buffer *Source, token_index Token, uint32 Flags)
+{
+    uint32 Slot = GetTokenSlot(Source, Token);
+    
+    token_type Type = (token_type)Source->Types[Slot];
+    token_index Result = PushToken(Destination, Type, Source->Locations[Slot],
+                                   Source->Lengths[Slot], Flags);
+    
+    uint32 Value = Source->Values[Slot];
+    if(Type == TokenType_Number)
+    {
+        Value = PushLiteral(Destination, Source->Literals[Value]);
+    }
+    SetTokenValue(Destination, Result, Value);
+    
+    return Result;
+}
+
+inline token_index
+CopyToken(token_buffer *Destination, token_buffer *Source, token_index Token)
+{
+    token_index Result = CopyTokenWithFlags(Destination, Source, Token, GetTokenFlags(Source, Token));
+    return Result;
+}
+
+inline uint32
+GetLineContinuationLength(char *At)
+{
+    // NOTE(felipe): Length of the backslash and newline at At, 0 if there is
+    // no line continuation there.
+    uint32 Result = 0;
+    if(At[0] == '\\')
+    {
+        Result = 1;
+        if(At[Result] == '\r')
+        {
+            ++Result;
+        }
+        if(At[Result] == '\n')
+        {
+            ++Result;
+        }
+        
+        if(Result == 1)
+        {
+            Result = 0;
+        }
+    }
+    
+    return Result;
+}
+
+internal uint32
+RemoveLineContinuations(char *Text, uint32 Length, char *Destination, uint32 DestinationSize)
+{
+    // NOTE(felipe): Returns the spliced length, even if only DestinationSize
+    // characters of it were written.
+    uint32 Result = 0;
+    
+    uint32 Index = 0;
+    while(Index < Length)
+    {
+        uint32 Skip = GetLineContinuationLength(Text + Index);
+        if(Skip)
+        {
+            Index += Skip;
+        }
+        else
+        {
+            if(Result < DestinationSize)
+            {
+                Destination[Result] = Text[Index];
+            }
+            ++Result;
+            ++Index;
+        }
+    }
+    
+    return Result;
+}
+
+inline bool32
+TokenIs(token_buffer *Buffer, token_index Token, char *Test)
+{
+    bool32 Result = false;
+
+    uint32 Length = StringLength(Test);
+    if(GetTokenFlags(Buffer, Token) & TokenFlag_Spliced)
+    {
+        char *Text = GetTokenText(Buffer, Token);
+        uint32 TextLength = GetTokenLength(Buffer, Token);
+        
+        uint32 Index = 0;
+        char *At = Test;
+        while(Index < TextLength)
+        {
+            uint32 Skip = GetLineContinuationLength(Text + Index);
+            if(Skip)
+            {
+                Index += Skip;
+            }
+            else if(Text[Index] == *At)
+            {
+                ++Index;
+                ++At;
+            }
+            else
+            {
+                break;
+            }
+        }
+        
+        Result = ((Index == TextLength) && !*At);
+    }
+    else if(GetTokenLength(Buffer, Token) == Length)
+    {
+        Result = true;
+        
+        char *Text = GetTokenText(Buffer, Token);
+        for(uint32 Index = 0;
+            Index < Length;
+            ++Index)
+        {
+            if(Text[Index] != Test[Index])
+            {
+                Result = false;
+                break;
+            }
+        }
+    }
+    
+    return Result;
+}
+
+//
+// NOTE(felipe): Scanners
+//
+
+internal char *
+SkipBlanksScalar(char *At, bool32 *SawNewline)
+{
+    while(*At == ' ' || *At == '\t' || *At == '\n' || *At == '\r')
+    {
+        if(*At == '\n')
+        {
+            *SawNewline = true;
+        }
+        
+        ++At;
+    }
+    
+    return At;
+}
+
+internal char *
+FindNewlineScalar(char *At)
+{
+    while(*At && *At != '\n')
+    {
+        ++At;
+    }
+    
+    return At;
+}
+
+internal char *
+FindCommentEndScalar(char *At)
+{
+    while(*At && !(At[0] == '*' && At[1] == '/'))
+    {
+        ++At;
+    }
+    
+    return At;
+}
+
+#if CORSAC_X64
+
+// NOTE(felipe): The vector scanners only ever do aligned loads. An aligned
+// block never crosses a page boundary, so loading the block that holds the
+// NUL terminator is always safe, and the bytes before At are masked off.
+
+internal char *
+SkipBlanksSSE2(char *At, bool32 *SawNewline)
+{
+    // NOTE(felipe): Most runs are a single space between two tokens, or a
+    // newline plus indentation. Short runs are cheaper to skip one byte at
+    // a time than to set up a vector scan for.
+    for(uint32 Index = 0;
+        Index < 8 && (*At == ' ' || *At == '\t' || *At == '\n' || *At == '\r');
+        ++Index)
+    {
+        if(*At == '\n')
+        {
+            *SawNewline = true;
+        }
+        
+        ++At;
+    }
+    
+    char *Result = At;
+    
+    if(*At == ' ' || *At == '\t' || *At == '\n' || *At == '\r')
+    {
+        __m128i Space = _mm_set1_epi8(' ');
+        __m128i Tab = _mm_set1_epi8('\t');
+        __m128i Return = _mm_set1_epi8('\r');
+        __m128i Newline = _mm_set1_epi8('\n');
+        
+        char *Block = (char *)((memory_index)At & ~(memory_index)15);
+        uint32 ValidMask = (0xFFFF << (At - Block)) & 0xFFFF;
+        
+        for(;;)
+        {
+            __m128i Bytes = _mm_load_si128((__m128i *)Block);
+            __m128i IsNewline = _mm_cmpeq_epi8(Bytes, Newline);
+            __m128i IsBlank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Bytes, Space),
+                                                        _mm_cmpeq_epi8(Bytes, Tab)),
+                                           _mm_or_si128(_mm_cmpeq_epi8(Bytes, Return),
+                                                        IsNewline));
+            
+            uint32 NotBlankMask = ~(uint32)_mm_movemask_epi8(IsBlank) & ValidMask;
+            uint32 NewlineMask = (uint32)_mm_movemask_epi8(IsNewline) & ValidMask;
+            
+            if(NotBlankMask)
+            {
+                uint32 Index = FindLeastSignificantSetBit(NotBlankMask);
+                if(NewlineMask & ((1u << Index) - 1))
+                {
+                    *SawNewline = true;
+                }
+                
+                Result = Block + Index;
+                break;
+            }
+            
+            if(NewlineMask)
+            {
+                *SawNewline = true;
+            }
+            
+            Block += 16;
+            ValidMask = 0xFFFF;
+        }
+    }
+    
+    return Result;
+}
+
+internal char *
+FindNewlineSSE2(char *At)
+{
+    char *Result = 0;
+    
+    __m128i Zero = _mm_setzero_si128();
+    __m128i Newline = _mm_set1_epi8('\n');
+    
+    char *Block = (char *)((memory_index)At & ~(memory_index)15);
+    uint32 ValidMask = (0xFFFF << (At - Block)) & 0xFFFF;
+    
+    for(;;)
+    {
+        __m128i Bytes = _mm_load_si128((__m128i *)Block);
+        __m128i IsStop = _mm_or_si128(_mm_cmpeq_epi8(Bytes, Newline),
+                                      _mm_cmpeq_epi8(Bytes, Zero));
+        
+        uint32 StopMask = (uint32)_mm_movemask_epi8(IsStop) & ValidMask;
+        if(StopMask)
+        {
+            Result = Block + FindLeastSignificantSetBit(StopMask);
+            break;
+        }
+        
+        Block += 16;
+        ValidMask = 0xFFFF;
+    }
+    
+    return Result;
+}
+
+internal char *
+FindCommentEndSSE2(char *At)
+{
+    char *Result = 0;
+    
+    __m128i Zero = _mm_setzero_si128();
+    __m128i Star = _mm_set1_epi8('*');
+    __m128i Slash = _mm_set1_epi8('/');
+    
+    char *Block = (char *)((memory_index)At & ~(memory_index)15);
+    uint32 ValidMask = (0xFFFF << (At - Block)) & 0xFFFF;
+    
+    for(;;)
+    {
+        __m128i Bytes = _mm_load_si128((__m128i *)Block);
+        
+        uint32 StarMask = (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(Bytes, Star));
+        uint32 SlashMask = (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(Bytes, Slash));
+        uint32 NulMask = (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(Bytes, Zero));
+        
+        // NOTE(felipe): A '*' in the last byte pairs with the first byte of
+        // the next block, which is only safe to read if this block has no NUL.
+        uint32 PairMask = StarMask & (SlashMask >> 1);
+        if(!NulMask && (StarMask & 0x8000) && Block[16] == '/')
+        {
+            PairMask |= 0x8000;
+        }
+        
+        uint32 StopMask = (PairMask | NulMask) & ValidMask;
+        if(StopMask)
+        {
+            Result = Block + FindLeastSignificantSetBit(StopMask);
+            break;
+        }
+        
+        Block += 16;
+        ValidMask = 0xFFFF;
+    }
+    
+    return Result;
+}
+
+TARGET_AVX2 internal char *
+SkipBlanksAVX2(char *At, bool32 *SawNewline)
+{
+    // NOTE(felipe): Most runs are a single space between two tokens, or a
+    // newline plus indentation. Short runs are cheaper to skip one byte at
+    // a time than to set up a vector scan for.
+    for(uint32 Index = 0;
+        Index < 8 && (*At == ' ' || *At == '\t' || *At == '\n' || *At == '\r');
+        ++Index)
+    {
+        if(*At == '\n')
+        {
+            *SawNewline = true;
+        }
+        
+        ++At;
+    }
+    
+    char *Result = At;
+    
+    if(*At == ' ' || *At == '\t' || *At == '\n' || *At == '\r')
+    {
+        __m256i Space = _mm256_set1_epi8(' ');
+        __m256i Tab = _mm256_set1_epi8('\t');
+        __m256i Return = _mm256_set1_epi8('\r');
+        __m256i Newline = _mm256_set1_epi8('\n');
+        
+        char *Block = (char *)((memory_index)At & ~(memory_index)31);
+        uint32 ValidMask = 0xFFFFFFFF << (At - Block);
+        
+        for(;;)
+        {
+            __m256i Bytes = _mm256_load_si256((__m256i *)Block);
+            __m256i IsNewline = _mm256_cmpeq_epi8(Bytes, Newline);
+            __m256i IsBlank = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(Bytes, Space),
+                                                              _mm256_cmpeq_epi8(Bytes, Tab)),
+                                              _mm256_or_si256(_mm256_cmpeq_epi8(Bytes, Return),
+                                                              IsNewline));
+            
+            uint32 NotBlankMask = ~(uint32)_mm256_movemask_epi8(IsBlank) & ValidMask;
+            uint32 NewlineMask = (uint32)_mm256_movemask_epi8(IsNewline) & ValidMask;
+            
+            if(NotBlankMask)
+            {
+                uint32 Index = FindLeastSignificantSetBit(NotBlankMask);
+                if(NewlineMask & ((1u << Index) - 1))
+                {
+                    *SawNewline = true;
+                }
+                
+                Result = Block + Index;
+                break;
+            }
+            
+            if(NewlineMask)
+            {
+                *SawNewline = true;
+            }
+            
+            Block += 32;
+            ValidMask = 0xFFFFFFFF;
+        }
+    }
+    
+    return Result;
+}
+
+TARGET_AVX2 internal char *
+FindNewlineAVX2(char *At)
+{
+    char *Result = 0;
+    
+    __m256i Zero = _mm256_setzero_si256();
+    __m256i Newline = _mm256_set1_epi8('\n');
+    
+    char *Block = (char *)((memory_index)At & ~(memory_index)31);
+    uint32 ValidMask = 0xFFFFFFFF << (At - Block);
+    
+    for(;;)
+    {
+        __m256i Bytes = _mm256_load_si256((__m256i *)Block);
+        __m256i IsStop = _mm256_or_si256(_mm256_cmpeq_epi8(Bytes, Newline),
+                                         _mm256_cmpeq_epi8(Bytes, Zero));
+        
+        uint32 StopMask = (uint32)_mm256_movemask_epi8(IsStop) & ValidMask;
+        if(StopMask)
+        {
+            Result = Block + FindLeastSignificantSetBit(StopMask);
+            break;
+        }
+        
+        Block += 32;
+        ValidMask = 0xFFFFFFFF;
+    }
+    
+    return Result;
+}
+
+TARGET_AVX2 internal char *
+FindCommentEndAVX2(char *At)
+{
+    char *Result = 0;
+    
+    __m256i Zero = _mm256_setzero_si256();
+    __m256i Star = _mm256_set1_epi8('*');
+    __m256i Slash = _mm256_set1_epi8('/');
+    
+    char *Block = (char *)((memory_index)At & ~(memory_index)31);
+    uint32 ValidMask = 0xFFFFFFFF << (At - Block);
+    
+    for(;;)
+    {
+        __m256i Bytes = _mm256_load_si256((__m256i *)Block);
+        
+        uint32 StarMask = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(Bytes, Star));
+        uint32 SlashMask = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(Bytes, Slash));
+        uint32 NulMask = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(Bytes, Zero));
+        
+        uint32 PairMask = StarMask & (SlashMask >> 1);
+        if(!NulMask && (StarMask & 0x80000000) && Block[32] == '/')
+        {
+            PairMask |= 0x80000000;
+        }
+        
+        uint32 StopMask = (PairMask | NulMask) & ValidMask;
+        if(StopMask)
+        {
+            Result = Block + FindLeastSignificantSetBit(StopMask);
+            break;
+        }
+        
+        Block += 32;
+        ValidMask = 0xFFFFFFFF;
+    }
+    
+    return Result;
+}
+
+internal bool32
+CPUSupportsAVX2(void)
+{
+    bool32 Result = false;
+    
+    // NOTE(felipe): The CPU has to report AVX2, and the OS has to save the
+    // YMM registers on context switches (OSXSAVE + XCR0 bits 1 and 2).
+#if defined(_MSC_VER)
+    int Registers[4];
+    __cpuid(Registers, 0);
+    if(Registers[0] >= 7)
+    {
+        __cpuid(Registers, 1);
+        bool32 OSXSave = (Registers[2] & (1 << 27)) != 0;
+        bool32 AVX = (Registers[2] & (1 << 28)) != 0;
+        
+        __cpuidex(Registers, 7, 0);
+        bool32 AVX2 = (Registers[1] & (1 << 5)) != 0;
+        
+        if(OSXSave && AVX && AVX2)
+        {
+            Result = ((_xgetbv(0) & 6) == 6);
+        }
+    }
+#else
+    uint32 EAX, EBX, ECX, EDX;
+    if(__get_cpuid_max(0, 0) >= 7 && __get_cpuid(1, &EAX, &EBX, &ECX, &EDX))
+    {
+        bool32 OSXSave = (ECX & (1 << 27)) != 0;
+        bool32 AVX = (ECX & (1 << 28)) != 0;
+        
+        __cpuid_count(7, 0, EAX, EBX, ECX, EDX);
+        bool32 AVX2 = (EBX & (1 << 5)) != 0;
+        
+        if(OSXSave && AVX && AVX2)
+        {
+            uint32 XCR0Low, XCR0High;
+            __asm__ volatile("xgetbv" : "=a"(XCR0Low), "=d"(XCR0High) : "c"(0));
+            Result = ((XCR0Low & 6) == 6);
+        }
+    }
+#endif
+    
+    return Result;
+}
+
+#endif
+
+// NOTE(felipe): Fills Scanners from slowest to fastest, returns how many
+// this machine can run.
+internal uint32
+GetAvailableScanners(scanner *Scanners)
+{
+    uint32 Count = 0;
+    
+    scanner Scalar = {"scalar", SkipBlanksScalar, FindNewlineScalar, FindCommentEndScalar};
+    Scanners[Count++] = Scalar;
+    
+#if CORSAC_X64
+    // NOTE(felipe): SSE2 is part of x64 itself.
+    scanner SSE2 = {"sse2", SkipBlanksSSE2, FindNewlineSSE2, FindCommentEndSSE2};
+    Scanners[Count++] = SSE2;
+    
+    if(CPUSupportsAVX2())
+    {
+        scanner AVX2 = {"avx2", SkipBlanksAVX2, FindNewlineAVX2, FindCommentEndAVX2};
+        Scanners[Count++] = AVX2;
+    }
+#endif
+    
+    return Count;
+}
+
+// TODO(felipe): Remove globals.
+global_variable scanner GlobalScanner;
+
+internal void
+InitializeScanner(void)
+{
+    scanner Scanners[MAX_SCANNER_COUNT];
+    uint32 Count = GetAvailableScanners(Scanners);
+    
+    GlobalScanner = Scanners[Count - 1];
+}
+
+internal char *
+FindLineCommentEnd(char *At)
+{
+    // NOTE(felipe): At is past the "//". A line continuation carries the
+    // comment on to the next line, the newline scanners find every newline
+    // since the line table needs them all.
+    for(;;)
+    {
+        At = GlobalScanner.FindNewline(At);
+        
+        char *Before = At - 1;
+        if(*Before == '\r')
+        {
+            --Before;
+        }
+        
+        if(*At && (*Before == '\\'))
+        {
+            ++At;
+        }
+        else
+        {
+            break;
+        }
+    }
+    
+    return At;
+}
+
+// TODO(felipe): Remove globals.
+global_variable lexer_tables GlobalLexerTables;
+
+global_variable keyword_entry KeywordTable[KEYWORD_TABLE_SIZE] =
+{
+    [0] = {"sizeof", 6, Keyword_Sizeof},
+    [2] = {"char", 4, Keyword_Char},
+    [5] = {"default", 7, Keyword_Default},
+    [9] = {"else", 4, Keyword_Else},
+    [11] = {"do", 2, Keyword_Do},
+    [15] = {"goto", 4, Keyword_Goto},
+    [16] = {"long", 4, Keyword_Long},
+    [17] = {"union", 5, Keyword_Union},
+    [18] = {"if", 2, Keyword_If},
+    [19] = {"auto", 4, Keyword_Auto},
+    [25] = {"switch", 6, Keyword_Switch},
+    [32] = {"signed", 6, Keyword_Signed},
+    [33] = {"const", 5, Keyword_Const},
+    [36] = {"void", 4, Keyword_Void},
+    [37] = {"static", 6, Keyword_Static},
+    [39] = {"typedef", 7, Keyword_Typedef},
+    [41] = {"return", 6, Keyword_Return},
+    [42] = {"int", 3, Keyword_Int},
+    [43] = {"extern", 6, Keyword_Extern},
+    [44] = {"short", 5, Keyword_Short},
+    [45] = {"register", 8, Keyword_Register},
+    [47] = {"double", 6, Keyword_Double},
+    [49] = {"break", 5, Keyword_Break},
+    [50] = {"continue", 8, Keyword_Continue},
+    [51] = {"case", 4, Keyword_Case},
+    [52] = {"unsigned", 8, Keyword_Unsigned},
+    [56] = {"enum", 4, Keyword_Enum},
+    [57] = {"struct", 6, Keyword_Struct},
+    [58] = {"while", 5, Keyword_While},
+    [59] = {"volatile", 8, Keyword_Volatile},
+    [62] = {"for", 3, Keyword_For},
+    [63] = {"float", 5, Keyword_Float},
+};
+
+inline keyword
+LookupKeyword(char *Name, uint32 Length)
+{
+    keyword Result = Keyword_None;
+    
+    if(Length >= KEYWORD_MIN_LENGTH && Length <= KEYWORD_MAX_LENGTH)
+    {
+        uint32 Key = ((uint32)(uint8)Name[0] |
+                      ((uint32)(uint8)Name[1] << 8) |
+                      ((uint32)(uint8)Name[Length - 1] << 16) |
+                      (Length << 24));
+        keyword_entry *Entry = KeywordTable + ((Key*KEYWORD_HASH_MULTIPLIER) >> KEYWORD_HASH_SHIFT);
+        
+        if(Entry->Length == Length && !StringCompare(Name, Entry->Name, Length))
+        {
+            Result = Entry->Keyword;
+        }
+    }
+    
+    return Result;
+}
+
+// NOTE(felipe): Only ever used from the main thread, lexers that run on
+// other threads defer their atoms.
+global_variable memory_arena GlobalSpellingArena;
+
+internal atom
+InternSplicedName(char *Text, uint32 Length)
+{
+    temporary_memory Scratch = BeginTemporaryMemory(&GlobalSpellingArena);
+    
+    char *Spelling = (char *)PushSize(&GlobalSpellingArena, Length);
+    atom Result = InternAtom(Spelling, RemoveLineContinuations(Text, Length, Spelling, Length));
+    
+    EndTemporaryMemory(Scratch);
+    
+    return Result;
+}
+
+// NOTE(felipe): In punctuator order.
+global_variable char *Punctuators[PUNCTUATOR_COUNT] =
+{
+    "[", "]", "(", ")", "{", "}", ".", "->",
+    "++", "--", "&", "*", "+", "-", "~", "!",
+    "/", "%", "<<", ">>", "<", ">", "<=", ">=", "==", "!=",
+    "^", "|", "&&", "||", "?", ":", ";", "...",
+    "=", "*=", "/=", "%=", "+=", "-=", "<<=", ">>=", "&=", "^=", "|=",
+    ",", "#", "##",
+};
+
+internal char *
+GetKindName(uint32 Kind)
+{
+    // NOTE(felipe): Keyword atoms are their keywords.
+    char *Result = 0;
+    if(Kind >= Keyword_Count)
+    {
+        Assert(Kind < Punctuator_Count);
+        Result = Punctuators[Kind - Keyword_Count];
+    }
+    else
+    {
+        Result = GetAtomString(Kind);
+    }
+    
+    return Result;
+}
+
+internal void
+InitializeLexer(void)
+{
+    lexer_tables *Tables = &GlobalLexerTables;
+    
+    // NOTE(felipe): Character classes.
+    for(uint32 Character = 0;
+        Character < 256;
+        ++Character)
+    {
+        uint8 Class = CharClass_Invalid;
+        
+        if(Character == 0)
+        {
+            Class = CharClass_Null;
+        }
+        else if(Character == ' ' || Character == '\t' || Character == '\n' || Character == '\r' ||
+                Character == '\v' || Character == '\f')
+        {
+            Class = CharClass_Blank;
+        }
+        else if((Character >= 'a' && Character <= 'z') ||
+                (Character >= 'A' && Character <= 'Z') ||
+                Character == '_')
+        {
+            Class = CharClass_Letter | CHAR_FLAG_IDENTIFIER;
+        }
+        else if(Character >= '0' && Character <= '9')
+        {
+            Class = CharClass_Digit | CHAR_FLAG_IDENTIFIER;
+        }
+        else if(Character == '\'')
+        {
+            Class = CharClass_Quote;
+        }
+        else if(Character == '"')
+        {
+            Class = CharClass_DoubleQuote;
+        }
+        else if(Character == '\\')
+        {
+            Class = CharClass_Backslash;
+        }
+        
+        Tables->CharClass[Character] = Class;
+    }
+    
+    for(uint32 Index = 0;
+        Index < PUNCTUATION_CHARACTER_COUNT;
+        ++Index)
+    {
+        uint8 Character = (uint8)PUNCTUATION_CHARACTERS[Index];
+        Tables->CharClass[Character] = (uint8)(CharClass_Punctuation + Index);
+    }
+    
+    char SkipStops[] = {'\0', '\n', '\\', '/', '\'', '"'};
+    for(uint32 Index = 0;
+        Index < ArrayCount(SkipStops);
+        ++Index)
+    {
+        Tables->SkipStops[(uint8)SkipStops[Index]] = true;
+    }
+    
+    // NOTE(felipe): Punctuator state machine, one state per prefix of every
+    // punctuator. State 0 rejects and state 1 is the start state.
+    Tables->PunctuatorStateCount = 2;
+    for(uint32 PunctuatorIndex = 0;
+        PunctuatorIndex < ArrayCount(Punctuators);
+        ++PunctuatorIndex)
+    {
+        uint32 State = 1;
+        for(char *Character = Punctuators[PunctuatorIndex];
+            *Character;
+            ++Character)
+        {
+            uint32 Column = (Tables->CharClass[(uint8)*Character] & CHAR_CLASS_MASK) - CharClass_Punctuation;
+            Assert(Column < PUNCTUATION_CHARACTER_COUNT);
+            
+            if(!Tables->PunctuatorNext[State][Column])
+            {
+                Assert(Tables->PunctuatorStateCount < MAX_PUNCTUATOR_STATE_COUNT);
+                Tables->PunctuatorNext[State][Column] = Tables->PunctuatorStateCount++;
+            }
+            
+            State = Tables->PunctuatorNext[State][Column];
+        }
+        
+        Tables->PunctuatorAccepts[State] = (uint8)(Keyword_Count + PunctuatorIndex);
+    }
+    
+#if CORSAC_SLOW
+    // NOTE(felipe): Every keyword has to hash to its own slot.
+    uint32 KeywordCount = 0;
+    for(uint32 Slot = 0;
+        Slot < KEYWORD_TABLE_SIZE;
+        ++Slot)
+    {
+        keyword_entry *Entry = KeywordTable + Slot;
+        if(Entry->Name)
+        {
+            Assert(Entry->Length == StringLength(Entry->Name));
+            Assert(LookupKeyword(Entry->Name, Entry->Length) == Entry->Keyword);
+            ++KeywordCount;
+        }
+    }
+    Assert(KeywordCount == Keyword_Count - 1);
+#endif
+    
+    // NOTE(felipe): Keywords take the first atoms, in keyword order.
+    for(keyword Keyword = Keyword_None + 1;
+        Keyword < Keyword_Count;
+        ++Keyword)
+    {
+        for(uint32 Slot = 0;
+            Slot < KEYWORD_TABLE_SIZE;
+            ++Slot)
+        {
+            keyword_entry *Entry = KeywordTable + Slot;
+            if(Entry->Name && Entry->Keyword == Keyword)
+            {
+                if(InternAtom(Entry->Name, Entry->Length) != (atom)Keyword)
+                {
+                    InvalidCodePath;
+                }
+            }
+        }
+    }
+    
+    InitializeScanner();
+}
+
+inline uint32
+GetLeadingTokenFlags(bool32 AtBeginningOfLine, bool32 SpaceBefore)
+{
+    uint32 Result = 0;
+    if(AtBeginningOfLine)
+    {
+        Result = TokenFlag_AtBeginningOfLine|TokenFlag_SpaceBefore;
+    }
+    else if(SpaceBefore)
+    {
+        Result = TokenFlag_SpaceBefore;
+    }
+    
+    return Result;
+}
+
+internal void
+LexerError(lexer *Lexer, char *At, char *Message)
+{
+    // NOTE(felipe): A speculative lexer may have started in the middle of a
+    // comment or a string, its errors are not real until proven otherwise.
+    if(Lexer->Speculative)
+    {
+        Lexer->Failed = true;
+    }
+    else
+    {
+        loaded_file *File = Lexer->File;
+        ErrorAt(File->BaseLocation + (uint32)(At - (char *)File->Memory), "%s", Message);
+    }
+}
+
+internal lexer
+BeginLexer(loaded_file *File)
+{
+    lexer Result = {0};
+    
+    Result.File = File;
+    Result.At = (char *)File->Memory;
+    Result.End = Result.At + File->Size + 1;
+    Result.AtBeginningOfLine = true;
+    
+    Assert(Result.At);
+    
+    return Result;
+}
+
+internal void
+LexTokens(lexer *Lexer, token_buffer *Buffer, uint32 MaxCount)
+{
+    // NOTE(felipe): Pushes up to MaxCount tokens, the EOF token included.
+    lexer_tables *Tables = &GlobalLexerTables;
+    
+    loaded_file *File = Lexer->File;
+    char *Memory = (char *)File->Memory;
+    
+    char *Iterator = Lexer->At;
+    bool32 AtBeginningOfLine = Lexer->AtBeginningOfLine;
+    bool32 SpaceBefore = Lexer->SpaceBefore;
+    
+    uint32 Produced = 0;
+    while(!Lexer->ReachedEOF && !Lexer->Failed && (Produced < MaxCount))
+    {
+        // NOTE(felipe): Skip space and new lines.
+        char *BlanksStart = Iterator;
+        Iterator = GlobalScanner.SkipBlanks(Iterator, &AtBeginningOfLine);
+        SpaceBefore |= (Iterator != BlanksStart);
+        
+        // NOTE(felipe): Ignore comments.
+        if(Iterator[0] == '/' && Iterator[1] == '/')
+        {
+            Iterator = FindLineCommentEnd(Iterator + 2);
+            SpaceBefore = true;
+            continue;
+        }
+        else if(Iterator[0] == '/' && Iterator[1] == '*')
+        {
+            char *CommentStart = Iterator;
+            Iterator = GlobalScanner.FindCommentEnd(Iterator + 2);
+            if(!*Iterator)
+            {
+                LexerError(Lexer, CommentStart, "unclosed comment");
+                break;
+            }
+            
+            Iterator += 2;
+            SpaceBefore = true;
+            continue;
+        }
+        
+        if(Iterator >= Lexer->End)
+        {
+            // NOTE(felipe): End of a chunk, what follows belongs to the next
+            // one.
+            Lexer->ReachedEOF = true;
+            break;
+        }
+        
+        uint8 Class = Tables->CharClass[(uint8)*Iterator] & CHAR_CLASS_MASK;
+        if(Class == CharClass_Null)
+        {
+            // NOTE(felipe): Last token is EOF, it sits past the end of the
+            // file and ends whatever line came before it.
+            PushToken(Buffer, TokenType_EOF, File->BaseLocation + (uint32)(Iterator - Memory), 0,
+                      TokenFlag_AtBeginningOfLine);
+            Lexer->ReachedEOF = true;
+            
+            break;
+        }
+        else if(Class == CharClass_Backslash)
+        {
+            // NOTE(felipe): Line continuation, the newline is ignored.
+            ++Iterator;
+            
+            bool32 ValidSequence = false;
+            if(*Iterator == '\r')
+            {
+                ValidSequence = true;
+                ++Iterator;
+            }
+            if(*Iterator == '\n')
+            {
+                ValidSequence = true;
+                ++Iterator;
+            }
+            
+            if(!ValidSequence)
+            {
+                LexerError(Lexer, Iterator - 1, "illegal escape sequence");
+            }
+            
+            continue;
+        }
+        else if(Class == CharClass_Blank)
+        {
+            // NOTE(felipe): '\v' and '\f', the scanner only skips the
+            // common blanks.
+            ++Iterator;
+            continue;
+        }
+        
+        char *Start = Iterator;
+        token_type Type = TokenType_Punctuation;
+        uint32 Value = 0;
+        uint32 Flags = 0;
+        uint64 NumericalValue = 0;
+        
+        switch(Class)
+        {
+            case CharClass_Letter:
+            {
+                // NOTE(felipe): Token is an Identifier or Keyword.
+                uint32 Hash = ATOM_HASH_SEED;
+                for(;;)
+                {
+                    do
+                    {
+                        Hash = AtomHashStep(Hash, *Iterator);
+                        ++Iterator;
+                    } while(Tables->CharClass[(uint8)*Iterator] & CHAR_FLAG_IDENTIFIER);
+                    
+                    // NOTE(felipe): A line continuation does not end a name.
+                    uint32 Skip = GetLineContinuationLength(Iterator);
+                    if(Skip && (Tables->CharClass[(uint8)Iterator[Skip]] & CHAR_FLAG_IDENTIFIER))
+                    {
+                        Iterator += Skip;
+                        Flags = TokenFlag_Spliced;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+                
+                uint32 Length = SafeTruncateUInt64(Iterator - Start);
+                if(Flags & TokenFlag_Spliced)
+                {
+                    char Name[KEYWORD_MAX_LENGTH];
+                    Value = LookupKeyword(Name, RemoveLineContinuations(Start, Length, Name, ArrayCount(Name)));
+                }
+                else
+                {
+                    Value = LookupKeyword(Start, Length);
+                }
+                Type = Value ? TokenType_Keyword : TokenType_Identifier;
+                
+                if(!Value && !Lexer->DeferAtoms)
+                {
+                    Value = (Flags & TokenFlag_Spliced) ? InternSplicedName(Start, Length) : InternHashedAtom(Start, Length, Hash);
+                }
+            } break;
+            
+            case CharClass_Digit:
+            {
+                // NOTE(felipe): Token is a number, StringToNumber rejects
+                // anything that is not a decimal, octal or hexadecimal
+                // integer.
+                Type = TokenType_Number;
+                
+                do
+                {
+                    ++Iterator;
+                } while(Tables->CharClass[(uint8)*Iterator] & CHAR_FLAG_IDENTIFIER);
+                
+                bool32 Valid = true;
+                NumericalValue = StringToNumber(Start, SafeTruncateUInt64(Iterator - Start), &Valid);
+                if(!Valid)
+                {
+                    LexerError(Lexer, Start, "not a valid number");
+                }
+            } break;
+            
+            case CharClass_Quote:
+            {
+                Type = TokenType_Number;
+                
+                // TODO(felipe): Multi-character constant? (C99 spec. 6.4.4.4p10).
+                ++Iterator;
+                if(*Iterator == '\\' && Iterator[1])
+                {
+                    ++Iterator;
+                    
+                    bool32 Valid = true;
+                    NumericalValue = EscapedCharacter(*Iterator, &Valid);
+                    if(!Valid)
+                    {
+                        LexerError(Lexer, Iterator - 1, "unknown escape sequence");
+                    }
+                }
+                else if(*Iterator != '\'' && *Iterator != '\n' && *Iterator)
+                {
+                    NumericalValue = (uint8)*Iterator;
+                }
+                else
+                {
+                    LexerError(Lexer, Start, "invalid constant char");
+                    break;
+                }
+                ++Iterator;
+                
+                if(*Iterator != '\'')
+                {
+                    LexerError(Lexer, Start, "invalid constant char");
+                    break;
+                }
+                ++Iterator;
+            } break;
+            
+            case CharClass_DoubleQuote:
+            {
+                // NOTE(felipe): The token keeps its quotes.
+                Type = TokenType_String;
+                
+                ++Iterator;
+                while(*Iterator != '"')
+                {
+                    if(*Iterator == '\\' && Iterator[1])
+                    {
+                        ++Iterator;
+                    }
+                    else if(*Iterator == '\n' || !*Iterator)
+                    {
+                        LexerError(Lexer, Start, "unterminated string");
+                        break;
+                    }
+                    
+                    ++Iterator;
+                }
+                
+                if(*Iterator == '"')
+                {
+                    ++Iterator;
+                }
+            } break;
+            
+            case CharClass_Invalid:
+            {
+                LexerError(Lexer, Iterator, "invalid character");
+            } break;
+            
+            default:
+            {
+                // NOTE(felipe): Longest punctuator that matches, e.i. '<<='
+                // before '<<' before '<'. Every single character is a
+                // punctuator, so End always moves.
+                char *End = Iterator;
+                uint32 State = 1;
+                for(;;)
+                {
+                    uint32 Column = (Tables->CharClass[(uint8)*Iterator] & CHAR_CLASS_MASK) - CharClass_Punctuation;
+                    if(Column >= PUNCTUATION_CHARACTER_COUNT)
+                    {
+                        break;
+                    }
+                    
+                    State = Tables->PunctuatorNext[State][Column];
+                    if(!State)
+                    {
+                        break;
+                    }
+                    
+                    ++Iterator;
+                    if(Tables->PunctuatorAccepts[State])
+                    {
+                        End = Iterator;
+                        Value = Tables->PunctuatorAccepts[State];
+                    }
+                }
+                
+                Iterator = End;
+            } break;
+        }
+        
+        token_index Token = PushToken(Buffer, Type, File->BaseLocation + (uint32)(Start - Memory),
+                                      (uint32)(Iterator - Start),
+                                      Flags|GetLeadingTokenFlags(AtBeginningOfLine, SpaceBefore));
+        
+        if(Type == TokenType_Number)
+        {
+            Value = PushLiteral(Buffer, NumericalValue);
+        }
+        SetTokenValue(Buffer, Token, Value);
+        
+        ++Produced;
+        
+        if(AtBeginningOfLine && Lexer->StopAfterDirectives)
+        {
+            bool32 EndsDirective = Lexer->InDirective;
+            Lexer->InDirective = ((Type == TokenType_Punctuation) && (Value == Punctuator_Hash));
+            
+            if(EndsDirective)
+            {
+                AtBeginningOfLine = false;
+                SpaceBefore = false;
+                break;
+            }
+        }
+        
+        AtBeginningOfLine = false;
+        SpaceBefore = false;
+    }
+    
+    Lexer->At = Iterator;
+    Lexer->AtBeginningOfLine = AtBeginningOfLine;
+    Lexer->SpaceBefore = SpaceBefore;
+}
+
+internal token_buffer *
+Tokenize(memory_arena *Arena, loaded_file *File)
+{
+    // NOTE(felipe): Every token takes at least one byte and every number
+    // literal at least two with its separator, so these capacities never
+    // grow. The buffer is trimmed to its real size at the end.
+    uint32 FileSize = SafeTruncateUInt64(File->Size);
+    token_buffer *Buffer = NewTokenBuffer(Arena, FileSize + 1, FileSize/2 + 1);
+    
+    lexer Lexer = BeginLexer(File);
+    LexTokens(&Lexer, Buffer, FileSize + 1);
+    Assert(Lexer.ReachedEOF);
+    
+    TrimTokenBuffer(Buffer);
+
+    return Buffer;
+}
+
+internal char *
+FindChunkStart(char *At, char *End)
+{
+    // NOTE(felipe): First line start at or after At that is not joined to
+    // the line before it by a backslash.
+    char *Result = End;
+    for(;
+        At < End;
+        ++At)
+    {
+        if(*At == '\n')
+        {
+            char *Before = At - 1;
+            if(*Before == '\r')
+            {
+                --Before;
+            }
+            
+            if(*Before != '\\')
+            {
+                Result = At + 1;
+                break;
+            }
+        }
+    }
+    
+    return Result;
+}
+
+internal
+PLATFORM_WORK_QUEUE_CALLBACK(LexChunkWork)
+{
+    lex_chunk *Chunk = (lex_chunk *)Data;
+    lexer *Lexer = &Chunk->Lexer;
+    token_buffer *Tokens = &Chunk->Tokens;
+    
+    for(;;)
+    {
+        LexTokens(Lexer, Tokens, Tokens->Capacity - Tokens->Count);
+        if(!Lexer->Failed)
+        {
+            break;
+        }
+        
+        // NOTE(felipe): Errors usually mean the chunk started in a comment,
+        // so start over at the next line. Tokens from before the error are
+        // kept, the lexer of the previous chunk may still agree with them.
+        Lexer->At = FindChunkStart(Lexer->At, Lexer->End);
+        Lexer->AtBeginningOfLine = true;
+        Lexer->Failed = false;
+        Chunk->ValidFrom = Tokens->Count;
+        
+        if(Lexer->At >= Lexer->End)
+        {
+            Lexer->ReachedEOF = true;
+            break;
+        }
+    }
+}
+
+internal
+PLATFORM_WORK_QUEUE_CALLBACK(RemapChunkLiteralsWork)
+{
+    // NOTE(felipe): Number tokens point to their literal, which moves.
+    lex_chunk *Chunk = (lex_chunk *)Data;
+    token_buffer *Tokens = &Chunk->Tokens;
+    
+    uint32 LiteralOffset = Chunk->OutputLiteral - Chunk->FirstLiteral;
+    if(LiteralOffset)
+    {
+        for(uint32 Slot = Chunk->FirstToken;
+            Slot < Tokens->Count;
+            ++Slot)
+        {
+            if(Tokens->Types[Slot] == TokenType_Number)
+            {
+                Tokens->Values[Slot] += LiteralOffset;
+            }
+        }
+    }
+}
+
+internal
+PLATFORM_WORK_QUEUE_CALLBACK(PackChunksWork)
+{
+    // NOTE(felipe): Moves the good part of every chunk down to where it goes
+    // in one of the arrays, in order, so nothing is overwritten before it
+    // moved. What the chunk wrote and is not part of the result is zeroed
+    // before the next chunk moves over it.
+    pack_chunks_work *Work = (pack_chunks_work *)Data;
+    uint32 ElementSize = Work->ElementSize;
+    
+    for(uint32 ChunkIndex = 0;
+        ChunkIndex < Work->ChunkCount;
+        ++ChunkIndex)
+    {
+        lex_chunk *Chunk = Work->Chunks + ChunkIndex;
+        
+        uint32 Slice = Chunk->SliceToken;
+        uint32 From = Slice + Chunk->FirstToken;
+        uint32 To = Chunk->OutputToken;
+        uint32 Count = Chunk->Tokens.Count - Chunk->FirstToken;
+        uint32 WrittenEnd = Slice + Chunk->WrittenCount;
+        if(Work->Literals)
+        {
+            Slice = Chunk->SliceLiteral;
+            From = Slice + Chunk->FirstLiteral;
+            To = Chunk->OutputLiteral;
+            Count = Chunk->Tokens.LiteralCount - Chunk->FirstLiteral;
+            WrittenEnd = Slice + Chunk->WrittenLiteralCount;
+        }
+        
+        if(From != To)
+        {
+            CopyDown(Work->Array + To*ElementSize, Work->Array + From*ElementSize, Count*ElementSize);
+        }
+        
+        uint32 StaleStart = (Slice > To + Count) ? Slice : (To + Count);
+        if(StaleStart < WrittenEnd)
+        {
+            ZeroSize(Work->Array + StaleStart*ElementSize, (WrittenEnd - StaleStart)*ElementSize);
+        }
+    }
+}
+
+internal token_buffer *
+TokenizeParallel(memory_arena *Arena, loaded_file *File, platform_work_queue *Queue, uint32 ChunkCount)
+{
+    // NOTE(felipe): Produces the same buffer as Tokenize. Chunks are lexed
+    // speculatively in parallel, then walked in order: lexing of the file
+    // reaches a chunk at the point where the chunk before it stopped, and
+    // the chunk is good from the first token it lexed at that point on. A
+    // chunk that never lexed a token there, e.g. because it started inside
+    // a comment, or that hit an error after it, is lexed again from that
+    // point.
+    // NOTE(felipe): Returns 0 if the file has a lexer error. Whether the
+    // error is real depends on the conditionals around it, which only the
+    // preprocessor knows, so the file has to be lexed on demand instead.
+    char *Memory = (char *)File->Memory;
+    uint32 FileSize = SafeTruncateUInt64(File->Size);
+    
+    uint32 MaxChunkCount = FileSize / LEX_CHUNK_MIN_SIZE + 1;
+    if(ChunkCount > MaxChunkCount)
+    {
+        ChunkCount = MaxChunkCount;
+    }
+    if(ChunkCount > MAX_LEX_CHUNK_COUNT)
+    {
+        ChunkCount = MAX_LEX_CHUNK_COUNT;
+    }
+    if(ChunkCount == 0)
+    {
+        ChunkCount = 1;
+    }
+    
+    // NOTE(felipe): Sized for the worst case like Tokenize, plus one literal
+    // per chunk for the rounding. Every chunk lexes into the part of the
+    // arrays that starts at the offset of its first byte, where its worst
+    // case fits too.
+    temporary_memory ResultMemory = BeginTemporaryMemory(Arena);
+    token_buffer *Result = NewTokenBuffer(Arena, FileSize + 1, FileSize/2 + ChunkCount + 1);
+    lex_chunk Chunks[MAX_LEX_CHUNK_COUNT];
+    
+    // NOTE(felipe): The NUL terminator belongs to the last chunk.
+    char *FileEnd = Memory + FileSize + 1;
+    char *Start = Memory;
+    uint32 SliceLiteral = 0;
+    uint32 UsedChunkCount = 0;
+    for(uint32 ChunkIndex = 0;
+        (ChunkIndex < ChunkCount) && (Start < FileEnd);
+        ++ChunkIndex)
+    {
+        char *End = FileEnd;
+        if(ChunkIndex + 1 < ChunkCount)
+        {
+            char *Split = Memory + (uint64)FileSize*(ChunkIndex + 1)/ChunkCount;
+            if(Split <= Start)
+            {
+                Split = Start + 1;
+            }
+            
+            End = FindChunkStart(Split, FileEnd - 1);
+            if(End >= FileEnd - 1)
+            {
+                End = FileEnd;
+            }
+        }
+        
+        uint32 ChunkSize = (uint32)(End - Start);
+        uint32 SliceToken = (uint32)(Start - Memory);
+        
+        lex_chunk *Chunk = Chunks + UsedChunkCount++;
+        lex_chunk Empty = {0};
+        *Chunk = Empty;
+        
+        Chunk->Lexer = BeginLexer(File);
+        Chunk->Lexer.At = Start;
+        Chunk->Lexer.End = End;
+        Chunk->Lexer.Speculative = true;
+        Chunk->Lexer.DeferAtoms = true;
+        
+        token_buffer *Tokens = &Chunk->Tokens;
+        Tokens->Arena = Arena;
+        Tokens->Capacity = ChunkSize;
+        Tokens->Types = Result->Types + SliceToken;
+        Tokens->Flags = Result->Flags + SliceToken;
+        Tokens->Locations = Result->Locations + SliceToken;
+        Tokens->Lengths = Result->Lengths + SliceToken;
+        Tokens->Values = Result->Values + SliceToken;
+        Tokens->LiteralCapacity = ChunkSize/2 + 1;
+        Tokens->Literals = Result->Literals + SliceLiteral;
+        
+        Chunk->SliceToken = SliceToken;
+        Chunk->SliceLiteral = SliceLiteral;
+        
+        SliceLiteral += Tokens->LiteralCapacity;
+        Start = End;
+    }
+    Assert(SliceLiteral <= Result->LiteralCapacity);
+    
+    for(uint32 ChunkIndex = 0;
+        ChunkIndex < UsedChunkCount;
+        ++ChunkIndex)
+    {
+        PlatformAddWorkEntry(Queue, LexChunkWork, Chunks + ChunkIndex);
+    }
+    PlatformCompleteAllWork(Queue);
+    
+    // NOTE(felipe): Stitch the chunks together.
+    char *Resume = Memory;
+    bool32 ResumeAtBeginningOfLine = true;
+    bool32 ResumeSpaceBefore = false;
+    bool32 ReachedEOF = false;
+    uint32 TokenCount = 0;
+    uint32 LiteralCount = 0;
+    for(uint32 ChunkIndex = 0;
+        ChunkIndex < UsedChunkCount;
+        ++ChunkIndex)
+    {
+        lex_chunk *Chunk = Chunks + ChunkIndex;
+        token_buffer *Tokens = &Chunk->Tokens;
+        
+        Chunk->WrittenCount = Tokens->Count;
+        Chunk->WrittenLiteralCount = Tokens->LiteralCount;
+        
+        if(ReachedEOF || (Resume >= Chunk->Lexer.End))
+        {
+            // NOTE(felipe): A token or comment of an earlier chunk covered
+            // this one entirely.
+            Chunk->FirstToken = Tokens->Count;
+            Chunk->FirstLiteral = Tokens->LiteralCount;
+            Chunk->OutputToken = TokenCount;
+            Chunk->OutputLiteral = LiteralCount;
+            
+            continue;
+        }
+        
+        source_location ResumeLocation = File->BaseLocation + (uint32)(Resume - Memory);
+        
+        // NOTE(felipe): Locations are sorted, look for the resume point.
+        uint32 Low = 0;
+        uint32 High = Tokens->Count;
+        while(Low < High)
+        {
+            uint32 Middle = Low + (High - Low)/2;
+            if(Tokens->Locations[Middle] < ResumeLocation)
+            {
+                Low = Middle + 1;
+            }
+            else
+            {
+                High = Middle;
+            }
+        }
+        
+        // NOTE(felipe): Tokens lexed before the last error are only good up
+        // to it, they cannot be where the file is in sync.
+        bool32 InSync = ((Low < Tokens->Count) && (Low >= Chunk->ValidFrom) &&
+                         (Tokens->Locations[Low] == ResumeLocation));
+        if(!InSync)
+        {
+            Tokens->Count = 0;
+            Tokens->LiteralCount = 0;
+            
+            char *End = Chunk->Lexer.End;
+            Chunk->Lexer = BeginLexer(File);
+            Chunk->Lexer.At = Resume;
+            Chunk->Lexer.End = End;
+            Chunk->Lexer.AtBeginningOfLine = ResumeAtBeginningOfLine;
+            Chunk->Lexer.SpaceBefore = ResumeSpaceBefore;
+            Chunk->Lexer.Speculative = true;
+            Chunk->Lexer.DeferAtoms = true;
+            LexTokens(&Chunk->Lexer, Tokens, Tokens->Capacity);
+            
+            if(Chunk->Lexer.Failed)
+            {
+                // NOTE(felipe): The lexer is in sync here, so this is an
+                // error of the file itself.
+                EndTemporaryMemory(ResultMemory);
+                Result = 0;
+                break;
+            }
+            
+            if(Chunk->WrittenCount < Tokens->Count)
+            {
+                Chunk->WrittenCount = Tokens->Count;
+            }
+            if(Chunk->WrittenLiteralCount < Tokens->LiteralCount)
+            {
+                Chunk->WrittenLiteralCount = Tokens->LiteralCount;
+            }
+            
+            Low = 0;
+        }
+        
+        Chunk->FirstToken = Low;
+        Chunk->FirstLiteral = 0;
+        for(uint32 Slot = 0;
+            Slot < Low;
+            ++Slot)
+        {
+            if(Tokens->Types[Slot] == TokenType_Number)
+            {
+                ++Chunk->FirstLiteral;
+            }
+        }
+        
+        if(Low < Tokens->Count)
+        {
+            // NOTE(felipe): The chunk lexed its first token as if it
+            // started a line.
+            if(Tokens->Types[Low] != TokenType_EOF)
+            {
+                Tokens->Flags[Low] = (uint8)((Tokens->Flags[Low] & TokenFlag_Spliced) |
+                                             GetLeadingTokenFlags(ResumeAtBeginningOfLine, ResumeSpaceBefore));
+            }
+            
+            ReachedEOF = (Tokens->Types[Tokens->Count - 1] == TokenType_EOF);
+        }
+        
+        Chunk->OutputToken = TokenCount;
+        Chunk->OutputLiteral = LiteralCount;
+        TokenCount += Tokens->Count - Chunk->FirstToken;
+        LiteralCount += Tokens->LiteralCount - Chunk->FirstLiteral;
+        
+        Resume = Chunk->Lexer.At;
+        ResumeAtBeginningOfLine = Chunk->Lexer.AtBeginningOfLine;
+        ResumeSpaceBefore = Chunk->Lexer.SpaceBefore;
+    }
+    if(Result)
+    {
+        Assert(ReachedEOF);
+    
+        for(uint32 ChunkIndex = 0;
+            ChunkIndex < UsedChunkCount;
+            ++ChunkIndex)
+        {
+            PlatformAddWorkEntry(Queue, RemapChunkLiteralsWork, Chunks + ChunkIndex);
+        }
+        PlatformCompleteAllWork(Queue);
+    
+        // NOTE(felipe): Every array is packed on its own.
+        pack_chunks_work Packs[6] =
+            {
+                {Chunks, UsedChunkCount, (uint8 *)Result->Types, sizeof(uint8), false},
+                {Chunks, UsedChunkCount, (uint8 *)Result->Flags, sizeof(uint8), false},
+                {Chunks, UsedChunkCount, (uint8 *)Result->Locations, sizeof(source_location), false},
+                {Chunks, UsedChunkCount, (uint8 *)Result->Lengths, sizeof(uint32), false},
+                {Chunks, UsedChunkCount, (uint8 *)Result->Values, sizeof(uint32), false},
+                {Chunks, UsedChunkCount, (uint8 *)Result->Literals, sizeof(uint64), true},
+            };
+        for(uint32 PackIndex = 0;
+            PackIndex < ArrayCount(Packs);
+            ++PackIndex)
+        {
+            PlatformAddWorkEntry(Queue, PackChunksWork, Packs + PackIndex);
+        }
+        PlatformCompleteAllWork(Queue);
+    
+        Result->Count = TokenCount;
+        Result->LiteralCount = LiteralCount;
+        TrimTokenBuffer(Result);
+    
+        // NOTE(felipe): Atoms are numbered in the order names are first seen, so
+        // they are interned here, in file order.
+        for(uint32 Slot = 0;
+            Slot < TokenCount;
+            ++Slot)
+        {
+            if(Result->Types[Slot] == TokenType_Identifier)
+            {
+                char *Text = Memory + (Result->Locations[Slot] - File->BaseLocation);
+                if(Result->Flags[Slot] & TokenFlag_Spliced)
+                {
+                    Result->Values[Slot] = InternSplicedName(Text, Result->Lengths[Slot]);
+                }
+                else
+                {
+                    Result->Values[Slot] = InternAtom(Text, Result->Lengths[Slot]);
+                }
+            }
+        }
+        
+        KeepTemporaryMemory(ResultMemory);
+    }
+    
+    return Result;
+}
+
+internal void
+FillFromLexer(token_buffer *Buffer, void *Context)
+{
+    lexer *Lexer = (lexer *)Context;
+    
+    // NOTE(felipe): Readers stop at EOF, but keep answering with EOF in case
+    // one looks further ahead.
+    if(Lexer->ReachedEOF)
+    {
+        loaded_file *File = Lexer->File;
+        PushToken(Buffer, TokenType_EOF, File->BaseLocation + SafeTruncateUInt64(File->Size), 0,
+                  TokenFlag_AtBeginningOfLine);
+    }
+    else
+    {
+        LexTokens(Lexer, Buffer, LEXER_FILL_COUNT);
+    }
+}
+
+internal void
+RewindLexer(lexer *Lexer, token_buffer *Buffer, token_index Token)
+{
+    // NOTE(felipe): Drops Token and the tokens lexed after it, the lexer
+    // goes on from the text of Token. Token has to start a line.
+    uint32 Slot = GetTokenSlot(Buffer, Token);
+    Assert(Buffer->Flags[Slot] & TokenFlag_AtBeginningOfLine);
+    
+    Lexer->At = GetTokenText(Buffer, Token);
+    Lexer->AtBeginningOfLine = true;
+    Lexer->SpaceBefore = false;
+    Lexer->ReachedEOF = false;
+    Lexer->InDirective = false;
+    
+    for(uint32 Dropped = Slot;
+        Dropped < Buffer->Count;
+        ++Dropped)
+    {
+        if(Buffer->Types[Dropped] == TokenType_Number)
+        {
+            Buffer->LiteralCount = Buffer->Values[Dropped];
+            break;
+        }
+    }
+    Buffer->Count = Slot;
+}
+
+inline bool32
+NameIs(char *Name, uint32 Length, char *Test)
+{
+    bool32 Result = (StringLength(Test) == Length);
+    for(uint32 Index = 0;
+        Result && (Index < Length);
+        ++Index)
+    {
+        Result = (Name[Index] == Test[Index]);
+    }
+    
+    return Result;
+}
+
+internal void
+SkipConditionalGroup(lexer *Lexer)
+{
+    // NOTE(felipe): The lexer is at the beginning of the first line of a
+    // group that was not taken. Moves it to the '#' of the #elif, #else or
+    // #endif that ends the group, or to the end of the file, without making
+    // any tokens. Only comments, quotes, line continuations and the names of
+    // directives are looked at, nested conditionals are skipped whole.
+    lexer_tables *Tables = &GlobalLexerTables;
+    
+    char *At = Lexer->At;
+    char *Directive = 0;
+    uint32 Depth = 0;
+    while(!Directive && *At)
+    {
+        // NOTE(felipe): At is at the beginning of a line.
+        while(*At == ' ' || *At == '\t' || *At == '\r' || *At == '\v' || *At == '\f')
+        {
+            ++At;
+        }
+        
+        if(*At == '#')
+        {
+            char *Hash = At;
+            
+            ++At;
+            for(;;)
+            {
+                uint32 Skip = GetLineContinuationLength(At);
+                if(*At == ' ' || *At == '\t')
+                {
+                    ++At;
+                }
+                else if(Skip)
+                {
+                    At += Skip;
+                }
+                else if(At[0] == '/' && At[1] == '*')
+                {
+                    At = GlobalScanner.FindCommentEnd(At + 2);
+                    if(*At)
+                    {
+                        At += 2;
+                    }
+                }
+                else
+                {
+                    break;
+                }
+            }
+            
+            // NOTE(felipe): The name is spliced as it is read, names longer
+            // than the buffer are not directives that matter here.
+            char Name[8];
+            uint32 Length = 0;
+            for(;;)
+            {
+                uint32 Skip = GetLineContinuationLength(At);
+                if(Skip)
+                {
+                    At += Skip;
+                }
+                else if(Tables->CharClass[(uint8)*At] & CHAR_FLAG_IDENTIFIER)
+                {
+                    if(Length < ArrayCount(Name))
+                    {
+                        Name[Length] = *At;
+                    }
+                    ++Length;
+                    ++At;
+                }
+                else
+                {
+                    break;
+                }
+            }
+            
+            if(NameIs(Name, Length, "if") || NameIs(Name, Length, "ifdef") || NameIs(Name, Length, "ifndef"))
+            {
+                ++Depth;
+            }
+            else if(NameIs(Name, Length, "endif"))
+            {
+                if(Depth)
+                {
+                    --Depth;
+                }
+                else
+                {
+                    Directive = Hash;
+                }
+            }
+            else if(!Depth && (NameIs(Name, Length, "else") || NameIs(Name, Length, "elif")))
+            {
+                Directive = Hash;
+            }
+        }
+        
+        // NOTE(felipe): Rest of the line. Quotes end at the end of the line
+        // even if they are not closed, disabled text need not be valid C.
+        while(!Directive && *At)
+        {
+            while(!Tables->SkipStops[(uint8)*At])
+            {
+                ++At;
+            }
+            
+            char Character = *At;
+            if(Character == '\n')
+            {
+                ++At;
+                break;
+            }
+            else if(Character == '\\')
+            {
+                ++At;
+                if(*At == '\r')
+                {
+                    ++At;
+                }
+                if(*At == '\n')
+                {
+                    ++At;
+                }
+            }
+            else if(Character == '/')
+            {
+                if(At[1] == '*')
+                {
+                    At = GlobalScanner.FindCommentEnd(At + 2);
+                    if(*At)
+                    {
+                        At += 2;
+                    }
+                }
+                else if(At[1] == '/')
+                {
+                    At = FindLineCommentEnd(At + 2);
+                }
+                else
+                {
+                    ++At;
+                }
+            }
+            else if(Character)
+            {
+                ++At;
+                while(*At != Character && *At != '\n' && *At)
+                {
+                    if(*At == '\\' && At[1])
+                    {
+                        ++At;
+                    }
+                    ++At;
+                }
+                
+                if(*At == Character)
+                {
+                    ++At;
+                }
+            }
+        }
+    }
+    
+    Lexer->At = Directive ? Directive : At;
+    Lexer->AtBeginningOfLine = true;
+    Lexer->SpaceBefore = false;
+}
+
+internal bool32
+TokenBuffersMatch(token_buffer *A, token_buffer *B)
+{
+    bool32 Result = (A->Count == B->Count) && (A->LiteralCount == B->LiteralCount);
+    for(uint32 Slot = 0;
+        Result && (Slot < A->Count);
+        ++Slot)
+    {
+        Result = ((A->Types[Slot] == B->Types[Slot]) &&
+                  (A->Flags[Slot] == B->Flags[Slot]) &&
+                  (A->Locations[Slot] == B->Locations[Slot]) &&
+                  (A->Lengths[Slot] == B->Lengths[Slot]) &&
+                  (A->Values[Slot] == B->Values[Slot]));
+    }
+    
+    for(uint32 Literal = 0;
+        Result && (Literal < A->LiteralCount);
+        ++Literal)
+    {
+        Result = (A->Literals[Literal] == B->Literals[Literal]);
+    }
+    
+    return Result;
+}
+
+internal void
+BenchmarkLexer(memory_arena *Arena, loaded_file *File)
+{
+    scanner Scanners[MAX_SCANNER_COUNT];
+    uint32 ScannerCount = GetAvailableScanners(Scanners);
+    
+    scanner OldScanner = GlobalScanner;
+    
+    token_buffer *Serial = Tokenize(Arena, File);
+    uint32 TokenCount = Serial->Count;
+    
+    printf("Lexer benchmark: %s (%llu bytes, %u tokens)\n",
+           File->Filename, (unsigned long long)File->Size, TokenCount);
+    
+    for(uint32 ScannerIndex = 0;
+        ScannerIndex < ScannerCount;
+        ++ScannerIndex)
+    {
+        GlobalScanner = Scanners[ScannerIndex];
+        
+        // NOTE(felipe): Best of at least 5 runs and at least one second.
+        real64 BestSeconds = 0;
+        real64 TotalSeconds = 0;
+        for(uint32 Run = 0;
+            Run < 5 || TotalSeconds < 1.0;
+            ++Run)
+        {
+            temporary_memory TokenMemory = BeginTemporaryMemory(Arena);
+            
+            uint64 Start = PlatformGetWallClock();
+            Tokenize(Arena, File);
+            real64 Seconds = PlatformGetSecondsElapsed(Start, PlatformGetWallClock());
+            
+            EndTemporaryMemory(TokenMemory);
+            
+            if(Run == 0 || Seconds < BestSeconds)
+            {
+                BestSeconds = Seconds;
+            }
+            TotalSeconds += Seconds;
+        }
+        
+        real64 BytesPerSecond = (real64)File->Size / BestSeconds;
+        printf("  %-8s %10.2f MB/s %10.2f Mtokens/s %8.3f ms\n",
+               GlobalScanner.Name, BytesPerSecond / (1024.0*1024.0),
+               (real64)TokenCount / BestSeconds / 1000000.0, BestSeconds*1000.0);
+    }
+    
+    GlobalScanner = OldScanner;
+    
+    // NOTE(felipe): Chunked lexing with the default scanner, checked against
+    // the serial lexer first.
+    printf("Parallel lexer (%u processors)\n", PlatformGetProcessorCount());
+    
+    real64 SerialSeconds = 0;
+    for(uint32 ThreadCount = 1;
+        ThreadCount <= 16;
+        ThreadCount *= 2)
+    {
+        platform_work_queue *Queue = PlatformCreateWorkQueue(ThreadCount);
+        // NOTE(felipe): More chunks than threads, so a slow chunk does not
+        // leave the other threads idle.
+        uint32 ChunkCount = (ThreadCount > 1) ? 4*ThreadCount : 1;
+        
+        temporary_memory CheckMemory = BeginTemporaryMemory(Arena);
+        bool32 Matches = TokenBuffersMatch(Serial, TokenizeParallel(Arena, File, Queue, ChunkCount));
+        EndTemporaryMemory(CheckMemory);
+        
+        real64 BestSeconds = 0;
+        real64 TotalSeconds = 0;
+        for(uint32 Run = 0;
+            Run < 5 || TotalSeconds < 1.0;
+            ++Run)
+        {
+            temporary_memory TokenMemory = BeginTemporaryMemory(Arena);
+            
+            uint64 Start = PlatformGetWallClock();
+            TokenizeParallel(Arena, File, Queue, ChunkCount);
+            real64 Seconds = PlatformGetSecondsElapsed(Start, PlatformGetWallClock());
+            
+            EndTemporaryMemory(TokenMemory);
+            
+            if(Run == 0 || Seconds < BestSeconds)
+            {
+                BestSeconds = Seconds;
+            }
+            TotalSeconds += Seconds;
+        }
+        
+        PlatformDestroyWorkQueue(Queue);
+        
+        if(ThreadCount == 1)
+        {
+            SerialSeconds = BestSeconds;
+        }
+        
+        real64 BytesPerSecond = (real64)File->Size / BestSeconds;
+        printf("  %2u threads %10.2f MB/s %8.3f ms %6.2fx %s\n",
+               ThreadCount, BytesPerSecond / (1024.0*1024.0), BestSeconds*1000.0,
+               SerialSeconds / BestSeconds, Matches ? "identical" : "MISMATCH");
+    }
+}
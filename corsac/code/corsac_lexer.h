@@ -0,0 +1,165 @@
+#if !defined(CORSAC_LEXER_H)
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Felipe Carlin $
+   $Notice: Copyright  2022 Felipe Carlin $
+   ======================================================================== */
+
+// NOTE(felipe): The scanner finds the boundaries the tokenizer skips over:
+// whitespace, line comments and block comments. Every function stops at the
+// NUL terminator too, so the caller checks for it only once per skip.
+typedef char *skip_blanks_function(char *At, bool32 *SawNewline);
+typedef char *find_function(char *At);
+
+typedef struct scanner
+{
+    char *Name;
+    
+    // NOTE(felipe): Returns the first byte that is not ' ', '\t', '\r' or
+    // '\n'. Sets SawNewline when a '\n' was skipped.
+    skip_blanks_function *SkipBlanks;
+    
+    // NOTE(felipe): Returns the next '\n'.
+    find_function *FindNewline;
+    
+    // NOTE(felipe): Returns the '*' of the next "*/".
+    find_function *FindCommentEnd;
+} scanner;
+
+#define MAX_SCANNER_COUNT 3
+
+// NOTE(felipe): Character classes drive the tokenizer. The low bits of a
+// table entry are the class, CHAR_FLAG_IDENTIFIER marks the bytes that can
+// continue an identifier or a number.
+typedef enum char_class
+{
+    CharClass_Null,
+    CharClass_Blank,
+    CharClass_Letter,
+    CharClass_Digit,
+    CharClass_Quote,
+    CharClass_DoubleQuote,
+    CharClass_Backslash,
+    CharClass_Invalid,
+    
+    // NOTE(felipe): Every punctuation character gets its own class from here
+    // on, they are the columns of the punctuator state machine.
+    CharClass_Punctuation,
+} char_class;
+
+#define CHAR_CLASS_MASK 0x3f
+#define CHAR_FLAG_IDENTIFIER 0x80
+
+#define PUNCTUATION_CHARACTERS "!#%&()*+,-./:;<=>?[]^{|}~"
+#define PUNCTUATION_CHARACTER_COUNT (sizeof(PUNCTUATION_CHARACTERS) - 1)
+#define MAX_PUNCTUATOR_STATE_COUNT 64
+
+typedef struct lexer_tables
+{
+    uint8 CharClass[256];
+    
+    uint32 PunctuatorStateCount;
+    uint8 PunctuatorNext[MAX_PUNCTUATOR_STATE_COUNT][PUNCTUATION_CHARACTER_COUNT];
+    
+    // NOTE(felipe): The punctuator a state accepts, zero if it accepts none.
+    uint8 PunctuatorAccepts[MAX_PUNCTUATOR_STATE_COUNT];
+    
+    // NOTE(felipe): Bytes that skipping a false conditional group has to
+    // look at, every other byte is passed over.
+    uint8 SkipStops[256];
+} lexer_tables;
+
+typedef struct keyword_entry
+{
+    char *Name;
+    uint32 Length;
+    keyword Keyword;
+} keyword_entry;
+
+// NOTE(felipe): Keywords are found with a perfect hash of the first two
+// bytes, the last byte and the length. The multiplier was found by an
+// offline search so that all 32 C89 keywords land in distinct slots of a
+// 64 entry table. Adding a keyword means searching for a new multiplier
+// and regenerating KeywordTable.
+#define KEYWORD_HASH_MULTIPLIER 0x01d94107
+#define KEYWORD_HASH_SHIFT 26
+#define KEYWORD_TABLE_SIZE 64
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 8
+
+// NOTE(felipe): Where lexing of a file stopped, so that a file can be lexed a
+// few tokens at a time.
+typedef struct lexer
+{
+    loaded_file *File;
+    
+    char *At;
+    bool32 AtBeginningOfLine;
+    bool32 SpaceBefore;
+    bool32 ReachedEOF;
+    
+    // NOTE(felipe): No token starts at or past End. A lexer limited to a
+    // chunk of the file stops there as if it was EOF, but pushes no EOF
+    // token.
+    char *End;
+    
+    // NOTE(felipe): Speculative lexers record errors in Failed and stop
+    // instead of reporting them.
+    bool32 Speculative;
+    bool32 Failed;
+    
+    // NOTE(felipe): The atom table is not shared between threads, lexers
+    // running on a worker leave identifiers without atoms.
+    bool32 DeferAtoms;
+    
+    // NOTE(felipe): Lexers that feed the preprocessor stop after the first
+    // token of the line that follows a directive, so that the lines after a
+    // false conditional can still be skipped without lexing them.
+    bool32 StopAfterDirectives;
+    bool32 InDirective;
+} lexer;
+
+// NOTE(felipe): Tokens lexed every time a token window runs dry.
+#define LEXER_FILL_COUNT 256
+
+// NOTE(felipe): A piece of a file lexed on its own thread, into the part of
+// the output arrays from SliceToken and SliceLiteral on. Chunks start at the
+// beginning of a line but may still start inside a block comment, so only
+// the tokens from the first one the previous chunk agrees with on are kept,
+// from FirstToken and FirstLiteral on. They are packed down to OutputToken
+// and OutputLiteral.
+typedef struct lex_chunk
+{
+    lexer Lexer;
+    token_buffer Tokens;
+    uint32 ValidFrom;
+    
+    uint32 SliceToken;
+    uint32 SliceLiteral;
+    uint32 WrittenCount;
+    uint32 WrittenLiteralCount;
+    
+    uint32 FirstToken;
+    uint32 FirstLiteral;
+    uint32 OutputToken;
+    uint32 OutputLiteral;
+} lex_chunk;
+
+typedef struct pack_chunks_work
+{
+    lex_chunk *Chunks;
+    uint32 ChunkCount;
+    
+    uint8 *Array;
+    uint32 ElementSize;
+    bool32 Literals;
+} pack_chunks_work;
+
+// NOTE(felipe): Files smaller than this per chunk are not worth splitting.
+#define LEX_CHUNK_MIN_SIZE Kilobytes(64)
+#define MAX_LEX_CHUNK_COUNT 128
+
+#define CORSAC_LEXER_H
+#endif
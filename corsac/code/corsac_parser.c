@@ -8,289 +8,480 @@
 
 #include "corsac_parser.h"
 
-inline ast_node *
-NewNode(ast_node_type NodeType, token *Token)
-{
-    ast_node *Node = calloc(1, sizeof(ast_node));
-    Node->NodeType = NodeType;
+// TODO(felipe): Remove globals.
+global_variable memory_arena *GlobalParserArena;
+global_variable token_buffer *GlobalParserTokens;
 
-    Node->Token = Token;
-    
-    return Node;
-}
+// NOTE(felipe): GlobalNodes is the memory of GlobalNodeArena, node indices
+// are relative to it.
+global_variable memory_arena *GlobalNodeArena;
+global_variable uint8 *GlobalNodes;
+global_variable uint32 GlobalNodeCount;
 
-inline ast_node *
-NewNumber(uint32 Value, token *Token)
-{
-    ast_node *Node = NewNode(ASTNodeType_Number, Token);
-    Node->NumericalValue = Value;
+// NOTE(felipe): Statements of the blocks being parsed, a block takes its own
+// off the top once it is closed.
+global_variable memory_arena GlobalStatementStack;
 
-    return Node;
-}
+variable_type *GlobalTypeInt = &(variable_type){TypeKind_Int};
+global_variable type_table GlobalTypes;
 
-inline ast_node *
-NewBinaryNode(ast_node_type NodeType, ast_node *LeftHandSide, ast_node *RightHandSide, token *Token)
+inline bool32 TypeIsInteger(variable_type *Type)
 {
-    ast_node *Result = NewNode(NodeType, Token);
-    Result->LeftHandSide = LeftHandSide;
-    Result->RightHandSide = RightHandSide;
+    bool32 Result = Type->Kind == TypeKind_Int;
+    return Result;
+}
 
+inline uint32
+HashType(type_kind Kind, variable_type *Base)
+{
+    uint64 Key = (uint64)(memory_index)Base ^ (uint64)Kind;
+    uint32 Result = (uint32)((Key*11400714819323198485ull) >> 32);
     return Result;
 }
 
-// Ensure that the current token is `s`.
-inline token *
-AssertNext(token *Token, char *S)
+internal variable_type **
+FindTypeSlot(variable_type **Slots, uint32 SlotCount, type_kind Kind, variable_type *Base)
 {
-    if(!TokenIs(Token, S))
+    // NOTE(felipe): Returns the slot of the type, or the empty slot where it
+    // would go.
+    uint32 Mask = SlotCount - 1;
+    uint32 Slot = HashType(Kind, Base) & Mask;
+    
+    while(Slots[Slot] && ((Slots[Slot]->Kind != Kind) || (Slots[Slot]->Base != Base)))
     {
-        ErrorInToken(Token, "expected '%s'", S);
+        Slot = (Slot + 1) & Mask;
     }
     
-    return Token->Next;
+    variable_type **Result = Slots + Slot;
+    return Result;
 }
 
-internal ast_node *Expression(token *Token, token **Rest);
-
-
-// TODO(felipe): Remove globals.
-global_variable object GlobalVariablesHead = {0};
-global_variable object *GlobalVariables = &GlobalVariablesHead;
+internal void
+GrowTypeSlots(type_table *Table, uint32 SlotCount)
+{
+    variable_type **Slots = PushArray(Table->Arena, SlotCount, variable_type *);
+    
+    for(uint32 Slot = 0;
+        Slot < Table->SlotCount;
+        ++Slot)
+    {
+        variable_type *Type = Table->Slots[Slot];
+        if(Type)
+        {
+            *FindTypeSlot(Slots, SlotCount, Type->Kind, Type->Base) = Type;
+        }
+    }
+    
+    Table->Slots = Slots;
+    Table->SlotCount = SlotCount;
+}
 
+internal void
+BeginTypeTable(type_table *Table, memory_arena *Arena)
+{
+    type_table Empty = {0};
+    *Table = Empty;
+    
+    Table->Arena = Arena;
+    GrowTypeSlots(Table, MIN_TYPE_SLOT_COUNT);
+}
 
-// Find a local variable by name.
-internal object *
-GetVariable(token *Token)
+internal variable_type *
+GetType(type_table *Table, type_kind Kind, variable_type *Base)
 {
-    object *Result = 0;
+    variable_type **Slot = FindTypeSlot(Table->Slots, Table->SlotCount, Kind, Base);
     
-    for(object *Variable = GlobalVariablesHead.Next;
-        Variable;
-        Variable = Variable->Next)
+    variable_type *Result = *Slot;
+    if(!Result)
     {
-        if(StringLength(Variable->Name) == Token->Length && !StringCompare(Token->Location, Variable->Name, Token->Length))
+        Result = PushStruct(Table->Arena, variable_type);
+        Result->Kind = Kind;
+        Result->Base = Base;
+        
+        *Slot = Result;
+        ++Table->Count;
+        
+        // NOTE(felipe): Keep the table at most half full.
+        if(2*Table->Count > Table->SlotCount)
         {
-            Result = Variable;
+            GrowTypeSlots(Table, 2*Table->SlotCount);
         }
     }
     
     return Result;
 }
 
-// Primary = "(" Expression ")"
-//         | Identifier
-//         | Number
-internal ast_node *
-Primary(token *Token, token **Rest)
+inline variable_type *
+PointerTo(variable_type *Base)
 {
-    ast_node *Result = 0;
+    variable_type *Result = GetType(&GlobalTypes, TypeKind_Pointer, Base);
+    return Result;
+}
 
-    if(TokenIs(Token, "("))
-    {
-        Result = Expression(Token->Next, &Token);
-        *Rest = AssertNext(Token, ")");
-    }
-    else if(Token->TokenType == TokenType_Identifier)
+inline uint32
+Kind(token_index Token)
+{
+    uint32 Result = GetTokenKind(GlobalParserTokens, Token);
+    return Result;
+}
+
+inline bool32
+Equals(token_index Token, uint32 TokenKind)
+{
+    bool32 Result = (GetTokenKind(GlobalParserTokens, Token) == TokenKind);
+    return Result;
+}
+
+inline ast_node *
+GetNode(node_index Index)
+{
+    Assert(Index);
+    ast_node *Result = (ast_node *)(GlobalNodes + (memory_index)Index*AST_NODE_ALIGNMENT);
+    return Result;
+}
+
+#define GetNodeAs(Type, Index) ((Type *)GetNode(Index))
+
+inline node_index *
+GetBlockStatements(ast_block *Block)
+{
+    node_index *Result = (node_index *)(Block + 1);
+    return Result;
+}
+
+inline node_index
+NewNode(ast_node_type NodeType, memory_index Size, token_index Token)
+{
+    ast_node *Node = (ast_node *)PushSize_(GlobalNodeArena, Size, AST_NODE_ALIGNMENT);
+    Node->NodeType = NodeType;
+    Node->Location = GetTokenLocation(GlobalParserTokens, Token);
+    ++GlobalNodeCount;
+    
+    node_index Result = (node_index)(((uint8 *)Node - GlobalNodes) / AST_NODE_ALIGNMENT);
+    return Result;
+}
+
+inline node_index
+NewNumber(uint64 Value, token_index Token)
+{
+    node_index Result = NewNode(ASTNodeType_Number, sizeof(ast_number), Token);
+    
+    ast_number *Node = GetNodeAs(ast_number, Result);
+    Node->Node.Type = GlobalTypeInt;
+    Node->Value = Value;
+
+    return Result;
+}
+
+inline node_index
+NewUnaryNode(ast_node_type NodeType, node_index Operand, token_index Token)
+{
+    node_index Result = NewNode(NodeType, sizeof(ast_unary), Token);
+    
+    ast_unary *Node = GetNodeAs(ast_unary, Result);
+    Node->Operand = Operand;
+    
+    // NOTE(felipe): The operand was built, and typed, before its parent.
+    // Statements have no type.
+    switch(NodeType)
     {
-        Result = NewNode(ASTNodeType_Variable, Token);
-        
-        // NOTE(felipe): Check if variable already exists.
-        object *Variable = GetVariable(Token);
-        if(!Variable)
+        case ASTNodeType_Negate:
         {
-            Variable = calloc(1, sizeof(object));
-            Variable->Name = StringDuplicate(Token->Location, Token->Length);
-
-            GlobalVariables->Next = Variable;
-            GlobalVariables = Variable;
-        }
+            Node->Node.Type = GetNode(Operand)->Type;
+        } break;
         
-        Result->Variable = Variable;
+        case ASTNodeType_Address:
+        {
+            Node->Node.Type = PointerTo(GetNode(Operand)->Type);
+        } break;
         
-        *Rest = Token->Next;
+        case ASTNodeType_Dereference:
+        {
+            variable_type *OperandType = GetNode(Operand)->Type;
+            if(OperandType->Kind == TypeKind_Pointer)
+            {
+                Node->Node.Type = OperandType->Base;
+            }
+            else
+            {
+                Node->Node.Type = GlobalTypeInt;
+            }
+        } break;
     }
-    else if(Token->TokenType == TokenType_Number)
+    
+    return Result;
+}
+
+inline node_index
+NewBinaryNode(ast_node_type NodeType, node_index LeftHandSide, node_index RightHandSide, token_index Token)
+{
+    node_index Result = NewNode(NodeType, sizeof(ast_binary), Token);
+    
+    ast_binary *Node = GetNodeAs(ast_binary, Result);
+    Node->LeftHandSide = LeftHandSide;
+    Node->RightHandSide = RightHandSide;
+    
+    switch(NodeType)
     {
-        Result = NewNode(ASTNodeType_Number, Token);
-        Result->Token = Token;
-        
-        Result->NumericalValue = Token->NumericalValue;
+        case ASTNodeType_Add:
+        case ASTNodeType_Sub:
+        case ASTNodeType_Multiply:
+        case ASTNodeType_Divide:
+        case ASTNodeType_Assign:
+        {
+            Node->Node.Type = GetNode(LeftHandSide)->Type;
+        } break;
         
-        *Rest = Token->Next;
+        default:
+        {
+            Node->Node.Type = GlobalTypeInt;
+        } break;
     }
-    else
+
+    return Result;
+}
+
+// Ensure that the current token is of kind `TokenKind`.
+inline token_index
+AssertNext(token_index Token, uint32 TokenKind)
+{
+    if(!Equals(Token, TokenKind))
     {
-        ErrorInToken(Token, "expected a number");
+        ErrorInToken(GlobalParserTokens, Token, "expected '%s'", GetKindName(TokenKind));
     }
     
-    return Result;
+    return Token + 1;
 }
 
-// Unary = ("+" | "-"| "*" | "&") Unary
-//       | Primary
-internal ast_node *
-Unary(token *Token, token **Rest)
+internal node_index Expression(token_index Token, token_index *Rest);
+
+
+// TODO(felipe): Remove globals.
+global_variable object GlobalVariablesHead = {0};
+global_variable object *GlobalVariables = &GlobalVariablesHead;
+global_variable scope_table GlobalScopes;
+
+internal void
+BeginScopeTable(scope_table *Table, memory_arena *Arena)
 {
-    ast_node *Result = 0;
+    scope_table Empty = {0};
+    *Table = Empty;
     
-    if(TokenIs(Token, "+"))
+    Table->Arena = Arena;
+    BeginAtomMap(Arena, &Table->Map, sizeof(binding_slot), MIN_BINDING_SLOT_COUNT);
+}
+
+internal void
+EnterScope(scope_table *Table)
+{
+    scope *Scope = Table->FirstFreeScope;
+    if(Scope)
     {
-        Result = Unary(Token->Next, Rest);
+        Table->FirstFreeScope = Scope->Parent;
     }
-    else if(TokenIs(Token, "-"))
+    else
     {
-        Result = NewNode(ASTNodeType_Negate, Token);
-        Result->LeftHandSide = Unary(Token->Next, Rest);
+        Scope = PushStruct(Table->Arena, scope);
     }
-    else if(TokenIs(Token, "*"))
+    
+    Scope->Bindings = 0;
+    Scope->Parent = Table->Scope;
+    Table->Scope = Scope;
+}
+
+internal void
+LeaveScope(scope_table *Table)
+{
+    scope *Scope = Table->Scope;
+    Assert(Scope);
+    
+    // NOTE(felipe): Every binding of the scope is the innermost one of its
+    // name, uncover what it was hiding.
+    binding *Binding = Scope->Bindings;
+    while(Binding)
     {
-        Result = NewNode(ASTNodeType_Dereference, Token);
-        Result->LeftHandSide = Unary(Token->Next, Rest);
+        binding *Next = Binding->NextInScope;
+        
+        binding_slot *Slot = (binding_slot *)FindAtomSlot(&Table->Map, Binding->Object->Name);
+        Assert(Slot->Binding == Binding);
+        Slot->Binding = Binding->Shadowed;
+        
+        Binding->NextInScope = Table->FirstFreeBinding;
+        Table->FirstFreeBinding = Binding;
+        
+        Binding = Next;
     }
-    else if(TokenIs(Token, "&"))
+    
+    Table->Scope = Scope->Parent;
+    Scope->Parent = Table->FirstFreeScope;
+    Table->FirstFreeScope = Scope;
+}
+
+internal void
+BindObject(scope_table *Table, scope *Scope, object *Object)
+{
+    // NOTE(felipe): Only the innermost scope can bind over an existing name,
+    // an outer one would hide the bindings of the scopes inside it.
+    binding_slot *Slot = (binding_slot *)AddAtomSlot(Table->Arena, &Table->Map, Object->Name);
+    Assert(!Slot->Binding || (Scope == Table->Scope) || (Slot->Binding->Object->Type != ObjectType_Variable));
+    
+    binding *Binding = Table->FirstFreeBinding;
+    if(Binding)
     {
-        Result = NewNode(ASTNodeType_Address, Token);
-        Result->LeftHandSide = Unary(Token->Next, Rest);
+        Table->FirstFreeBinding = Binding->NextInScope;
     }
     else
     {
-        Result = Primary(Token, Rest);
+        Binding = PushStruct(Table->Arena, binding);
     }
     
-    return Result;
+    Binding->Object = Object;
+    Binding->Shadowed = Slot->Binding;
+    Binding->NextInScope = Scope->Bindings;
+    Scope->Bindings = Binding;
+    Slot->Binding = Binding;
 }
 
-// Multiply = Unary ("*" Unary | "/" Unary)*
-internal ast_node *
-Multiply(token *Token, token **Rest)
+// Find the innermost object bound to Name.
+internal object *
+FindObject(scope_table *Table, atom Name)
 {
-    ast_node *Result = Unary(Token, &Token);
+    object *Result = 0;
     
-    for(;;)
+    binding *Binding = ((binding_slot *)FindAtomSlot(&Table->Map, Name))->Binding;
+    if(Binding)
     {
-        token *Start = Token;
-        
-        if(TokenIs(Token, "*"))
-        {
-            Result = NewBinaryNode(ASTNodeType_Multiply, Result, Unary(Token->Next, &Token), Start);
-        }
-        else if(TokenIs(Token, "/"))
-        {
-            Result = NewBinaryNode(ASTNodeType_Divide, Result, Unary(Token->Next, &Token), Start);
-        }
-        else
-        {
-            *Rest = Token;
-            break;
-        }
+        Result = Binding->Object;
     }
     
     return Result;
 }
 
-variable_type *GlobalTypeInt = &(variable_type){TypeKind_Int};
-
-inline bool32 TypeIsInteger(variable_type *Type)
+internal object *
+DeclareLocalVariable(atom Name)
 {
-    bool32 Result = Type->Kind == TypeKind_Int;
+    object *Result = PushStruct(GlobalParserArena, object);
+    Result->Name = Name;
+    Result->Type = ObjectType_Variable;
+    Result->Storage = ObjectStorage_Local;
+    
+    GlobalVariables->Next = Result;
+    GlobalVariables = Result;
+    
+    BindObject(&GlobalScopes, GlobalScopes.FunctionScope, Result);
+    
     return Result;
 }
 
-inline variable_type *
-PointerTo(variable_type *Base)
+// Primary = "(" Expression ")"
+//         | Identifier
+//         | Number
+internal node_index
+Primary(token_index Token, token_index *Rest)
 {
-  variable_type *Type = calloc(1, sizeof(variable_type));
-  Type->Kind = TypeKind_Pointer;
-  Type->Base = Base;
-  return Type;
+    node_index Result = 0;
+
+    if(Equals(Token, Punctuator_OpenParen))
+    {
+        Result = Expression(Token + 1, &Token);
+        *Rest = AssertNext(Token, Punctuator_CloseParen);
+    }
+    else if(GetTokenType(GlobalParserTokens, Token) == TokenType_Identifier)
+    {
+        Result = NewNode(ASTNodeType_Variable, sizeof(ast_variable), Token);
+        
+        // NOTE(felipe): There are no declarations yet, the first use of a
+        // name that is not a variable in scope declares a local of the
+        // function.
+        atom Name = GetTokenAtom(GlobalParserTokens, Token);
+        object *Variable = FindObject(&GlobalScopes, Name);
+        if(!Variable || (Variable->Type != ObjectType_Variable))
+        {
+            Variable = DeclareLocalVariable(Name);
+        }
+        
+        ast_variable *Node = GetNodeAs(ast_variable, Result);
+        Node->Node.Type = GlobalTypeInt;
+        Node->Variable = Variable;
+        
+        *Rest = Token + 1;
+    }
+    else if(GetTokenType(GlobalParserTokens, Token) == TokenType_Number)
+    {
+        Result = NewNumber(GetTokenNumber(GlobalParserTokens, Token), Token);
+        
+        *Rest = Token + 1;
+    }
+    else
+    {
+        ErrorInToken(GlobalParserTokens, Token, "expected a number");
+    }
+    
+    return Result;
 }
 
-internal void
-AddTypeToNode(ast_node *Node)
+// Unary = ("+" | "-"| "*" | "&") Unary
+//       | Primary
+internal node_index
+Unary(token_index Token, token_index *Rest)
 {
-    if(Node && !Node->Type)
+    node_index Result = 0;
+    
+    switch(Kind(Token))
     {
-        AddTypeToNode(Node->LeftHandSide);
-        AddTypeToNode(Node->RightHandSide);
-        AddTypeToNode(Node->Condition);
-        AddTypeToNode(Node->Then);
-        AddTypeToNode(Node->Else);
-        AddTypeToNode(Node->Init);
-        AddTypeToNode(Node->Increment);
-
-        for(ast_node *N = Node->Body;
-            N;
-            N = N->Next)
+        case Punctuator_Plus:
         {
-            AddTypeToNode(N);
-        }
+            Result = Unary(Token + 1, Rest);
+        } break;
         
-        switch(Node->NodeType)
+        case Punctuator_Minus:
         {
-            case ASTNodeType_Add:
-            case ASTNodeType_Sub:
-            case ASTNodeType_Multiply:
-            case ASTNodeType_Divide:
-            case ASTNodeType_Negate:
-            case ASTNodeType_Assign:
-            {
-                Node->Type = Node->LeftHandSide->Type;
-            } break;
-            
-            case ASTNodeType_Equal:
-            case ASTNodeType_NotEqual:
-            case ASTNodeType_LessThan:
-            case ASTNodeType_LessEqual:
-            case ASTNodeType_Variable:
-            case ASTNodeType_Number:
-            {
-                Node->Type = GlobalTypeInt;
-            } break;
-
-            case ASTNodeType_Address:
-            {
-                Node->Type = PointerTo(Node->LeftHandSide->Type);
-            } break;
-
-            case ASTNodeType_Dereference:
-            {
-                if(Node->LeftHandSide->Type->Kind == TypeKind_Pointer)
-                {
-                    Node->Type = Node->LeftHandSide->Type->Base;
-                }
-                else
-                {
-                    Node->Type = GlobalTypeInt;
-                }
-            } break;
-        }
+            Result = NewUnaryNode(ASTNodeType_Negate, Unary(Token + 1, Rest), Token);
+        } break;
+        
+        case Punctuator_Star:
+        {
+            Result = NewUnaryNode(ASTNodeType_Dereference, Unary(Token + 1, Rest), Token);
+        } break;
+        
+        case Punctuator_Ampersand:
+        {
+            Result = NewUnaryNode(ASTNodeType_Address, Unary(Token + 1, Rest), Token);
+        } break;
+        
+        default:
+        {
+            Result = Primary(Token, Rest);
+        } break;
     }
+    
+    return Result;
 }
 
-internal ast_node *
-NewAddition(ast_node *LeftHandSide, ast_node *RightHandSide, token *Token)
+internal node_index
+NewAddition(node_index LeftHandSide, node_index RightHandSide, token_index Token)
 {
-    ast_node *Result = 0;
+    node_index Result = 0;
     
-    AddTypeToNode(LeftHandSide);
-    AddTypeToNode(RightHandSide);
+    variable_type *LeftType = GetNode(LeftHandSide)->Type;
+    variable_type *RightType = GetNode(RightHandSide)->Type;
     
-    if(TypeIsInteger(LeftHandSide->Type) && TypeIsInteger(RightHandSide->Type))
+    if(TypeIsInteger(LeftType) && TypeIsInteger(RightType))
     {
         Result = NewBinaryNode(ASTNodeType_Add, LeftHandSide, RightHandSide, Token);
     }
     else
     {
-        if(LeftHandSide->Type->Base && RightHandSide->Type->Base)
+        if(LeftType->Base && RightType->Base)
         {
-            ErrorInToken(Token, "invalid operands");
+            ErrorInToken(GlobalParserTokens, Token, "invalid operands");
         }
         else
         {
             // Canonicalize `num + ptr` to `ptr + num`.
-            if(!LeftHandSide->Type->Base && RightHandSide->Type->Base)
+            if(!LeftType->Base && RightType->Base)
             {
-                ast_node *Temp = LeftHandSide;
+                node_index Temp = LeftHandSide;
                 LeftHandSide = RightHandSide;
                 RightHandSide = Temp;
             }
@@ -304,193 +495,155 @@ NewAddition(ast_node *LeftHandSide, ast_node *RightHandSide, token *Token)
 }
 
 // Like `+`, `-` is overloaded for the pointer type.
-internal ast_node *
-NewSubtraction(ast_node *LeftHandSide, ast_node *RightHandSide, token *Token)
+internal node_index
+NewSubtraction(node_index LeftHandSide, node_index RightHandSide, token_index Token)
 {
-    ast_node *Result = 0;
+    node_index Result = 0;
     
-    AddTypeToNode(LeftHandSide);
-    AddTypeToNode(RightHandSide);
+    variable_type *LeftType = GetNode(LeftHandSide)->Type;
+    variable_type *RightType = GetNode(RightHandSide)->Type;
 
     // num - num
-    if(TypeIsInteger(LeftHandSide->Type) && TypeIsInteger(RightHandSide->Type))
+    if(TypeIsInteger(LeftType) && TypeIsInteger(RightType))
     {
         Result = NewBinaryNode(ASTNodeType_Sub, LeftHandSide, RightHandSide, Token);
     }
-    else if(LeftHandSide->Type->Base && TypeIsInteger(RightHandSide->Type))
+    else if(LeftType->Base && TypeIsInteger(RightType))
     {
         // ptr - num
         
         RightHandSide = NewBinaryNode(ASTNodeType_Multiply, RightHandSide, NewNumber(8, Token), Token);
-        
-        AddTypeToNode(RightHandSide);
-
         Result = NewBinaryNode(ASTNodeType_Sub, LeftHandSide, RightHandSide, Token);
-        Result->Type = LeftHandSide->Type;
     }
-    else if(LeftHandSide->Type->Base && RightHandSide->Type->Base)
+    else if(LeftType->Base && RightType->Base)
     {
         // ptr - ptr, which returns how many elements are between the two.
         
-        ast_node *Node = NewBinaryNode(ASTNodeType_Sub, LeftHandSide, RightHandSide, Token);
-        Node->Type = GlobalTypeInt;
-        Result = NewBinaryNode(ASTNodeType_Divide, Node, NewNumber(8, Token), Token);
+        node_index Difference = NewBinaryNode(ASTNodeType_Sub, LeftHandSide, RightHandSide, Token);
+        GetNode(Difference)->Type = GlobalTypeInt;
+        Result = NewBinaryNode(ASTNodeType_Divide, Difference, NewNumber(8, Token), Token);
     }
     else
     {
-        ErrorInToken(Token, "invalid operands");
+        ErrorInToken(GlobalParserTokens, Token, "invalid operands");
     }
     
     return Result;
 }
 
-// Add = Multiply ("+" Multiply | "-" Multiply)*
-internal ast_node *
-Add(token *Token, token **Rest)
+// NOTE(felipe): Binary operators by token kind, a zero precedence is not a
+// binary operator and a higher one binds tighter. The levels are the ones of
+// C, the operators that are still missing go in between without adding
+// anything to the parser.
+global_variable binary_operator BinaryOperators[Punctuator_Count] =
 {
-    ast_node *Result = Multiply(Token, &Token);
+    [Punctuator_Equal] = {1, true, ASTNodeType_Assign},
     
-    for(;;)
-    {
-        token *Start = Token;
-        
-        if(TokenIs(Token, "+"))
-        {
-//            Result = NewBinaryNode(ASTNodeType_Add, Result, Multiply(Token->Next, &Token), Start);
-            Result = NewAddition(Result, Multiply(Token->Next, &Token), Start);
-        }
-        else if(TokenIs(Token, "-"))
-        {
-//            Result = NewBinaryNode(ASTNodeType_Sub, Result, Multiply(Token->Next, &Token), Start);
-            Result = NewSubtraction(Result, Multiply(Token->Next, &Token), Start);
-        }
-        else
-        {
-            *Rest = Token;
-            break;
-        }
-    }
+    [Punctuator_EqualEqual] = {8, false, ASTNodeType_Equal},
+    [Punctuator_NotEqual] = {8, false, ASTNodeType_NotEqual},
     
-    return Result;
-}
+    [Punctuator_Less] = {9, false, ASTNodeType_LessThan},
+    [Punctuator_LessEqual] = {9, false, ASTNodeType_LessEqual},
+    [Punctuator_Greater] = {9, false, ASTNodeType_LessThan, true},
+    [Punctuator_GreaterEqual] = {9, false, ASTNodeType_LessEqual, true},
+    
+    [Punctuator_Plus] = {11, false, ASTNodeType_Add},
+    [Punctuator_Minus] = {11, false, ASTNodeType_Sub},
+    
+    [Punctuator_Star] = {12, false, ASTNodeType_Multiply},
+    [Punctuator_Slash] = {12, false, ASTNodeType_Divide},
+};
 
-// Relational = Add ("<" Add | "<=" Add | ">" Add | ">=" Add)*
-internal ast_node *
-Relational(token *Token, token **Rest)
+// Binary = Unary (Binary-Operator Unary)*
+internal node_index
+Binary(token_index Token, token_index *Rest, uint32 MinPrecedence)
 {
-    ast_node *Result = Add(Token, &Token);
-
+    // NOTE(felipe): Precedence climbing, the operands of an operator are
+    // parsed by the same loop with a higher minimum precedence.
+    node_index Result = Unary(Token, &Token);
+    
     for(;;)
     {
-        token *Start = Token;
-        
-        if(TokenIs(Token, "<"))
-        {
-            Result = NewBinaryNode(ASTNodeType_LessThan, Result, Add(Token->Next, &Token), Start);
-        }
-        else if(TokenIs(Token, "<="))
-        {
-            Result = NewBinaryNode(ASTNodeType_LessEqual, Result, Add(Token->Next, &Token), Start);
-        }
-        if(TokenIs(Token, ">"))
-        {
-            Result = NewBinaryNode(ASTNodeType_LessThan, Add(Token->Next, &Token), Result, Start);
-        }
-        else if(TokenIs(Token, ">="))
+        token_index Operator = Token;
+        binary_operator *Entry = BinaryOperators + Kind(Operator);
+        if(!Entry->Precedence || (Entry->Precedence < MinPrecedence))
         {
-            Result = NewBinaryNode(ASTNodeType_LessEqual, Add(Token->Next, &Token), Result, Start);
-        }
-        else
-        {
-            *Rest = Token;
             break;
         }
-    }
-
-    return Result;
-}
-
-// Equality = Relational ("==" Relational | "!=" Relational)*
-internal ast_node *
-Equality(token *Token, token **Rest)
-{
-    ast_node *Result = Relational(Token, &Token);
-    
-    for(;;)
-    {
-        token *Start = Token;
         
-        if(TokenIs(Token, "=="))
-        {
-            Result = NewBinaryNode(ASTNodeType_Equal, Result, Relational(Token->Next, &Token), Start);
-        }
-        else if(TokenIs(Token, "!="))
-        {
-            Result = NewBinaryNode(ASTNodeType_NotEqual, Result, Relational(Token->Next, &Token), Start);
-        }
-        else
+        // NOTE(felipe): A left associative operator only takes tighter ones
+        // on its right, a right associative one also takes itself.
+        uint32 RightPrecedence = Entry->Precedence + (Entry->RightAssociative ? 0 : 1);
+        node_index RightHandSide = Binary(Operator + 1, &Token, RightPrecedence);
+        
+        switch(Entry->NodeType)
         {
-            *Rest = Token;
-            break;
+            case ASTNodeType_Add:
+            {
+                Result = NewAddition(Result, RightHandSide, Operator);
+            } break;
+            
+            case ASTNodeType_Sub:
+            {
+                Result = NewSubtraction(Result, RightHandSide, Operator);
+            } break;
+            
+            default:
+            {
+                if(Entry->SwapOperands)
+                {
+                    Result = NewBinaryNode(Entry->NodeType, RightHandSide, Result, Operator);
+                }
+                else
+                {
+                    Result = NewBinaryNode(Entry->NodeType, Result, RightHandSide, Operator);
+                }
+            } break;
         }
     }
     
-    return Result;
-}
-
-// Assign = Equality ("=" Assign)?
-internal ast_node *
-Assign(token *Token, token **Rest)
-{
-    ast_node *Result = Equality(Token, &Token);
-    
-    if(TokenIs(Token, "="))
-    {
-        Result = NewBinaryNode(ASTNodeType_Assign, Result, Assign(Token->Next, &Token), Token);
-    }
-    
     *Rest = Token;
-
+    
     return Result;
 }
 
-// Expression = Assign
-internal ast_node *
-Expression(token *Token, token **Rest)
+// Expression = Binary
+internal node_index
+Expression(token_index Token, token_index *Rest)
 {
-    ast_node *Result = Assign(Token, Rest);
+    node_index Result = Binary(Token, Rest, 1);
 
     return Result;
 }
 
 // Expression-Statement = ";"
 //                      | Expression ";"
-internal ast_node *
-ExpressionStatement(token *Token, token **Rest)
+internal node_index
+ExpressionStatement(token_index Token, token_index *Rest)
 {
-    ast_node *Result = 0;
+    node_index Result = 0;
     
-    if(TokenIs(Token, ";"))
+    if(Equals(Token, Punctuator_Semicolon))
     {
-        ErrorInToken(Token, "blank expressions are not supported");
+        ErrorInToken(GlobalParserTokens, Token, "blank expressions are not supported");
         
 #if 0
         Result = NewNode(NodeType_Block, Token);
-        *Rest = Token->Next;
+        *Rest = Token + 1;
 #endif
     }
     else
     {
-        Result = NewNode(ASTNodeType_Expression_Statement, Token);
-        Result->LeftHandSide = Expression(Token, &Token);
+        token_index Start = Token;
+        Result = NewUnaryNode(ASTNodeType_Expression_Statement, Expression(Token, &Token), Start);
         
-        *Rest = AssertNext(Token, ";");
+        *Rest = AssertNext(Token, Punctuator_Semicolon);
     }
     
     return Result;
 }
 
-internal ast_node *CompoundStatement(token *Token, token **Rest);
+internal node_index CompoundStatement(token_index Token, token_index *Rest);
 
 // Statement = "{" Compound-Statement
 //           | "return" Expression ";"
@@ -498,71 +651,104 @@ internal ast_node *CompoundStatement(token *Token, token **Rest);
 //           | "for" "(" ExpressionStatement Expression? ";" Expression? ")" Statement
 //           | "while" "(" Expression ")" Statement
 //           | Expresion-Statement
-internal ast_node *
-Statement(token *Token, token **Rest)
+internal node_index
+Statement(token_index Token, token_index *Rest)
 {
-    ast_node *Result = 0;
+    node_index Result = 0;
+    token_index Start = Token;
     
-    if(TokenIs(Token, "{"))
+    switch(Kind(Token))
     {
-        Result = CompoundStatement(Token->Next, &Token);
-    }
-    else if(TokenIs(Token, "return"))
-    {
-        Result = NewNode(ASTNodeType_Return, Token);
-        Result->LeftHandSide = Expression(Token->Next, &Token);
-        
-        Token = AssertNext(Token, ";");
-    }
-    else if(TokenIs(Token, "if"))
-    {
-        Result = NewNode(ASTNodeType_If, Token);
-        
-        Token = AssertNext(Token->Next, "(");
-        Result->Condition = Expression(Token, &Token);
-        Token = AssertNext(Token, ")");
-        
-        Result->Then = Statement(Token, &Token);
-        
-        if(TokenIs(Token, "else"))
+        case Punctuator_OpenBrace:
         {
-            Result->Else = Statement(Token->Next, &Token);
-        }
-    }
-    else if(TokenIs(Token, "for"))
-    {
-        Result = NewNode(ASTNodeType_For, Token);
+            Result = CompoundStatement(Token + 1, &Token);
+        } break;
         
-        Token = AssertNext(Token->Next, "(");
-        Result->Init = ExpressionStatement(Token, &Token);
-
-        if(!TokenIs(Token, ";"))
+        case Keyword_Return:
         {
-            Result->Condition = Expression(Token, &Token);
-        }
-        Token = AssertNext(Token, ";");
-
-        if(!TokenIs(Token, ")"))
+            node_index Value = Expression(Token + 1, &Token);
+            Result = NewUnaryNode(ASTNodeType_Return, Value, Start);
+            
+            Token = AssertNext(Token, Punctuator_Semicolon);
+        } break;
+        
+        case Keyword_If:
         {
-            Result->Increment = Expression(Token, &Token);
-        }
-        Token = AssertNext(Token, ")");
+            node_index Condition = 0;
+            node_index Then = 0;
+            node_index Else = 0;
+            
+            Token = AssertNext(Token + 1, Punctuator_OpenParen);
+            Condition = Expression(Token, &Token);
+            Token = AssertNext(Token, Punctuator_CloseParen);
+            
+            Then = Statement(Token, &Token);
+            
+            if(Equals(Token, Keyword_Else))
+            {
+                Else = Statement(Token + 1, &Token);
+            }
+            
+            Result = NewNode(ASTNodeType_If, sizeof(ast_if), Start);
+            ast_if *If = GetNodeAs(ast_if, Result);
+            If->Condition = Condition;
+            If->Then = Then;
+            If->Else = Else;
+        } break;
         
-        Result->Then = Statement(Token, &Token);
-    }
-    else if(TokenIs(Token, "while"))
-    {
-        Result = NewNode(ASTNodeType_For, Token);
+        case Keyword_For:
+        {
+            node_index Init = 0;
+            node_index Condition = 0;
+            node_index Increment = 0;
+            node_index Then = 0;
+            
+            Token = AssertNext(Token + 1, Punctuator_OpenParen);
+            Init = ExpressionStatement(Token, &Token);
+            
+            if(!Equals(Token, Punctuator_Semicolon))
+            {
+                Condition = Expression(Token, &Token);
+            }
+            Token = AssertNext(Token, Punctuator_Semicolon);
+            
+            if(!Equals(Token, Punctuator_CloseParen))
+            {
+                Increment = Expression(Token, &Token);
+            }
+            Token = AssertNext(Token, Punctuator_CloseParen);
+            
+            Then = Statement(Token, &Token);
+            
+            Result = NewNode(ASTNodeType_For, sizeof(ast_for), Start);
+            ast_for *For = GetNodeAs(ast_for, Result);
+            For->Init = Init;
+            For->Condition = Condition;
+            For->Increment = Increment;
+            For->Then = Then;
+        } break;
         
-        Token = AssertNext(Token->Next, "(");
-        Result->Condition = Expression(Token, &Token);
+        case Keyword_While:
+        {
+            node_index Condition = 0;
+            node_index Then = 0;
+            
+            Token = AssertNext(Token + 1, Punctuator_OpenParen);
+            Condition = Expression(Token, &Token);
+            
+            Token = AssertNext(Token, Punctuator_CloseParen);
+            Then = Statement(Token, &Token);
+            
+            Result = NewNode(ASTNodeType_For, sizeof(ast_for), Start);
+            ast_for *For = GetNodeAs(ast_for, Result);
+            For->Condition = Condition;
+            For->Then = Then;
+        } break;
         
-        Token = AssertNext(Token, ")");
-        Result->Then = Statement(Token, &Token);
-    }    
-    else
-    {
-        Result = ExpressionStatement(Token, &Token);
+        default:
+        {
+            Result = ExpressionStatement(Token, &Token);
+        } break;
     }
     
     *Rest = Token;
@@ -571,46 +757,73 @@ Statement(token *Token, token **Rest)
 }
 
 // Compound-Statement = Statement* "}"
-internal ast_node *
-CompoundStatement(token *Token, token **Rest)
+internal node_index
+CompoundStatement(token_index Token, token_index *Rest)
 {
-    ast_node *Result = NewNode(ASTNodeType_Block, Token);
+    token_index Start = Token;
     
-    ast_node Head = {0};
-    ast_node *Current = &Head;
+    // NOTE(felipe): The statements are only known once the block is closed,
+    // they wait on the stack and are then copied right after the block node.
+    temporary_memory StatementMemory = BeginTemporaryMemory(&GlobalStatementStack);
+    uint32 Count = 0;
     
-    while(!TokenIs(Token, "}"))
+    EnterScope(&GlobalScopes);
+    while(!Equals(Token, Punctuator_CloseBrace))
     {
-        Current->Next = Statement(Token, &Token);
-        Current = Current->Next;
+        node_index Child = Statement(Token, &Token);
+        *PushStruct(&GlobalStatementStack, node_index) = Child;
+        ++Count;
     }
+    LeaveScope(&GlobalScopes);
     
-    Result->Body = Head.Next;
-    *Rest = Token->Next;
+    node_index Result = NewNode(ASTNodeType_Block, sizeof(ast_block) + Count*sizeof(node_index), Start);
+    ast_block *Block = GetNodeAs(ast_block, Result);
+    Block->Count = Count;
+    
+    node_index *Statements = (node_index *)(GlobalStatementStack.Memory + StatementMemory.Used);
+    node_index *Destination = GetBlockStatements(Block);
+    for(uint32 StatementIndex = 0;
+        StatementIndex < Count;
+        ++StatementIndex)
+    {
+        Destination[StatementIndex] = Statements[StatementIndex];
+    }
+    
+    EndTemporaryMemory(StatementMemory);
+    *Rest = Token + 1;
     
     return Result;
 }
 
 // Function = ID "(" ")" Statement
 internal object *
-Function(token *Token, token **Rest)
+Function(token_index Token, token_index *Rest)
 {
     object *Result = 0;
     
     // TODO(felipe): Improve error messages.
-    if(Token->TokenType == TokenType_Identifier)
+    if(GetTokenType(GlobalParserTokens, Token) == TokenType_Identifier)
     {
-        Result = calloc(1, sizeof(object));
-        Result->Name = StringFromToken(Token);
+        Result = PushStruct(GlobalParserArena, object);
+        Result->Name = GetTokenAtom(GlobalParserTokens, Token);
         Result->Type = ObjectType_Function;
-        Result->Storage = ObjectStorage_Local;
+        Result->Storage = ObjectStorage_Global;
+        
+        BindObject(&GlobalScopes, GlobalScopes.GlobalScope, Result);
+        
+        ++Token;
         
-        Token = Token->Next;
+        Token = AssertNext(Token, Punctuator_OpenParen);
+        Token = AssertNext(Token, Punctuator_CloseParen);
         
-        Token = AssertNext(Token, "(");
-        Token = AssertNext(Token, ")");
+        EnterScope(&GlobalScopes);
+        GlobalScopes.FunctionScope = GlobalScopes.Scope;
         
         Result->Body = Statement(Token, &Token);
+        
+        LeaveScope(&GlobalScopes);
+        GlobalScopes.FunctionScope = 0;
+        
         Result->LocalVariables = GlobalVariablesHead.Next;
         GlobalVariablesHead.Next = 0;
         GlobalVariables = &GlobalVariablesHead;
@@ -619,7 +832,7 @@ Function(token *Token, token **Rest)
     }
     else
     {
-        ErrorInToken(Token, "expected an identifier");
+        ErrorInToken(GlobalParserTokens, Token, "expected an identifier");
     }
     
     return Result;
@@ -627,20 +840,29 @@ Function(token *Token, token **Rest)
 
 // Program = Function*
 internal program *
-Program(token *Token, token **Rest)
+Program(token_index Token, token_index *Rest)
 {    
     program *Result = 0;
     
     object Head = {0};
     object *Current = &Head;
     
-    while(Token->TokenType != TokenType_EOF)
+    BeginScopeTable(&GlobalScopes, GlobalParserArena);
+    BeginTypeTable(&GlobalTypes, GlobalParserArena);
+    EnterScope(&GlobalScopes);
+    GlobalScopes.GlobalScope = GlobalScopes.Scope;
+    
+    while(GetTokenType(GlobalParserTokens, Token) != TokenType_EOF)
     {
         Current->Next = Function(Token, &Token);
         Current = Current->Next;
+        
+        // NOTE(felipe): Nothing refers to the tokens of a parsed function,
+        // the token window can reuse them.
+        ReleaseTokens(GlobalParserTokens, Token);
     }
 
-    Result = calloc(1, sizeof(program));
+    Result = PushStruct(GlobalParserArena, program);
     Result->Objects = Head.Next;
     
     return Result;
@@ -680,114 +902,207 @@ char *NodeTypes[] =
 uint32 LastDepth = 0;
 
 internal void
-PrintASTNode(ast_node *Node, uint32 Depth)
+PrintASTNode(node_index Index, uint32 Depth)
 {
     Assert(ArrayCount(NodeTypes) == ASTNodeType_Count);
     
     // NOTE(felipe): It's debug code, don't worry.
-    for(;
-        Node;
-        Node = Node->Next)
+    ast_node *Node = GetNode(Index);
+    
+    printf(" ");
+    if(LastDepth > Depth)
     {
-        printf(" ");
-        if(LastDepth > Depth)
-        {
-            for(uint32 I = 0;
-                I < Depth;
-                ++I)
-            {
-                printf("| ");
-            }
-            
-            printf("\n ");
-        }
-        
         for(uint32 I = 0;
             I < Depth;
             ++I)
         {
-            if(I == (Depth - 1))
-            {
-                printf("|-");
-            }
-            else
-            {
-                printf("| ");
-            }
+            printf("| ");
         }
         
-        printf("Node: type: %s", NodeTypes[Node->NodeType]);
-        
-        switch(Node->NodeType)
+        printf("\n ");
+    }
+    
+    for(uint32 I = 0;
+        I < Depth;
+        ++I)
+    {
+        if(I == (Depth - 1))
         {
-            case ASTNodeType_Number:
-            {
-                printf(" (%lld)", Node->NumericalValue);
-            } break;
-            
-            case ASTNodeType_Variable:
-            {
-                printf(" (%s)", Node->Variable->Name);                
-            } break;
-            
-//            case ASTNodeType_Function:
-//            {
-//                printf(" (%s)", Node->FunctionName);                
-//            } break;
+            printf("|-");
         }
-        
-        printf("\n");
-        
-        LastDepth = Depth;
-        
-        if(Node->LeftHandSide)
+        else
         {
-            PrintASTNode(Node->LeftHandSide, Depth + 1);
+            printf("| ");
         }
-        if(Node->RightHandSide)
+    }
+    
+    printf("Node: type: %s", NodeTypes[Node->NodeType]);
+    
+    switch(Node->NodeType)
+    {
+        case ASTNodeType_Number:
         {
-            PrintASTNode(Node->RightHandSide, Depth + 1);
-        }
+            printf(" (%lld)", ((ast_number *)Node)->Value);
+        } break;
         
-        if(Node->Body)
+        case ASTNodeType_Variable:
         {
-            PrintASTNode(Node->Body, Depth + 1);
-        }
+            printf(" (%s)", GetAtomString(((ast_variable *)Node)->Variable->Name));                
+        } break;
+    }
+    
+    printf("\n");
+    
+    LastDepth = Depth;
+    
+    switch(Node->NodeType)
+    {
+        case ASTNodeType_Negate:
+        case ASTNodeType_Dereference:
+        case ASTNodeType_Address:
+        case ASTNodeType_Expression_Statement:
+        case ASTNodeType_Return:
+        {
+            PrintASTNode(((ast_unary *)Node)->Operand, Depth + 1);
+        } break;
+        
+        case ASTNodeType_Add:
+        case ASTNodeType_Sub:
+        case ASTNodeType_Multiply:
+        case ASTNodeType_Divide:
+        case ASTNodeType_Equal:
+        case ASTNodeType_NotEqual:
+        case ASTNodeType_LessThan:
+        case ASTNodeType_LessEqual:
+        case ASTNodeType_Assign:
+        {
+            PrintASTNode(((ast_binary *)Node)->LeftHandSide, Depth + 1);
+            PrintASTNode(((ast_binary *)Node)->RightHandSide, Depth + 1);
+        } break;
+        
+        case ASTNodeType_Block:
+        {
+            ast_block *Block = (ast_block *)Node;
+            node_index *Statements = GetBlockStatements(Block);
+            for(uint32 StatementIndex = 0;
+                StatementIndex < Block->Count;
+                ++StatementIndex)
+            {
+                PrintASTNode(Statements[StatementIndex], Depth + 1);
+            }
+        } break;
     }
 }
 
 internal program *
-ParseTokens(token *Tokens)
+ParseTokens(memory_arena *Arena, memory_arena *NodeArena, token_buffer *Tokens)
 {
     program *Result = 0;
     
-    Result = Program(Tokens, &Tokens);
+    GlobalParserArena = Arena;
+    GlobalParserTokens = Tokens;
+    
+    // NOTE(felipe): The first slot is never handed out, index 0 means no node.
+    Assert(NodeArena->Used == 0);
+    PushSize_(NodeArena, AST_NODE_ALIGNMENT, AST_NODE_ALIGNMENT);
+    GlobalNodeArena = NodeArena;
+    GlobalNodes = NodeArena->Memory;
+    GlobalNodeCount = 0;
+    
+    token_index Token = 0;
+    Result = Program(Token, &Token);
+    Result->Nodes = GlobalNodes;
+    Result->NodeCount = GlobalNodeCount;
+    
+    ReleaseArena(&GlobalStatementStack);
     
-    // DEBUG(felipe): Print functions
-    printf("\nFunctions\n");
-    for(object *Object = Result->Objects;
-        Object;
-        Object = Object->Next)
+    if(GlobalOptions.DumpAST)
     {
-        printf("- %s\n", Object->Name);
+        // DEBUG(felipe): Print functions
+        printf("\nFunctions\n");
+        for(object *Object = Result->Objects;
+            Object;
+            Object = Object->Next)
+        {
+            printf("- %s\n", GetAtomString(Object->Name));
+            
+            for(object *Variable = Object->LocalVariables;
+                Variable;
+                Variable = Variable->Next)
+            {
+                printf("    %s\n", GetAtomString(Variable->Name));
+            }
+        }
         
-        for(object *Variable = Object->LocalVariables;
-            Variable;
-            Variable = Variable->Next)
+        // DEBUG(felipe): Print AST node tree.
+        printf("\nAST\n");
+        for(object *Object = Result->Objects;
+            Object;
+            Object = Object->Next)
         {
-            printf("    %s\n", Variable->Name);
+            printf("%s()\n", GetAtomString(Object->Name));
+            PrintASTNode(Object->Body, 1);
         }
     }
     
-    // DEBUG(felipe): Print AST node tree.
-    printf("\nAST\n");
-    for(object *Object = Result->Objects;
-        Object;
-        Object = Object->Next)
+    return Result;
+}
+
+internal void
+BenchmarkParser(memory_arena *Arena, memory_arena *NodeArena, loaded_file *File)
+{
+    // NOTE(felipe): Parses the lexed file without preprocessing it. Program
+    // releases the tokens it parsed, so every run gets a freshly lexed
+    // buffer, lexing is not timed.
+    PushSize_(NodeArena, AST_NODE_ALIGNMENT, AST_NODE_ALIGNMENT);
+    GlobalNodeArena = NodeArena;
+    GlobalNodes = NodeArena->Memory;
+    
+    uint32 TokenCount = 0;
+    uint32 NodeCount = 0;
+    memory_index NodeBytes = 0;
+    uint32 Runs = 0;
+    real64 BestSeconds = 0;
+    real64 TotalSeconds = 0;
+    for(uint32 Run = 0;
+        Run < 5 || TotalSeconds < 1.0;
+        ++Run)
     {
-        printf("%s()\n", Object->Name);
-        PrintASTNode(Object->Body, 1);
+        temporary_memory ParseMemory = BeginTemporaryMemory(Arena);
+        temporary_memory NodeMemory = BeginTemporaryMemory(NodeArena);
+        
+        token_buffer *Tokens = Tokenize(Arena, File);
+        TokenCount = Tokens->Count;
+        
+        GlobalParserArena = Arena;
+        GlobalParserTokens = Tokens;
+        GlobalNodeCount = 0;
+        
+        uint64 Start = PlatformGetWallClock();
+        token_index Token = 0;
+        Program(Token, &Token);
+        real64 Seconds = PlatformGetSecondsElapsed(Start, PlatformGetWallClock());
+        
+        NodeCount = GlobalNodeCount;
+        NodeBytes = NodeArena->Used;
+        
+        EndTemporaryMemory(NodeMemory);
+        EndTemporaryMemory(ParseMemory);
+        
+        if(Run == 0 || Seconds < BestSeconds)
+        {
+            BestSeconds = Seconds;
+        }
+        TotalSeconds += Seconds;
+        ++Runs;
     }
     
-    return Result;
+    printf("Parser benchmark: %s (%llu bytes, %u tokens, best of %u runs)\n",
+           File->Filename, (unsigned long long)File->Size, TokenCount, Runs);
+    printf("  %10.2f Mtokens/s %10.2f MB/s %8.3f ms\n",
+           (real64)TokenCount / BestSeconds / 1000000.0,
+           (real64)File->Size / BestSeconds / (1024.0*1024.0), BestSeconds*1000.0);
+    printf("  %u AST nodes in %llu bytes\n", NodeCount, (unsigned long long)NodeBytes);
+    
+    ReleaseArena(&GlobalStatementStack);
 }
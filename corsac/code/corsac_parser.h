@@ -7,6 +7,15 @@
    $Notice: Copyright  2022 Felipe Carlin $
    ======================================================================== */
 
+// NOTE(felipe): Nodes are stored one after the other in an arena of their
+// own and refer to each other by index, the offset of the node in
+// AST_NODE_ALIGNMENT units. Zero is no node. Every node starts with an
+// ast_node and carries only the payload of its type after it, children are
+// pushed before their parent.
+typedef uint32 node_index;
+
+#define AST_NODE_ALIGNMENT 8
+
 typedef enum object_type
 {
     ObjectType_Null,
@@ -24,7 +33,7 @@ typedef enum object_storage
 // NOTE(felipe): Functions, Variables.
 typedef struct object
 {
-    char *Name;
+    atom Name;
     
     object_type Type;
     object_storage Storage;
@@ -35,23 +44,76 @@ typedef struct object
     uint32 StackBaseOffset;
 
     // Function
-    struct ast_node *Body;
+    node_index Body;
     struct object *LocalVariables;
     uint32 StackSize;
 } object;
 
+// NOTE(felipe): A name bound in a scope. It hides the bindings of the same
+// name in the enclosing scopes until its own scope is left.
+typedef struct binding
+{
+    object *Object;
+    
+    struct binding *Shadowed;
+    struct binding *NextInScope;
+} binding;
+
+typedef struct binding_slot
+{
+    atom Name;
+    binding *Binding;
+} binding_slot;
+
+typedef struct scope
+{
+    binding *Bindings;
+    struct scope *Parent;
+} scope;
+
+// NOTE(felipe): The slots of Map are binding_slots, each holds the innermost
+// binding of its name. Leaving a scope only clears bindings.
+typedef struct scope_table
+{
+    memory_arena *Arena;
+    
+    atom_map Map;
+    
+    scope *Scope;
+    scope *GlobalScope;
+    scope *FunctionScope;
+    
+    scope *FirstFreeScope;
+    binding *FirstFreeBinding;
+} scope_table;
+
+#define MIN_BINDING_SLOT_COUNT 256
+
 typedef enum type_kind
 {
     TypeKind_Int,
     TypeKind_Pointer,
 } type_kind;
 
+// NOTE(felipe): Types are hash-consed, equal types are the same
+// variable_type and compare equal as pointers. Int is GlobalTypeInt.
 typedef struct variable_type
 {
     type_kind Kind;
     struct variable_type *Base;
 } variable_type;
 
+typedef struct type_table
+{
+    memory_arena *Arena;
+    
+    uint32 Count;
+    uint32 SlotCount;
+    variable_type **Slots;
+} type_table;
+
+#define MIN_TYPE_SLOT_COUNT 64
+
 typedef enum ast_node_type
 {
     ASTNodeType_Number,                  // Integer
@@ -89,36 +151,83 @@ typedef enum ast_node_type
 typedef struct ast_node
 {
     ast_node_type NodeType;
-
-    variable_type *Type;
-    
-    struct ast_node *Next;
-    struct ast_node *LeftHandSide;
-    struct ast_node *RightHandSide;
-
-    // NOTE(felipe): Representative token for nicer error logging.
-    token *Token;
-    
-    struct ast_node *Body;
     
-    // "if" / "for" statement
-    struct ast_node *Init;
-    struct ast_node *Condition;
-    struct ast_node *Increment;
-    struct ast_node *Then;
-    struct ast_node *Else;
+    // NOTE(felipe): Location of the representative token for nicer error
+    // logging.
+    source_location Location;
     
-    // Node Number
-    uint64 NumericalValue;
+    variable_type *Type;
+} ast_node;
+
+// Negate, Dereference, Address, Expression_Statement, Return
+typedef struct ast_unary
+{
+    ast_node Node;
+    node_index Operand;
+} ast_unary;
 
-    // Node Variable
+// Add, Sub, Multiply, Divide, Equal, NotEqual, LessThan, LessEqual, Assign
+typedef struct ast_binary
+{
+    ast_node Node;
+    node_index LeftHandSide;
+    node_index RightHandSide;
+} ast_binary;
+
+typedef struct ast_number
+{
+    ast_node Node;
+    uint64 Value;
+} ast_number;
+
+typedef struct ast_variable
+{
+    ast_node Node;
     object *Variable;
-} ast_node;
+} ast_variable;
+
+// NOTE(felipe): The indices of the statements follow the block.
+typedef struct ast_block
+{
+    ast_node Node;
+    uint32 Count;
+} ast_block;
+
+typedef struct ast_if
+{
+    ast_node Node;
+    node_index Condition;
+    node_index Then;
+    node_index Else;
+} ast_if;
+
+// NOTE(felipe): "while" is a "for" with only Condition and Then.
+typedef struct ast_for
+{
+    ast_node Node;
+    node_index Init;
+    node_index Condition;
+    node_index Increment;
+    node_index Then;
+} ast_for;
+
+typedef struct binary_operator
+{
+    uint8 Precedence;
+    uint8 RightAssociative;
+    uint8 NodeType;
+    
+    // NOTE(felipe): `a > b` is parsed as `b < a`.
+    uint8 SwapOperands;
+} binary_operator;
 
 typedef struct program
 {
     // NOTE(felipe): All nodes should be functions.
     object *Objects;
+    
+    uint8 *Nodes;
+    uint32 NodeCount;
 } program;
 
 #define CORSAC_PARSER_H
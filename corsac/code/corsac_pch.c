@@ -0,0 +1,336 @@
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Felipe Carlin $
+   $Notice: Copyright  2022 Felipe Carlin $
+   ======================================================================== */
+
+#include "corsac_pch.h"
+
+//
+// NOTE(felipe): Writing
+//
+
+internal uint32
+PushPchData(memory_arena *Image, void *Data, uint32 Size, memory_index Alignment)
+{
+    // NOTE(felipe): Image is pushed on by nothing else, so it is one block
+    // that starts at its Memory.
+    uint8 *Destination = (uint8 *)PushSize_(Image, Size, Alignment);
+    if(Size)
+    {
+        MemCopy(Destination, Data, Size);
+    }
+    
+    uint32 Result = (uint32)(Destination - Image->Memory);
+    return Result;
+}
+
+internal pch_tokens
+PushPchTokens(memory_arena *Image, token_buffer *Buffer)
+{
+    Assert(!Buffer->First);
+    
+    pch_tokens Result = {0};
+    Result.Count = Buffer->Count;
+    Result.LiteralCount = Buffer->LiteralCount;
+    
+    Result.TypesOffset = PushPchData(Image, Buffer->Types, Buffer->Count*sizeof(uint8), 1);
+    Result.FlagsOffset = PushPchData(Image, Buffer->Flags, Buffer->Count*sizeof(uint8), 1);
+    Result.LocationsOffset = PushPchData(Image, Buffer->Locations, Buffer->Count*sizeof(source_location),
+                                         AlignOf(source_location));
+    Result.LengthsOffset = PushPchData(Image, Buffer->Lengths, Buffer->Count*sizeof(uint32), AlignOf(uint32));
+    Result.ValuesOffset = PushPchData(Image, Buffer->Values, Buffer->Count*sizeof(uint32), AlignOf(uint32));
+    Result.LiteralsOffset = PushPchData(Image, Buffer->Literals, Buffer->LiteralCount*sizeof(uint64),
+                                        AlignOf(uint64));
+    
+    return Result;
+}
+
+internal char *
+FindCachedPath(loaded_file *File)
+{
+    file_table *Table = &GlobalFiles;
+    
+    char *Result = 0;
+    for(uint32 Slot = 0;
+        Slot < Table->SlotCount;
+        ++Slot)
+    {
+        if(Table->Slots[Slot].File == File)
+        {
+            Result = Table->Slots[Slot].Path;
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+internal void
+EmitPrecompiledHeader(memory_arena *Arena, preprocessor *Preprocessor, token_buffer *Tokens, char *Filename)
+{
+    // NOTE(felipe): Runs the preprocessor over the whole header and writes
+    // out everything a later compile needs to go on from where it stopped.
+    // Every file and atom that exists at this point is stored, the header
+    // has to be the first thing that was loaded.
+    token_buffer *Output = NewTokenBuffer(Arena, 0, 0);
+    
+    token_index Token = 0;
+    while(GetTokenType(Tokens, Token) != TokenType_EOF)
+    {
+        CopyToken(Output, Tokens, Token);
+        ++Token;
+        ReleaseTokens(Tokens, Token);
+    }
+    
+    memory_arena Image = {0};
+    
+    pch_header *Header = PushStruct(&Image, pch_header);
+    Header->Magic = PCH_MAGIC;
+    Header->Version = PCH_VERSION;
+    
+    // NOTE(felipe): Atoms.
+    atom_table *Atoms = &GlobalAtoms;
+    Header->AtomCount = Atoms->Count;
+    pch_atom *PchAtoms = PushArray(&Image, Atoms->Count, pch_atom);
+    Header->AtomsOffset = (uint32)((uint8 *)PchAtoms - Image.Memory);
+    for(atom Atom = 1;
+        Atom <= Atoms->Count;
+        ++Atom)
+    {
+        atom_entry *Entry = Atoms->Entries + Atom;
+        pch_atom *PchAtom = PchAtoms + (Atom - 1);
+        PchAtom->StringOffset = PushPchData(&Image, Entry->String, Entry->Length + 1, 1);
+        PchAtom->Length = Entry->Length;
+    }
+    
+    // NOTE(felipe): Files.
+    file_table *Files = &GlobalFiles;
+    Header->FileCount = Files->Count;
+    pch_file *PchFiles = PushArray(&Image, Files->Count, pch_file);
+    Header->FilesOffset = (uint32)((uint8 *)PchFiles - Image.Memory);
+    for(uint32 Index = 0;
+        Index < Files->Count;
+        ++Index)
+    {
+        loaded_file *File = Files->Files + Index;
+        pch_file *PchFile = PchFiles + Index;
+        
+        PchFile->NameOffset = PushPchData(&Image, File->Filename, StringLength(File->Filename) + 1, 1);
+        
+        char *Path = FindCachedPath(File);
+        if(Path)
+        {
+            PchFile->PathOffset = PushPchData(&Image, Path, StringLength(Path) + 1, 1);
+        }
+        
+        PchFile->DataOffset = PushPchData(&Image, File->Memory, SafeTruncateUInt64(File->Size) + 1, 1);
+        PchFile->Size = SafeTruncateUInt64(File->Size);
+        PchFile->BaseLocation = File->BaseLocation;
+        
+        if(Index < Preprocessor->HeaderCapacity)
+        {
+            header_info *HeaderInfo = Preprocessor->Headers + Index;
+            PchFile->GuardName = HeaderInfo->GuardName;
+            PchFile->PragmaOnce = HeaderInfo->PragmaOnce;
+        }
+    }
+    
+    // NOTE(felipe): Macros, their tokens are stored whole, with the ones of
+    // macros that were undefined or redefined since.
+    macro_table *Macros = &Preprocessor->Macros;
+    Header->MacroCount = Macros->Count;
+    pch_macro *PchMacros = PushArray(&Image, Macros->Count, pch_macro);
+    Header->MacrosOffset = (uint32)((uint8 *)PchMacros - Image.Memory);
+    
+    macro_slot *Slots = (macro_slot *)Macros->Map.Slots;
+    uint32 MacroIndex = 0;
+    for(uint32 Slot = 0;
+        Slot < Macros->Map.SlotCount;
+        ++Slot)
+    {
+        macro *Macro = Slots[Slot].Macro;
+        if(Macro)
+        {
+            Assert(Macro->Tokens == Preprocessor->MacroTokens);
+            
+            pch_macro *PchMacro = PchMacros + MacroIndex++;
+            PchMacro->Name = Macro->Name;
+            PchMacro->Identifier = Macro->Identifier;
+            PchMacro->Start = Macro->Start;
+            PchMacro->End = Macro->End;
+            PchMacro->FunctionLike = Macro->FunctionLike;
+            PchMacro->Variadic = Macro->Variadic;
+            PchMacro->ParameterCount = Macro->ParameterCount;
+            PchMacro->HasPaste = Macro->HasPaste;
+            
+            if(Macro->FunctionLike)
+            {
+                PchMacro->ParameterRefsOffset = PushPchData(&Image, Macro->ParameterRefs, Macro->End - Macro->Start, 1);
+            }
+        }
+    }
+    Assert(MacroIndex == Macros->Count);
+    
+    Header->MacroTokens = PushPchTokens(&Image, Preprocessor->MacroTokens);
+    Header->OutputTokens = PushPchTokens(&Image, Output);
+    
+    PushSize(&Image, PCH_PADDING);
+    
+    if(!PlatformWriteEntireFile(Filename, Image.Memory, Image.Used))
+    {
+        Error("could not write precompiled header: %s", Filename);
+    }
+    
+    ReleaseArena(&Image);
+}
+
+//
+// NOTE(felipe): Reading
+//
+
+internal token_buffer *
+GetPchTokens(memory_arena *Arena, uint8 *Base, pch_tokens *Tokens)
+{
+    // NOTE(felipe): The arrays stay in the block. Nothing pushes on these
+    // buffers, they are only read.
+    token_buffer *Result = PushStruct(Arena, token_buffer);
+    Result->Arena = Arena;
+    Result->First = 0;
+    Result->Count = Tokens->Count;
+    Result->Capacity = Tokens->Count;
+    Result->Fill = 0;
+    Result->FillContext = 0;
+    
+    Result->Types = Base + Tokens->TypesOffset;
+    Result->Flags = Base + Tokens->FlagsOffset;
+    Result->Locations = (source_location *)(Base + Tokens->LocationsOffset);
+    Result->Lengths = (uint32 *)(Base + Tokens->LengthsOffset);
+    Result->Values = (uint32 *)(Base + Tokens->ValuesOffset);
+    
+    Result->LiteralCount = Tokens->LiteralCount;
+    Result->LiteralCapacity = Tokens->LiteralCount;
+    Result->Literals = (uint64 *)(Base + Tokens->LiteralsOffset);
+    
+    return Result;
+}
+
+internal precompiled_header *
+LoadPrecompiledHeader(memory_arena *Arena, char *Filename)
+{
+    // NOTE(felipe): Has to run before any file other than the header is
+    // loaded and any identifier is lexed. The files of the header are added
+    // to the file table with their text in the block.
+    loaded_file File = PlatformReadEntireFile(Filename);
+    if(!File.Memory)
+    {
+        Error("could not open precompiled header: %s", Filename);
+    }
+    
+    uint8 *Base = (uint8 *)File.Memory;
+    pch_header *Header = (pch_header *)Base;
+    if((File.Size < sizeof(pch_header)) || (Header->Magic != PCH_MAGIC) || (Header->Version != PCH_VERSION))
+    {
+        Error("not a precompiled header of this version: %s", Filename);
+    }
+    
+    if(GlobalFiles.Count)
+    {
+        Error("precompiled header %s has to be loaded before any other file", Filename);
+    }
+    
+    pch_atom *PchAtoms = (pch_atom *)(Base + Header->AtomsOffset);
+    for(atom Atom = 1;
+        Atom <= Header->AtomCount;
+        ++Atom)
+    {
+        pch_atom *PchAtom = PchAtoms + (Atom - 1);
+        if(InternAtom((char *)Base + PchAtom->StringOffset, PchAtom->Length) != Atom)
+        {
+            Error("precompiled header %s was made by a different compiler", Filename);
+        }
+    }
+    
+    pch_file *PchFiles = (pch_file *)(Base + Header->FilesOffset);
+    for(uint32 Index = 0;
+        Index < Header->FileCount;
+        ++Index)
+    {
+        pch_file *PchFile = PchFiles + Index;
+        
+        loaded_file HeaderFile = {0};
+        HeaderFile.Filename = (char *)Base + PchFile->NameOffset;
+        HeaderFile.Memory = Base + PchFile->DataOffset;
+        HeaderFile.Size = PchFile->Size;
+        
+        loaded_file *Added = AddFile(HeaderFile);
+        Assert(Added->BaseLocation == PchFile->BaseLocation);
+        
+        if(PchFile->PathOffset)
+        {
+            char *Path = (char *)Base + PchFile->PathOffset;
+            file_slot *Slot = FindFileSlot(&GlobalFiles, Path);
+            Assert(!Slot->File);
+            CacheFile(&GlobalFiles, Slot, Path, Added);
+        }
+    }
+    
+    precompiled_header *Result = PushStruct(Arena, precompiled_header);
+    Result->Filename = Filename;
+    Result->Base = Base;
+    Result->Header = Header;
+    
+    return Result;
+}
+
+internal void
+UsePrecompiledHeader(preprocessor *Preprocessor, precompiled_header *PrecompiledHeader)
+{
+    // NOTE(felipe): Puts Preprocessor where it was at the end of the header,
+    // with the output of the header still to come.
+    uint8 *Base = PrecompiledHeader->Base;
+    pch_header *Header = PrecompiledHeader->Header;
+    
+    token_buffer *MacroTokens = GetPchTokens(Preprocessor->Arena, Base, &Header->MacroTokens);
+    
+    pch_macro *PchMacros = (pch_macro *)(Base + Header->MacrosOffset);
+    for(uint32 Index = 0;
+        Index < Header->MacroCount;
+        ++Index)
+    {
+        pch_macro *PchMacro = PchMacros + Index;
+        
+        macro Macro = {0};
+        Macro.Tokens = MacroTokens;
+        Macro.Identifier = PchMacro->Identifier;
+        Macro.Name = PchMacro->Name;
+        Macro.Start = PchMacro->Start;
+        Macro.End = PchMacro->End;
+        Macro.FunctionLike = PchMacro->FunctionLike;
+        Macro.Variadic = PchMacro->Variadic;
+        Macro.ParameterCount = PchMacro->ParameterCount;
+        Macro.HasPaste = PchMacro->HasPaste;
+        if(Macro.FunctionLike)
+        {
+            Macro.ParameterRefs = Base + PchMacro->ParameterRefsOffset;
+        }
+        
+        DefineMacro(Preprocessor->Arena, &Preprocessor->Macros, &Macro);
+    }
+    
+    pch_file *PchFiles = (pch_file *)(Base + Header->FilesOffset);
+    for(uint32 Index = 0;
+        Index < Header->FileCount;
+        ++Index)
+    {
+        header_info *HeaderInfo = GetHeaderInfo(Preprocessor, GlobalFiles.Files + Index);
+        HeaderInfo->GuardName = PchFiles[Index].GuardName;
+        HeaderInfo->PragmaOnce = PchFiles[Index].PragmaOnce;
+    }
+    
+    Preprocessor->PrefixTokens = GetPchTokens(Preprocessor->Arena, Base, &Header->OutputTokens);
+    Preprocessor->PrefixToken = 0;
+    Preprocessor->PrefixEnd = Header->OutputTokens.Count;
+}
@@ -0,0 +1,100 @@
+#if !defined(CORSAC_PCH_H)
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Felipe Carlin $
+   $Notice: Copyright  2022 Felipe Carlin $
+   ======================================================================== */
+
+// NOTE(felipe): A precompiled header is a single block without pointers in
+// it, every section is found by its offset from the start of the block, so
+// it is used right where it is mapped. Atoms and source locations are stored
+// as they were when the header was made. Loading the block before any other
+// file or identifier gives them the same numbers again, so tokens and macros
+// are used without being touched.
+#define PCH_MAGIC 0x48435043
+#define PCH_VERSION 1
+
+typedef struct pch_tokens
+{
+    uint32 Count;
+    uint32 LiteralCount;
+    
+    uint32 TypesOffset;
+    uint32 FlagsOffset;
+    uint32 LocationsOffset;
+    uint32 LengthsOffset;
+    uint32 ValuesOffset;
+    uint32 LiteralsOffset;
+} pch_tokens;
+
+// NOTE(felipe): The text of a file is stored whole, with its terminator.
+// PathOffset is zero for files that were not loaded from a path, like the
+// scratch space.
+typedef struct pch_file
+{
+    uint32 NameOffset;
+    uint32 PathOffset;
+    uint32 DataOffset;
+    uint32 Size;
+    source_location BaseLocation;
+    
+    atom GuardName;
+    bool32 PragmaOnce;
+} pch_file;
+
+typedef struct pch_atom
+{
+    uint32 StringOffset;
+    uint32 Length;
+} pch_atom;
+
+typedef struct pch_macro
+{
+    atom Name;
+    token_index Identifier;
+    token_index Start;
+    token_index End;
+    
+    bool32 FunctionLike;
+    bool32 Variadic;
+    uint32 ParameterCount;
+    uint32 ParameterRefsOffset;
+    bool32 HasPaste;
+} pch_macro;
+
+typedef struct pch_header
+{
+    uint32 Magic;
+    uint32 Version;
+    
+    // NOTE(felipe): Atoms from 1 on, keywords included.
+    uint32 AtomCount;
+    uint32 AtomsOffset;
+    
+    uint32 FileCount;
+    uint32 FilesOffset;
+    
+    uint32 MacroCount;
+    uint32 MacrosOffset;
+    pch_tokens MacroTokens;
+    
+    // NOTE(felipe): What preprocessing the header gave, it comes out of the
+    // preprocessor before the main file.
+    pch_tokens OutputTokens;
+} pch_header;
+
+// NOTE(felipe): Bytes of zeros past the last section, the scanners may read
+// a little past the terminator of the last file.
+#define PCH_PADDING 64
+
+typedef struct precompiled_header
+{
+    char *Filename;
+    uint8 *Base;
+    pch_header *Header;
+} precompiled_header;
+
+#define CORSAC_PCH_H
+#endif
@@ -0,0 +1,2226 @@
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Felipe Carlin $
+   $Notice: Copyright  2022 Felipe Carlin $
+   ======================================================================== */
+
+
+#include "corsac_preprocessor.h"
+
+internal macro *
+FindMacro(macro_table *Macros, atom Name)
+{
+    macro *Result = 0;
+    if(Macros->Count)
+    {
+        Result = ((macro_slot *)FindAtomSlot(&Macros->Map, Name))->Macro;
+    }
+    
+    return Result;
+}
+
+internal bool32
+MacroBodiesMatch(macro *A, macro *B)
+{
+    bool32 Result = (((A->End - A->Start) == (B->End - B->Start)) &&
+                     (A->FunctionLike == B->FunctionLike) &&
+                     (A->Variadic == B->Variadic) &&
+                     (A->ParameterCount == B->ParameterCount));
+    
+    for(uint32 Index = 0;
+        Result && (Index < A->End - A->Start);
+        ++Index)
+    {
+        token_index TokenA = A->Start + Index;
+        token_index TokenB = B->Start + Index;
+        
+        uint32 Length = GetTokenLength(A->Tokens, TokenA);
+        Result = ((Length == GetTokenLength(B->Tokens, TokenB)) &&
+                  !StringCompare(GetTokenText(A->Tokens, TokenA), GetTokenText(B->Tokens, TokenB), Length));
+        
+        if(Result && A->FunctionLike)
+        {
+            Result = (A->ParameterRefs[Index] == B->ParameterRefs[Index]);
+        }
+    }
+    
+    return Result;
+}
+
+internal void
+DefineMacro(memory_arena *Arena, macro_table *Table, macro *SourceMacro)
+{
+    if(!Table->Map.Slots)
+    {
+        BeginAtomMap(Arena, &Table->Map, sizeof(macro_slot), MIN_MACRO_SLOT_COUNT);
+    }
+    
+    macro_slot *Slot = (macro_slot *)AddAtomSlot(Arena, &Table->Map, SourceMacro->Name);
+    if(Slot->Macro)
+    {
+        if(!MacroBodiesMatch(Slot->Macro, SourceMacro))
+        {
+            WarningInToken(SourceMacro->Tokens, SourceMacro->Identifier, "macro redefined");
+        }
+    }
+    else
+    {
+        Slot->Macro = PushStruct(Arena, macro);
+        ++Table->Count;
+    }
+    
+    MemCopy(Slot->Macro, SourceMacro, sizeof(macro));
+}
+
+internal void
+UndefineMacro(macro_table *Table, atom Name)
+{
+    if(Table->Count)
+    {
+        macro_slot *Slot = (macro_slot *)FindAtomSlot(&Table->Map, Name);
+        if(Slot->Macro)
+        {
+            Slot->Macro = 0;
+            --Table->Count;
+        }
+    }
+}
+
+internal void
+PushInput(preprocessor *Preprocessor, loaded_file *File)
+{
+    // NOTE(felipe): Inputs of finished includes are reused, with their
+    // token windows.
+    preprocessor_input *Input = Preprocessor->FirstFreeInput;
+    if(Input)
+    {
+        Preprocessor->FirstFreeInput = Input->Previous;
+        
+        token_buffer *Tokens = Input->Tokens;
+        Tokens->First = 0;
+        Tokens->Count = 0;
+        Tokens->LiteralCount = 0;
+    }
+    else
+    {
+        Input = PushStruct(Preprocessor->TokenArena, preprocessor_input);
+        Input->Tokens = NewTokenBuffer(Preprocessor->TokenArena, INPUT_WINDOW_SIZE, 0);
+    }
+    
+    Input->Lexer = BeginLexer(File);
+    Input->Lexer.StopAfterDirectives = true;
+    Input->Token = 0;
+    Input->Conditional = 0;
+    Input->GuardState = GuardState_Start;
+    Input->GuardName = 0;
+    Input->GuardConditional = 0;
+    
+    Input->Tokens->Fill = FillFromLexer;
+    Input->Tokens->FillContext = &Input->Lexer;
+    
+    Input->Previous = Preprocessor->Input;
+    Preprocessor->Input = Input;
+    ++Preprocessor->InputDepth;
+}
+
+internal void
+PopInput(preprocessor *Preprocessor)
+{
+    preprocessor_input *Input = Preprocessor->Input;
+    
+    Preprocessor->Input = Input->Previous;
+    --Preprocessor->InputDepth;
+    
+    Input->Previous = Preprocessor->FirstFreeInput;
+    Preprocessor->FirstFreeInput = Input;
+}
+
+internal header_info *
+GetHeaderInfo(preprocessor *Preprocessor, loaded_file *File)
+{
+    uint32 Index = (uint32)(File - GlobalFiles.Files);
+    if(Index >= Preprocessor->HeaderCapacity)
+    {
+        uint32 Capacity = Preprocessor->HeaderCapacity ? 2*Preprocessor->HeaderCapacity : 64;
+        while(Index >= Capacity)
+        {
+            Capacity *= 2;
+        }
+        
+        header_info *Headers = PushArray(Preprocessor->Arena, Capacity, header_info);
+        if(Preprocessor->HeaderCapacity)
+        {
+            MemCopy(Headers, Preprocessor->Headers, Preprocessor->HeaderCapacity*sizeof(header_info));
+        }
+        
+        Preprocessor->Headers = Headers;
+        Preprocessor->HeaderCapacity = Capacity;
+    }
+    
+    header_info *Result = Preprocessor->Headers + Index;
+    return Result;
+}
+
+internal void
+PushExpansion(preprocessor *Preprocessor, macro *Macro, token_buffer *Tokens, token_index Start, token_index End)
+{
+    macro_expansion *Expansion = Preprocessor->FirstFreeExpansion;
+    if(Expansion)
+    {
+        Preprocessor->FirstFreeExpansion = Expansion->Previous;
+    }
+    else
+    {
+        Expansion = PushStruct(Preprocessor->Arena, macro_expansion);
+    }
+    
+    Expansion->Macro = Macro;
+    Expansion->Tokens = Tokens;
+    Expansion->Token = Start;
+    Expansion->End = End;
+    
+    if(Macro)
+    {
+        Macro->Expanding = true;
+    }
+    
+    Expansion->Previous = Preprocessor->Expansion;
+    Preprocessor->Expansion = Expansion;
+}
+
+internal void
+PopExpansion(preprocessor *Preprocessor)
+{
+    macro_expansion *Expansion = Preprocessor->Expansion;
+    if(Expansion->Macro)
+    {
+        Expansion->Macro->Expanding = false;
+    }
+    
+    Preprocessor->Expansion = Expansion->Previous;
+    
+    Expansion->Previous = Preprocessor->FirstFreeExpansion;
+    Preprocessor->FirstFreeExpansion = Expansion;
+}
+
+inline token_index
+NextScratchToken(preprocessor *Preprocessor)
+{
+    token_buffer *Scratch = Preprocessor->ScratchTokens;
+    token_index Result = Scratch->First + Scratch->Count;
+    
+    return Result;
+}
+
+internal bool32
+PeekToken(preprocessor *Preprocessor, token_buffer **Tokens, token_index *Token)
+{
+    // NOTE(felipe): Finds the token that comes next, looking past finished
+    // expansions. There is none at the end of an argument being expanded or
+    // at the end of a file.
+    bool32 Result = false;
+    
+    macro_expansion *Expansion = Preprocessor->Expansion;
+    while(Expansion && (Expansion->Token == Expansion->End) && Expansion->Macro)
+    {
+        Expansion = Expansion->Previous;
+    }
+    
+    if(Expansion)
+    {
+        if(Expansion->Token != Expansion->End)
+        {
+            *Tokens = Expansion->Tokens;
+            *Token = Expansion->Token;
+            Result = true;
+        }
+    }
+    else
+    {
+        preprocessor_input *Current = Preprocessor->Input;
+        if(GetTokenType(Current->Tokens, Current->Token) != TokenType_EOF)
+        {
+            *Tokens = Current->Tokens;
+            *Token = Current->Token;
+            Result = true;
+        }
+    }
+    
+    return Result;
+}
+
+internal bool32
+ReadToken(preprocessor *Preprocessor, token_buffer **Tokens, token_index *Token)
+{
+    // NOTE(felipe): Consumes the token PeekToken finds, popping the finished
+    // expansions before it.
+    bool32 Result = PeekToken(Preprocessor, Tokens, Token);
+    if(Result)
+    {
+        while(Preprocessor->Expansion &&
+              (Preprocessor->Expansion->Token == Preprocessor->Expansion->End))
+        {
+            PopExpansion(Preprocessor);
+        }
+        
+        if(Preprocessor->Expansion)
+        {
+            ++Preprocessor->Expansion->Token;
+        }
+        else
+        {
+            ++Preprocessor->Input->Token;
+        }
+    }
+    
+    return Result;
+}
+
+internal void
+ResetScratch(preprocessor *Preprocessor)
+{
+    // NOTE(felipe): Only once nothing is being expanded.
+    token_buffer *Scratch = Preprocessor->ScratchTokens;
+    Scratch->Count = 0;
+    Scratch->LiteralCount = 0;
+    
+    for(argument_buffer *Buffer = Preprocessor->FirstArgumentBuffer;
+        Buffer;
+        Buffer = Buffer->Next)
+    {
+        Buffer->Tokens->Count = 0;
+        Buffer->Tokens->LiteralCount = 0;
+    }
+}
+
+internal char *
+ReserveScratchText(preprocessor *Preprocessor, uint32 Size)
+{
+    // NOTE(felipe): Room for Size bytes of text and a newline after them.
+    loaded_file *File = Preprocessor->ScratchFile;
+    if(!File || (Preprocessor->ScratchFileUsed + Size + 1 > File->Size))
+    {
+        loaded_file Scratch = {0};
+        Scratch.Filename = "<scratch space>";
+        Scratch.Size = SCRATCH_FILE_SIZE;
+        if(Size + 1 > Scratch.Size)
+        {
+            Scratch.Size = Size + 1;
+        }
+        Scratch.Memory = PushSize(Preprocessor->Arena, Scratch.Size + 1);
+        
+        File = Preprocessor->ScratchFile = AddFile(Scratch);
+        Preprocessor->ScratchFileUsed = 0;
+    }
+    
+    char *Result = (char *)File->Memory + Preprocessor->ScratchFileUsed;
+    return Result;
+}
+
+internal bool32
+LexScratchText(preprocessor *Preprocessor, uint32 Length)
+{
+    // NOTE(felipe): Lexes the text written after ReserveScratchText into the
+    // scratch tokens, it has to be exactly one token.
+    loaded_file *File = Preprocessor->ScratchFile;
+    char *Text = (char *)File->Memory + Preprocessor->ScratchFileUsed;
+    Text[Length] = '\n';
+    Preprocessor->ScratchFileUsed += Length + 1;
+    
+    token_buffer *Scratch = Preprocessor->ScratchTokens;
+    uint32 StartCount = Scratch->Count;
+    
+    lexer Lexer = BeginLexer(File);
+    Lexer.At = Text;
+    Lexer.End = Text + Length;
+    Lexer.AtBeginningOfLine = false;
+    Lexer.Speculative = true;
+    LexTokens(&Lexer, Scratch, 2);
+    
+    bool32 Result = (!Lexer.Failed && (Scratch->Count == StartCount + 1));
+    return Result;
+}
+
+internal void
+PasteTokens(preprocessor *Preprocessor, token_index Left, token_buffer *Tokens, token_index Right,
+            token_buffer *MacroTokens, token_index PasteToken)
+{
+    // NOTE(felipe): Left and everything after it in the scratch tokens is
+    // replaced by Left pasted to Right.
+    token_buffer *Scratch = Preprocessor->ScratchTokens;
+    
+    uint32 LeftLength = GetTokenLength(Scratch, Left);
+    uint32 RightLength = GetTokenLength(Tokens, Right);
+    
+    uint32 Flags = GetTokenFlags(Scratch, Left) & TokenFlag_SpaceBefore;
+    
+    char *Text = ReserveScratchText(Preprocessor, LeftLength + RightLength);
+    MemCopy(Text, GetTokenText(Scratch, Left), LeftLength);
+    MemCopy(Text + LeftLength, GetTokenText(Tokens, Right), RightLength);
+    
+    while(NextScratchToken(Preprocessor) > Left)
+    {
+        if(GetTokenType(Scratch, NextScratchToken(Preprocessor) - 1) == TokenType_Number)
+        {
+            --Scratch->LiteralCount;
+        }
+        --Scratch->Count;
+    }
+    
+    if(!LexScratchText(Preprocessor, LeftLength + RightLength))
+    {
+        ErrorInToken(MacroTokens, PasteToken, "pasting \"%.*s\" and \"%.*s\" does not give a valid preprocessing token",
+                     LeftLength, Text, RightLength, Text + LeftLength);
+    }
+    
+    SetTokenFlags(Scratch, Left, Flags);
+}
+
+internal void
+StringizeArgument(preprocessor *Preprocessor, macro_argument *Argument,
+                  token_buffer *MacroTokens, token_index HashToken)
+{
+    // NOTE(felipe): Tokens with blanks between them get one space, quotes and
+    // backslashes of string and character literals are escaped.
+    token_buffer *Scratch = Preprocessor->ScratchTokens;
+    
+    uint32 Size = 2;
+    for(token_index Token = Argument->Start;
+        Token < Argument->End;
+        ++Token)
+    {
+        Size += 2*GetTokenLength(Scratch, Token) + 1;
+    }
+    
+    char *Text = ReserveScratchText(Preprocessor, Size);
+    char *At = Text;
+    
+    *At++ = '"';
+    for(token_index Token = Argument->Start;
+        Token < Argument->End;
+        ++Token)
+    {
+        char *TokenText = GetTokenText(Scratch, Token);
+        uint32 Length = GetTokenLength(Scratch, Token);
+        
+        if((Token != Argument->Start) && (GetTokenFlags(Scratch, Token) & TokenFlag_SpaceBefore))
+        {
+            *At++ = ' ';
+        }
+        
+        bool32 Quoted = ((GetTokenType(Scratch, Token) == TokenType_String) || (TokenText[0] == '\''));
+        if(GetTokenFlags(Scratch, Token) & TokenFlag_Spliced)
+        {
+            At += RemoveLineContinuations(TokenText, Length, At, Length);
+        }
+        else
+        {
+            for(uint32 Index = 0;
+                Index < Length;
+                ++Index)
+            {
+                char Character = TokenText[Index];
+                if(Quoted && ((Character == '"') || (Character == '\\')))
+                {
+                    *At++ = '\\';
+                }
+                *At++ = Character;
+            }
+        }
+    }
+    *At++ = '"';
+    
+    if(!LexScratchText(Preprocessor, (uint32)(At - Text)))
+    {
+        ErrorInToken(MacroTokens, HashToken, "'#' does not give a valid string literal");
+    }
+    
+    SetTokenFlags(Scratch, NextScratchToken(Preprocessor) - 1,
+                  GetTokenFlags(MacroTokens, HashToken) & TokenFlag_SpaceBefore);
+}
+
+internal void ExpandArgument(preprocessor *Preprocessor, macro_argument *Argument);
+
+internal void
+SubstituteMacro(preprocessor *Preprocessor, macro *Macro, macro_argument *Arguments)
+{
+    // NOTE(felipe): Writes the replacement of an invocation to the scratch
+    // tokens and pushes it to be scanned again. Parameters next to # or ##
+    // take their argument as written, the others take it expanded. Arguments
+    // are expanded at most once per invocation, all of them before the
+    // replacement is written since invocations inside them write scratch
+    // tokens too.
+    token_buffer *Scratch = Preprocessor->ScratchTokens;
+    token_buffer *Body = Macro->Tokens;
+    
+    if(Macro->FunctionLike)
+    {
+        for(uint32 Index = 0;
+            Index < Macro->End - Macro->Start;
+            ++Index)
+        {
+            uint32 Parameter = Macro->ParameterRefs[Index];
+            if(Parameter && !(Parameter & MACRO_PARAMETER_AS_WRITTEN))
+            {
+                macro_argument *Argument = Arguments + Parameter - 1;
+                if(!Argument->Expanded)
+                {
+                    ExpandArgument(Preprocessor, Argument);
+                }
+            }
+        }
+    }
+    
+    token_index Start = NextScratchToken(Preprocessor);
+    
+    // NOTE(felipe): OperandStart is where the output of the last operand
+    // starts, ## has nothing to paste to if it wrote nothing.
+    bool32 Paste = false;
+    token_index PasteToken = 0;
+    token_index OperandStart = Start;
+    for(token_index Token = Macro->Start;
+        Token < Macro->End;
+        ++Token)
+    {
+        uint32 Kind = GetTokenKind(Body, Token);
+        if(Kind == Punctuator_HashHash)
+        {
+            Paste = (NextScratchToken(Preprocessor) > OperandStart);
+            PasteToken = Token;
+            continue;
+        }
+        
+        token_index Next = NextScratchToken(Preprocessor);
+        uint32 Parameter = Macro->FunctionLike ? Macro->ParameterRefs[Token - Macro->Start] : 0;
+        
+        if(Macro->FunctionLike && (Kind == Punctuator_Hash))
+        {
+            ++Token;
+            
+            uint32 Parameter = Macro->ParameterRefs[Token - Macro->Start] & MACRO_PARAMETER_INDEX_MASK;
+            macro_argument *Argument = Arguments + Parameter - 1;
+            StringizeArgument(Preprocessor, Argument, Body, Token - 1);
+            
+            if(Paste)
+            {
+                PasteTokens(Preprocessor, Next - 1, Scratch, Next, Body, PasteToken);
+            }
+        }
+        else
+        {
+            token_buffer *Tokens = Body;
+            token_index First = Token;
+            token_index End = Token + 1;
+            
+            if(Parameter)
+            {
+                uint32 Index = Parameter & MACRO_PARAMETER_INDEX_MASK;
+                macro_argument *Argument = Arguments + Index - 1;
+                
+                Tokens = Scratch;
+                if(Parameter & MACRO_PARAMETER_AS_WRITTEN)
+                {
+                    First = Argument->Start;
+                    End = Argument->End;
+                }
+                else
+                {
+                    Tokens = Argument->ExpandedTokens;
+                    First = Argument->ExpandedStart;
+                    End = Argument->ExpandedEnd;
+                }
+                
+                // NOTE(felipe): GNU extension, in ", ## __VA_ARGS__" the
+                // comma goes away when the variable arguments were left out
+                // and nothing is pasted otherwise.
+                if(Paste && Macro->Variadic && (Index == Macro->ParameterCount) &&
+                   (GetTokenKind(Scratch, Next - 1) == Punctuator_Comma))
+                {
+                    if(Argument->Omitted)
+                    {
+                        --Scratch->Count;
+                        --Next;
+                    }
+                    Paste = false;
+                }
+            }
+            
+            for(token_index Operand = First;
+                Operand < End;
+                ++Operand)
+            {
+                if(Paste && (Operand == First))
+                {
+                    PasteTokens(Preprocessor, Next - 1, Tokens, Operand, Body, PasteToken);
+                }
+                else if(Parameter && (Operand == First))
+                {
+                    // NOTE(felipe): The space before the parameter is the
+                    // one before its argument, not whatever came before the
+                    // argument in the invocation.
+                    uint32 Flags = ((GetTokenFlags(Tokens, Operand) & ~(TokenFlag_AtBeginningOfLine|TokenFlag_SpaceBefore)) |
+                                    (GetTokenFlags(Body, Token) & TokenFlag_SpaceBefore));
+                    CopyTokenWithFlags(Scratch, Tokens, Operand, Flags);
+                }
+                else
+                {
+                    CopyToken(Scratch, Tokens, Operand);
+                }
+            }
+        }
+        
+        // NOTE(felipe): The result of a paste is the left operand of the
+        // next ##, even when the right operand was empty.
+        OperandStart = Paste ? (Next - 1) : Next;
+        Paste = false;
+    }
+    
+    PushExpansion(Preprocessor, Macro, Scratch, Start, NextScratchToken(Preprocessor));
+}
+
+internal void
+InvokeMacro(preprocessor *Preprocessor, macro *Macro, token_buffer *NameTokens, token_index Name)
+{
+    // NOTE(felipe): The arguments of a function-like macro are copied to the
+    // scratch tokens as they are read, wherever they come from.
+    token_buffer *Scratch = Preprocessor->ScratchTokens;
+    macro_argument Arguments[MAX_MACRO_PARAMETER_COUNT];
+    
+    if(Macro->FunctionLike)
+    {
+        token_buffer *Tokens = 0;
+        token_index Token = 0;
+        
+        // NOTE(felipe): The '(' that ExpandToken found.
+        ReadToken(Preprocessor, &Tokens, &Token);
+        
+        uint32 ArgumentCount = 0;
+        macro_argument *Argument = Arguments;
+        Argument->Start = NextScratchToken(Preprocessor);
+        Argument->Omitted = false;
+        Argument->Expanded = false;
+        
+        uint32 Depth = 0;
+        for(;;)
+        {
+            if(!ReadToken(Preprocessor, &Tokens, &Token))
+            {
+                ErrorInToken(NameTokens, Name, "unterminated argument list invoking macro \"%s\"",
+                             GetAtomString(Macro->Name));
+            }
+            
+            // NOTE(felipe): The variable arguments take the commas between
+            // them.
+            uint32 Kind = GetTokenKind(Tokens, Token);
+            if(!Depth &&
+               ((Kind == Punctuator_CloseParen) ||
+                ((Kind == Punctuator_Comma) && !(Macro->Variadic && (ArgumentCount + 1 == Macro->ParameterCount)))))
+            {
+                Argument->End = NextScratchToken(Preprocessor);
+                ++ArgumentCount;
+                
+                if(Kind == Punctuator_CloseParen)
+                {
+                    break;
+                }
+                
+                if(ArgumentCount == MAX_MACRO_PARAMETER_COUNT)
+                {
+                    ErrorInToken(Tokens, Token, "too many arguments invoking macro \"%s\"",
+                                 GetAtomString(Macro->Name));
+                }
+                
+                Argument = Arguments + ArgumentCount;
+                Argument->Start = NextScratchToken(Preprocessor);
+                Argument->Omitted = false;
+                Argument->Expanded = false;
+            }
+            else
+            {
+                if(Kind == Punctuator_OpenParen)
+                {
+                    ++Depth;
+                }
+                else if(Kind == Punctuator_CloseParen)
+                {
+                    --Depth;
+                }
+                
+                // NOTE(felipe): A name that comes from the replacement of a
+                // macro still being expanded is marked now, that expansion
+                // may be over by the time the argument is expanded.
+                uint32 Flags = GetTokenFlags(Tokens, Token);
+                atom TokenName = GetTokenAtom(Tokens, Token);
+                if(Preprocessor->Expansion && TokenName && !(Flags & TokenFlag_NoExpand))
+                {
+                    macro *Found = FindMacro(&Preprocessor->Macros, TokenName);
+                    if(Found && Found->Expanding)
+                    {
+                        Flags |= TokenFlag_NoExpand;
+                    }
+                }
+                
+                CopyTokenWithFlags(Scratch, Tokens, Token, Flags);
+            }
+        }
+        
+        // NOTE(felipe): "F()" passes no arguments to a macro without
+        // parameters, and the variable arguments can be left out.
+        if(!Macro->ParameterCount && (ArgumentCount == 1) && (Arguments[0].Start == Arguments[0].End))
+        {
+            ArgumentCount = 0;
+        }
+        else if(Macro->Variadic && (ArgumentCount + 1 == Macro->ParameterCount))
+        {
+            Argument = Arguments + ArgumentCount++;
+            Argument->Start = Argument->End = NextScratchToken(Preprocessor);
+            Argument->Omitted = true;
+            Argument->Expanded = false;
+        }
+        
+        if(ArgumentCount != Macro->ParameterCount)
+        {
+            ErrorInToken(NameTokens, Name, "macro \"%s\" takes %u arguments, %u given",
+                         GetAtomString(Macro->Name), Macro->ParameterCount, ArgumentCount);
+        }
+    }
+    
+    SubstituteMacro(Preprocessor, Macro, Arguments);
+}
+
+internal void
+ExpandToken(preprocessor *Preprocessor, token_buffer *Output, token_buffer *Source, token_index Token)
+{
+    // NOTE(felipe): Starts expanding Token if it names a macro, otherwise
+    // it is output as is. Names of macros that are being expanded and names
+    // of no macro are marked so that they are not looked up again when the
+    // output is scanned again.
+    macro *Macro = 0;
+    
+    uint32 Flags = GetTokenFlags(Source, Token);
+    atom Name = GetTokenAtom(Source, Token);
+    if(Name && !(Flags & TokenFlag_NoExpand))
+    {
+        Macro = FindMacro(&Preprocessor->Macros, Name);
+        
+        token_buffer *NextTokens = 0;
+        token_index Next = 0;
+        if(!Macro || Macro->Expanding)
+        {
+            Flags |= TokenFlag_NoExpand;
+            Macro = 0;
+        }
+        else if(Macro->FunctionLike &&
+                !(PeekToken(Preprocessor, &NextTokens, &Next) &&
+                  (GetTokenKind(NextTokens, Next) == Punctuator_OpenParen)))
+        {
+            // NOTE(felipe): Without arguments the name stays, a later scan
+            // may still find them.
+            Macro = 0;
+        }
+    }
+    
+    if(!Macro)
+    {
+        CopyTokenWithFlags(Output, Source, Token, Flags | Preprocessor->PendingFlags);
+        Preprocessor->PendingFlags = 0;
+    }
+    else
+    {
+        if(Macro->FunctionLike || Macro->HasPaste)
+        {
+            InvokeMacro(Preprocessor, Macro, Source, Token);
+        }
+        else
+        {
+            PushExpansion(Preprocessor, Macro, Macro->Tokens, Macro->Start, Macro->End);
+        }
+        
+        Preprocessor->PendingFlags |= Flags & (TokenFlag_AtBeginningOfLine|TokenFlag_SpaceBefore);
+    }
+}
+
+internal void
+ExpandArgument(preprocessor *Preprocessor, macro_argument *Argument)
+{
+    // NOTE(felipe): The argument is expanded on its own, on top of the
+    // expansions of the invocation it belongs to.
+    argument_buffer *Buffer = Preprocessor->ArgumentBuffer;
+    Buffer = Buffer ? Buffer->Next : Preprocessor->FirstArgumentBuffer;
+    if(!Buffer)
+    {
+        Buffer = PushStruct(Preprocessor->Arena, argument_buffer);
+        Buffer->Tokens = NewTokenBuffer(Preprocessor->Arena, 0, 0);
+        Buffer->Previous = Preprocessor->ArgumentBuffer;
+        
+        if(Buffer->Previous)
+        {
+            Buffer->Previous->Next = Buffer;
+        }
+        else
+        {
+            Preprocessor->FirstArgumentBuffer = Buffer;
+        }
+    }
+    Preprocessor->ArgumentBuffer = Buffer;
+    
+    token_buffer *Output = Buffer->Tokens;
+    token_index Start = Output->First + Output->Count;
+    
+    uint32 PendingFlags = Preprocessor->PendingFlags;
+    Preprocessor->PendingFlags = 0;
+    
+    PushExpansion(Preprocessor, 0, Preprocessor->ScratchTokens, Argument->Start, Argument->End);
+    macro_expansion *Base = Preprocessor->Expansion;
+    for(;;)
+    {
+        macro_expansion *Expansion = Preprocessor->Expansion;
+        if(Expansion->Token != Expansion->End)
+        {
+            ExpandToken(Preprocessor, Output, Expansion->Tokens, Expansion->Token++);
+        }
+        else if(Expansion == Base)
+        {
+            break;
+        }
+        else
+        {
+            PopExpansion(Preprocessor);
+        }
+    }
+    PopExpansion(Preprocessor);
+    
+    Preprocessor->ArgumentBuffer = Buffer->Previous;
+    Preprocessor->PendingFlags = PendingFlags;
+    
+    Argument->Expanded = true;
+    Argument->ExpandedTokens = Output;
+    Argument->ExpandedStart = Start;
+    Argument->ExpandedEnd = Output->First + Output->Count;
+}
+
+internal token_index
+DefineMacroDirective(preprocessor *Preprocessor, token_buffer *Input, token_index Token)
+{
+    // NOTE(felipe): Token is the name of the macro, returns the first token
+    // of the next line.
+    if(!GetTokenAtom(Input, Token))
+    {
+        ErrorInToken(Input, Token, "macro names must be identifiers");
+    }
+    else if(GetTokenAtom(Input, Token) == Preprocessor->DefinedName)
+    {
+        ErrorInToken(Input, Token, "\"defined\" cannot be used as a macro name");
+    }
+    
+    token_buffer *MacroTokens = Preprocessor->MacroTokens;
+    
+    macro Macro = {0};
+    Macro.Tokens = MacroTokens;
+    Macro.Identifier = CopyToken(MacroTokens, Input, Token);
+    Macro.Name = GetTokenAtom(Input, Token);
+    
+    ++Token;
+    
+    // NOTE(felipe): Only a '(' right after the name makes the macro
+    // function-like.
+    atom Parameters[MAX_MACRO_PARAMETER_COUNT];
+    if(!(GetTokenFlags(Input, Token) & TokenFlag_SpaceBefore) &&
+       (GetTokenKind(Input, Token) == Punctuator_OpenParen))
+    {
+        Macro.FunctionLike = true;
+        ++Token;
+        
+        if(!TokenAtBeginningOfLine(Input, Token) && (GetTokenKind(Input, Token) == Punctuator_CloseParen))
+        {
+            ++Token;
+        }
+        else
+        {
+            for(;;)
+            {
+                atom Parameter = 0;
+                if(!TokenAtBeginningOfLine(Input, Token))
+                {
+                    if(GetTokenKind(Input, Token) == Punctuator_Ellipsis)
+                    {
+                        Macro.Variadic = true;
+                        Parameter = Preprocessor->VariadicName;
+                    }
+                    else
+                    {
+                        Parameter = GetTokenAtom(Input, Token);
+                    }
+                }
+                
+                if(!Parameter)
+                {
+                    ErrorInToken(Input, Token, "expected a parameter name");
+                }
+                
+                for(uint32 Index = 0;
+                    Index < Macro.ParameterCount;
+                    ++Index)
+                {
+                    if(Parameters[Index] == Parameter)
+                    {
+                        ErrorInToken(Input, Token, "duplicate macro parameter");
+                    }
+                }
+                
+                if(Macro.ParameterCount == MAX_MACRO_PARAMETER_COUNT)
+                {
+                    ErrorInToken(Input, Token, "too many macro parameters");
+                }
+                Parameters[Macro.ParameterCount++] = Parameter;
+                
+                ++Token;
+                
+                uint32 Kind = TokenAtBeginningOfLine(Input, Token) ? 0 : GetTokenKind(Input, Token);
+                if(Kind == Punctuator_CloseParen)
+                {
+                    ++Token;
+                    break;
+                }
+                else if((Kind == Punctuator_Comma) && !Macro.Variadic)
+                {
+                    ++Token;
+                }
+                else
+                {
+                    ErrorInToken(Input, Token - 1, "expected ',' or ')' after a macro parameter");
+                }
+            }
+        }
+    }
+    
+    // NOTE(felipe): The replacement runs to the end of the line, EOF always
+    // starts a line.
+    Macro.Start = MacroTokens->First + MacroTokens->Count;
+    while(!TokenAtBeginningOfLine(Input, Token))
+    {
+        CopyToken(MacroTokens, Input, Token);
+        ++Token;
+    }
+    Macro.End = MacroTokens->First + MacroTokens->Count;
+    
+    uint32 Count = Macro.End - Macro.Start;
+    if(Macro.FunctionLike)
+    {
+        Macro.ParameterRefs = PushArray(Preprocessor->Arena, Count, uint8);
+    }
+    
+    for(uint32 Index = 0;
+        Index < Count;
+        ++Index)
+    {
+        token_index BodyToken = Macro.Start + Index;
+        
+        if(GetTokenKind(MacroTokens, BodyToken) == Punctuator_HashHash)
+        {
+            if(!Index || (Index + 1 == Count))
+            {
+                ErrorInToken(MacroTokens, BodyToken, "'##' cannot appear at either end of a macro expansion");
+            }
+            Macro.HasPaste = true;
+        }
+        
+        atom Name = GetTokenAtom(MacroTokens, BodyToken);
+        if(Macro.FunctionLike && Name)
+        {
+            for(uint32 Parameter = 0;
+                Parameter < Macro.ParameterCount;
+                ++Parameter)
+            {
+                if(Parameters[Parameter] == Name)
+                {
+                    Macro.ParameterRefs[Index] = (uint8)(Parameter + 1);
+                    break;
+                }
+            }
+        }
+    }
+    
+    if(Macro.FunctionLike)
+    {
+        for(uint32 Index = 0;
+            Index < Count;
+            ++Index)
+        {
+            uint32 Kind = GetTokenKind(MacroTokens, Macro.Start + Index);
+            if(Kind == Punctuator_Hash)
+            {
+                if(!((Index + 1 < Count) && Macro.ParameterRefs[Index + 1]))
+                {
+                    ErrorInToken(MacroTokens, Macro.Start + Index, "'#' is not followed by a macro parameter");
+                }
+                Macro.ParameterRefs[Index + 1] |= MACRO_PARAMETER_AS_WRITTEN;
+            }
+            else if(Kind == Punctuator_HashHash)
+            {
+                if(Macro.ParameterRefs[Index - 1])
+                {
+                    Macro.ParameterRefs[Index - 1] |= MACRO_PARAMETER_AS_WRITTEN;
+                }
+                if(Macro.ParameterRefs[Index + 1])
+                {
+                    Macro.ParameterRefs[Index + 1] |= MACRO_PARAMETER_AS_WRITTEN;
+                }
+            }
+        }
+    }
+    
+    DefineMacro(Preprocessor->Arena, &Preprocessor->Macros, &Macro);
+    
+    return Token;
+}
+
+internal void
+IncludeFile(preprocessor *Preprocessor, char *Path, bool32 Angled, token_buffer *Tokens, token_index IncludeToken)
+{
+    loaded_file *File = FindIncludeFile(Path, Preprocessor->Input->Lexer.File, Angled);
+    if(File)
+    {
+        // NOTE(felipe): A header that cannot give anything the second time
+        // around is not even lexed again.
+        header_info *Header = GetHeaderInfo(Preprocessor, File);
+        ++Header->IncludeCount;
+        
+        if(Header->PragmaOnce ||
+           (Header->GuardName && FindMacro(&Preprocessor->Macros, Header->GuardName)))
+        {
+            ++Header->SkipCount;
+        }
+        else if(Preprocessor->InputDepth >= MAX_INCLUDE_DEPTH)
+        {
+            ErrorInToken(Tokens, IncludeToken, "#include nested too deeply");
+        }
+        else
+        {
+            PushInput(Preprocessor, File);
+        }
+    }
+    else
+    {
+        ErrorInToken(Tokens, IncludeToken, "could not open include file: %s", Path);
+    }
+}
+
+internal token_index
+SkipExtraTokens(token_buffer *Input, token_index Token, char *Directive)
+{
+    // NOTE(felipe): Token is past everything the directive takes, returns
+    // the first token of the next line.
+    if(!TokenAtBeginningOfLine(Input, Token))
+    {
+        WarningInToken(Input, Token, "extra tokens at end of #%s directive", Directive);
+        do
+        {
+            ++Token;
+        } while(!TokenAtBeginningOfLine(Input, Token));
+    }
+    
+    return Token;
+}
+
+inline uint32
+GetBinaryPrecedence(uint32 Kind)
+{
+    // NOTE(felipe): Zero for tokens that are not binary operators.
+    uint32 Result = 0;
+    switch(Kind)
+    {
+        case Punctuator_OrOr: Result = 1; break;
+        case Punctuator_AndAnd: Result = 2; break;
+        case Punctuator_Pipe: Result = 3; break;
+        case Punctuator_Caret: Result = 4; break;
+        case Punctuator_Ampersand: Result = 5; break;
+        
+        case Punctuator_EqualEqual:
+        case Punctuator_NotEqual: Result = 6; break;
+        
+        case Punctuator_Less:
+        case Punctuator_Greater:
+        case Punctuator_LessEqual:
+        case Punctuator_GreaterEqual: Result = 7; break;
+        
+        case Punctuator_ShiftLeft:
+        case Punctuator_ShiftRight: Result = 8; break;
+        
+        case Punctuator_Plus:
+        case Punctuator_Minus: Result = 9; break;
+        
+        case Punctuator_Star:
+        case Punctuator_Slash:
+        case Punctuator_Percent: Result = 10; break;
+    }
+    
+    return Result;
+}
+
+internal condition_value ConditionExpression(condition_parser *Parser, uint32 MinPrecedence, bool32 Evaluate);
+
+inline condition_value
+ConditionSigned(bool32 Truth)
+{
+    condition_value Result = {Truth ? 1 : 0, false};
+    return Result;
+}
+
+internal condition_value
+ConditionOperand(condition_parser *Parser, bool32 Evaluate)
+{
+    token_buffer *Tokens = Parser->Tokens;
+    if(Parser->Token == Parser->End)
+    {
+        ErrorInToken(Tokens, Parser->Token - 1, "expected value in expression");
+    }
+    
+    condition_value Result = {0};
+    
+    token_index Token = Parser->Token++;
+    token_type Type = GetTokenType(Tokens, Token);
+    uint32 Kind = GetTokenKind(Tokens, Token);
+    if(Type == TokenType_Number)
+    {
+        // NOTE(felipe): A constant is unsigned with a u in its suffix, or
+        // when it does not fit in int64.
+        Result.Value = GetTokenNumber(Tokens, Token);
+        Result.Unsigned = (Result.Value >> 63);
+        
+        char *Text = GetTokenText(Tokens, Token);
+        uint32 Length = GetTokenLength(Tokens, Token);
+        if((Text[0] >= '0') && (Text[0] <= '9'))
+        {
+            for(uint32 Index = Length - GetIntegerSuffixLength(Text, Length);
+                Index < Length;
+                ++Index)
+            {
+                if((Text[Index] == 'u') || (Text[Index] == 'U'))
+                {
+                    Result.Unsigned = true;
+                }
+            }
+        }
+    }
+    else if(Type == TokenType_Identifier || Type == TokenType_Keyword)
+    {
+        // NOTE(felipe): Names that are still there after expansion are zero.
+        Result.Value = 0;
+    }
+    else if(Kind == Punctuator_OpenParen)
+    {
+        Result = ConditionExpression(Parser, 0, Evaluate);
+        
+        if((Parser->Token == Parser->End) || (GetTokenKind(Tokens, Parser->Token) != Punctuator_CloseParen))
+        {
+            ErrorInToken(Tokens, Token, "missing ')' in expression");
+        }
+        ++Parser->Token;
+    }
+    else if(Kind == Punctuator_Plus)
+    {
+        Result = ConditionOperand(Parser, Evaluate);
+    }
+    else if(Kind == Punctuator_Minus)
+    {
+        Result = ConditionOperand(Parser, Evaluate);
+        Result.Value = 0 - Result.Value;
+    }
+    else if(Kind == Punctuator_Tilde)
+    {
+        Result = ConditionOperand(Parser, Evaluate);
+        Result.Value = ~Result.Value;
+    }
+    else if(Kind == Punctuator_Bang)
+    {
+        Result = ConditionSigned(!ConditionOperand(Parser, Evaluate).Value);
+    }
+    else
+    {
+        ErrorInToken(Tokens, Token, "token \"%.*s\" is not valid in preprocessor expressions",
+                     GetTokenLength(Tokens, Token), GetTokenText(Tokens, Token));
+    }
+    
+    return Result;
+}
+
+internal condition_value
+ConditionExpression(condition_parser *Parser, uint32 MinPrecedence, bool32 Evaluate)
+{
+    // NOTE(felipe): Precedence climbing. Values wrap around instead of
+    // overflowing. As in C, an operation with an unsigned operand is done
+    // unsigned, except for shifts, which take the type of their left
+    // operand.
+    token_buffer *Tokens = Parser->Tokens;
+    
+    condition_value Result = ConditionOperand(Parser, Evaluate);
+    while(Parser->Token != Parser->End)
+    {
+        token_index Operator = Parser->Token;
+        uint32 Kind = GetTokenKind(Tokens, Operator);
+        
+        if(Kind == Punctuator_Question)
+        {
+            // NOTE(felipe): The conditional operator binds loosest and to
+            // the right.
+            if(MinPrecedence)
+            {
+                break;
+            }
+            ++Parser->Token;
+            
+            condition_value Then = ConditionExpression(Parser, 0, Evaluate && Result.Value);
+            if((Parser->Token == Parser->End) || (GetTokenKind(Tokens, Parser->Token) != Punctuator_Colon))
+            {
+                ErrorInToken(Tokens, Operator, "'?' without following ':'");
+            }
+            ++Parser->Token;
+            
+            condition_value Else = ConditionExpression(Parser, 0, Evaluate && !Result.Value);
+            bool32 Unsigned = (Then.Unsigned || Else.Unsigned);
+            Result = Result.Value ? Then : Else;
+            Result.Unsigned = Unsigned;
+            continue;
+        }
+        
+        uint32 Precedence = GetBinaryPrecedence(Kind);
+        if(!Precedence || (Precedence < MinPrecedence))
+        {
+            break;
+        }
+        ++Parser->Token;
+        
+        bool32 EvaluateRight = Evaluate;
+        if(Kind == Punctuator_AndAnd)
+        {
+            EvaluateRight = Evaluate && Result.Value;
+        }
+        else if(Kind == Punctuator_OrOr)
+        {
+            EvaluateRight = Evaluate && !Result.Value;
+        }
+        
+        condition_value Right = ConditionExpression(Parser, Precedence + 1, EvaluateRight);
+        
+        uint64 A = Result.Value;
+        uint64 B = Right.Value;
+        int64 SignedA = (int64)A;
+        int64 SignedB = (int64)B;
+        bool32 Unsigned = (Result.Unsigned || Right.Unsigned);
+        switch(Kind)
+        {
+            case Punctuator_OrOr: Result = ConditionSigned(A || B); break;
+            case Punctuator_AndAnd: Result = ConditionSigned(A && B); break;
+            case Punctuator_EqualEqual: Result = ConditionSigned(A == B); break;
+            case Punctuator_NotEqual: Result = ConditionSigned(A != B); break;
+            case Punctuator_Less: Result = ConditionSigned(Unsigned ? (A < B) : (SignedA < SignedB)); break;
+            case Punctuator_Greater: Result = ConditionSigned(Unsigned ? (A > B) : (SignedA > SignedB)); break;
+            case Punctuator_LessEqual: Result = ConditionSigned(Unsigned ? (A <= B) : (SignedA <= SignedB)); break;
+            case Punctuator_GreaterEqual: Result = ConditionSigned(Unsigned ? (A >= B) : (SignedA >= SignedB)); break;
+            
+            case Punctuator_ShiftLeft: Result.Value = A << (B & 63); break;
+            case Punctuator_ShiftRight:
+            {
+                Result.Value = Result.Unsigned ? (A >> (B & 63)) : (uint64)(SignedA >> (B & 63));
+            } break;
+            
+            case Punctuator_Pipe: Result.Value = A | B; Result.Unsigned = Unsigned; break;
+            case Punctuator_Caret: Result.Value = A ^ B; Result.Unsigned = Unsigned; break;
+            case Punctuator_Ampersand: Result.Value = A & B; Result.Unsigned = Unsigned; break;
+            case Punctuator_Plus: Result.Value = A + B; Result.Unsigned = Unsigned; break;
+            case Punctuator_Minus: Result.Value = A - B; Result.Unsigned = Unsigned; break;
+            case Punctuator_Star: Result.Value = A * B; Result.Unsigned = Unsigned; break;
+            
+            case Punctuator_Slash:
+            case Punctuator_Percent:
+            {
+                Result.Unsigned = Unsigned;
+                if(!B)
+                {
+                    if(Evaluate)
+                    {
+                        ErrorInToken(Tokens, Operator, "division by zero in #if");
+                    }
+                    Result.Value = 0;
+                }
+                else if(Unsigned)
+                {
+                    Result.Value = (Kind == Punctuator_Slash) ? (A / B) : (A % B);
+                }
+                else if(SignedB == -1)
+                {
+                    // NOTE(felipe): Dividing the smallest int64 by -1 traps.
+                    Result.Value = (Kind == Punctuator_Slash) ? (0 - A) : 0;
+                }
+                else
+                {
+                    Result.Value = (uint64)((Kind == Punctuator_Slash) ? (SignedA / SignedB) : (SignedA % SignedB));
+                }
+            } break;
+        }
+    }
+    
+    return Result;
+}
+
+internal bool32
+EvaluateCondition(preprocessor *Preprocessor, token_buffer *Input, token_index Directive, token_index *Rest)
+{
+    // NOTE(felipe): Directive is the name of an #if or #elif. The rest of
+    // its line is copied to the scratch tokens with every "defined" operator
+    // replaced by its value, then expanded like a macro argument would be.
+    token_buffer *Scratch = Preprocessor->ScratchTokens;
+    
+    macro_argument Line = {0};
+    Line.Start = NextScratchToken(Preprocessor);
+    
+    token_index Token = Directive + 1;
+    while(!TokenAtBeginningOfLine(Input, Token))
+    {
+        if(GetTokenAtom(Input, Token) == Preprocessor->DefinedName)
+        {
+            token_index Defined = Token++;
+            
+            bool32 Parenthesized = (!TokenAtBeginningOfLine(Input, Token) &&
+                                    (GetTokenKind(Input, Token) == Punctuator_OpenParen));
+            if(Parenthesized)
+            {
+                ++Token;
+            }
+            
+            atom Name = TokenAtBeginningOfLine(Input, Token) ? 0 : GetTokenAtom(Input, Token);
+            if(!Name)
+            {
+                ErrorInToken(Input, Defined, "operator \"defined\" requires an identifier");
+            }
+            ++Token;
+            
+            if(Parenthesized)
+            {
+                if(TokenAtBeginningOfLine(Input, Token) || (GetTokenKind(Input, Token) != Punctuator_CloseParen))
+                {
+                    ErrorInToken(Input, Defined, "missing ')' after \"defined\"");
+                }
+                ++Token;
+            }
+            
+            token_index Value = PushToken(Scratch, TokenType_Number, GetTokenLocation(Input, Defined),
+                                          GetTokenLength(Input, Defined), GetTokenFlags(Input, Defined));
+            SetTokenValue(Scratch, Value, PushLiteral(Scratch, FindMacro(&Preprocessor->Macros, Name) != 0));
+        }
+        else
+        {
+            CopyToken(Scratch, Input, Token++);
+        }
+    }
+    Line.End = NextScratchToken(Preprocessor);
+    
+    ExpandArgument(Preprocessor, &Line);
+    
+    condition_parser Parser = {0};
+    Parser.Tokens = Line.ExpandedTokens;
+    Parser.Token = Line.ExpandedStart;
+    Parser.End = Line.ExpandedEnd;
+    
+    if(Parser.Token == Parser.End)
+    {
+        ErrorInToken(Input, Directive, "#%.*s with no expression",
+                     GetTokenLength(Input, Directive), GetTokenText(Input, Directive));
+    }
+    
+    condition_value Value = ConditionExpression(&Parser, 0, true);
+    if(Parser.Token != Parser.End)
+    {
+        ErrorInToken(Parser.Tokens, Parser.Token, "missing binary operator before token \"%.*s\"",
+                     GetTokenLength(Parser.Tokens, Parser.Token), GetTokenText(Parser.Tokens, Parser.Token));
+    }
+    
+    ResetScratch(Preprocessor);
+    
+    *Rest = Token;
+    
+    bool32 Result = (Value.Value != 0);
+    return Result;
+}
+
+internal token_index
+SkipConditional(preprocessor_input *Current, token_index Token)
+{
+    // NOTE(felipe): Token starts the line after a directive that leaves its
+    // group out. Returns the '#' of the directive that ends the group, or
+    // the EOF.
+    token_buffer *Input = Current->Tokens;
+    if(Input->Fill)
+    {
+        // NOTE(felipe): The lexer stopped at Token, so it is the only token
+        // of the group lexed so far.
+        RewindLexer(&Current->Lexer, Input, Token);
+        SkipConditionalGroup(&Current->Lexer);
+    }
+    else
+    {
+        // NOTE(felipe): The file was lexed beforehand, its tokens are walked
+        // instead.
+        uint32 Depth = 0;
+        for(;;)
+        {
+            if(GetTokenType(Input, Token) == TokenType_EOF)
+            {
+                break;
+            }
+            
+            token_index Name = Token + 1;
+            if(TokenAtBeginningOfLine(Input, Token) && (GetTokenKind(Input, Token) == Punctuator_Hash) &&
+               !TokenAtBeginningOfLine(Input, Name))
+            {
+                if(TokenIs(Input, Name, "if") || TokenIs(Input, Name, "ifdef") || TokenIs(Input, Name, "ifndef"))
+                {
+                    ++Depth;
+                }
+                else if(TokenIs(Input, Name, "endif"))
+                {
+                    if(!Depth)
+                    {
+                        break;
+                    }
+                    --Depth;
+                }
+                else if(!Depth && (TokenIs(Input, Name, "else") || TokenIs(Input, Name, "elif")))
+                {
+                    break;
+                }
+            }
+            
+            ++Token;
+        }
+    }
+    
+    return Token;
+}
+
+internal token_index
+BeginConditional(preprocessor *Preprocessor, preprocessor_input *Current, token_index Directive,
+                 token_index Token, bool32 Taken)
+{
+    // NOTE(felipe): Token starts the line after the directive, returns where
+    // to go on from.
+    conditional *Conditional = Preprocessor->FirstFreeConditional;
+    if(Conditional)
+    {
+        Preprocessor->FirstFreeConditional = Conditional->Previous;
+    }
+    else
+    {
+        Conditional = PushStruct(Preprocessor->Arena, conditional);
+    }
+    
+    Conditional->Location = GetTokenLocation(Current->Tokens, Directive);
+    Conditional->TookGroup = Taken;
+    Conditional->SawElse = false;
+    
+    Conditional->Previous = Current->Conditional;
+    Current->Conditional = Conditional;
+    
+    if(!Taken)
+    {
+        Token = SkipConditional(Current, Token);
+    }
+    
+    return Token;
+}
+
+internal void
+PreprocessorFill(token_buffer *Output, void *Context)
+{
+    // NOTE(felipe): Runs directives until at least one token can be handed
+    // to the reader of Output, expansions are always run to the end.
+    preprocessor *Preprocessor = (preprocessor *)Context;
+    
+    uint32 StartCount = Output->Count;
+    while((Output->Count == StartCount) || Preprocessor->Expansion)
+    {
+        macro_expansion *Expansion = Preprocessor->Expansion;
+        if(Expansion)
+        {
+            // NOTE(felipe): Replacements are scanned again before the rest
+            // of the input. A finished expansion is popped only after its
+            // last token was scanned, so a name at the very end of a
+            // replacement still sees its macro as being expanded.
+            if(Expansion->Token == Expansion->End)
+            {
+                PopExpansion(Preprocessor);
+                
+                if(!Preprocessor->Expansion)
+                {
+                    ResetScratch(Preprocessor);
+                }
+            }
+            else
+            {
+                ExpandToken(Preprocessor, Output, Expansion->Tokens, Expansion->Token++);
+            }
+        }
+        else if(Preprocessor->PrefixToken != Preprocessor->PrefixEnd)
+        {
+            Preprocessor->LineLocation = GetTokenLocation(Preprocessor->PrefixTokens, Preprocessor->PrefixToken);
+            CopyToken(Output, Preprocessor->PrefixTokens, Preprocessor->PrefixToken++);
+        }
+        else
+        {
+            preprocessor_input *Current = Preprocessor->Input;
+            token_buffer *Input = Current->Tokens;
+            token_index Token = Current->Token;
+            
+            if(GetTokenType(Input, Token) == TokenType_EOF)
+            {
+                if(Current->Conditional)
+                {
+                    ErrorAt(Current->Conditional->Location, "unterminated conditional directive");
+                }
+                
+                if(Current->GuardState == GuardState_After)
+                {
+                    GetHeaderInfo(Preprocessor, Current->Lexer.File)->GuardName = Current->GuardName;
+                }
+                
+                if(Current->Previous)
+                {
+                    PopInput(Preprocessor);
+                }
+                else
+                {
+                    // NOTE(felipe): The stream ends with the EOF of the main
+                    // file.
+                    CopyToken(Output, Input, Token);
+                }
+            }
+            else if((GetTokenKind(Input, Token) != Punctuator_Hash) || !TokenAtBeginningOfLine(Input, Token))
+            {
+                if(Current->GuardState != GuardState_Inside)
+                {
+                    Current->GuardState = GuardState_None;
+                }
+                
+                // NOTE(felipe): The arguments of a macro may follow in the
+                // input, they are read through Current->Token.
+                Current->Token = Token + 1;
+                Preprocessor->LineLocation = GetTokenLocation(Input, Token);
+                ExpandToken(Preprocessor, Output, Input, Token);
+                Token = Current->Token;
+            }
+            else
+            {
+                // NOTE(felipe): This token is a preprocessor directive.
+                ++Token;
+                
+                guard_state GuardState = Current->GuardState;
+                if(GuardState != GuardState_Inside)
+                {
+                    Current->GuardState = GuardState_None;
+                }
+                
+                if(TokenIs(Input, Token, "define"))
+                {
+                    if(!TokenAtBeginningOfLine(Input, Token + 1))
+                    {
+                        Token = DefineMacroDirective(Preprocessor, Input, Token + 1);
+                    }
+                    else
+                    {
+                        ErrorInToken(Input, Token, "invalid define directive");
+                    }
+                }
+                else if(TokenIs(Input, Token, "undef"))
+                {
+                    ++Token;
+                    
+                    token_type Type = GetTokenType(Input, Token);
+                    if(!TokenAtBeginningOfLine(Input, Token) &&
+                       (Type == TokenType_Identifier || Type == TokenType_Keyword))
+                    {
+                        UndefineMacro(&Preprocessor->Macros, GetTokenAtom(Input, Token));
+                        Token = SkipExtraTokens(Input, Token + 1, "undef");
+                    }
+                    else
+                    {
+                        ErrorInToken(Input, Token, "macro name missing");
+                    }
+                }
+                else if(TokenIs(Input, Token, "ifdef") || TokenIs(Input, Token, "ifndef"))
+                {
+                    token_index Directive = Token++;
+                    bool32 Negated = TokenIs(Input, Directive, "ifndef");
+                    
+                    atom Name = TokenAtBeginningOfLine(Input, Token) ? 0 : GetTokenAtom(Input, Token);
+                    if(!Name)
+                    {
+                        ErrorInToken(Input, Token, "macro name missing");
+                    }
+                    Token = SkipExtraTokens(Input, Token + 1, Negated ? "ifndef" : "ifdef");
+                    
+                    bool32 Defined = (FindMacro(&Preprocessor->Macros, Name) != 0);
+                    Token = BeginConditional(Preprocessor, Current, Directive, Token, Defined != Negated);
+                    
+                    if((GuardState == GuardState_Start) && Negated)
+                    {
+                        Current->GuardState = GuardState_Inside;
+                        Current->GuardName = Name;
+                        Current->GuardConditional = Current->Conditional;
+                    }
+                }
+                else if(TokenIs(Input, Token, "if"))
+                {
+                    token_index Directive = Token;
+                    bool32 Taken = EvaluateCondition(Preprocessor, Input, Directive, &Token);
+                    Token = BeginConditional(Preprocessor, Current, Directive, Token, Taken);
+                }
+                else if(TokenIs(Input, Token, "elif"))
+                {
+                    conditional *Conditional = Current->Conditional;
+                    if(!Conditional)
+                    {
+                        ErrorInToken(Input, Token, "#elif without #if");
+                    }
+                    else if(Conditional->SawElse)
+                    {
+                        ErrorInToken(Input, Token, "#elif after #else");
+                    }
+                    
+                    if((GuardState == GuardState_Inside) && (Conditional == Current->GuardConditional))
+                    {
+                        Current->GuardState = GuardState_None;
+                    }
+                    
+                    // NOTE(felipe): Once a group was taken the conditions
+                    // that follow are not even evaluated.
+                    if(Conditional->TookGroup)
+                    {
+                        do
+                        {
+                            ++Token;
+                        } while(!TokenAtBeginningOfLine(Input, Token));
+                        
+                        Token = SkipConditional(Current, Token);
+                    }
+                    else
+                    {
+                        Conditional->TookGroup = EvaluateCondition(Preprocessor, Input, Token, &Token);
+                        if(!Conditional->TookGroup)
+                        {
+                            Token = SkipConditional(Current, Token);
+                        }
+                    }
+                }
+                else if(TokenIs(Input, Token, "else"))
+                {
+                    conditional *Conditional = Current->Conditional;
+                    if(!Conditional)
+                    {
+                        ErrorInToken(Input, Token, "#else without #if");
+                    }
+                    else if(Conditional->SawElse)
+                    {
+                        ErrorInToken(Input, Token, "#else after #else");
+                    }
+                    
+                    if((GuardState == GuardState_Inside) && (Conditional == Current->GuardConditional))
+                    {
+                        Current->GuardState = GuardState_None;
+                    }
+                    Conditional->SawElse = true;
+                    
+                    Token = SkipExtraTokens(Input, Token + 1, "else");
+                    if(Conditional->TookGroup)
+                    {
+                        Token = SkipConditional(Current, Token);
+                    }
+                    Conditional->TookGroup = true;
+                }
+                else if(TokenIs(Input, Token, "endif"))
+                {
+                    conditional *Conditional = Current->Conditional;
+                    if(!Conditional)
+                    {
+                        ErrorInToken(Input, Token, "#endif without #if");
+                    }
+                    
+                    Token = SkipExtraTokens(Input, Token + 1, "endif");
+                    
+                    if((GuardState == GuardState_Inside) && (Conditional == Current->GuardConditional))
+                    {
+                        Current->GuardState = GuardState_After;
+                    }
+                    
+                    Current->Conditional = Conditional->Previous;
+                    Conditional->Previous = Preprocessor->FirstFreeConditional;
+                    Preprocessor->FirstFreeConditional = Conditional;
+                }
+                else if(TokenIs(Input, Token, "include"))
+                {
+                    ++Token;
+                    
+                    token_index FilenameToken = Token;
+                    
+                    // NOTE(felipe): The included file is found and pushed
+                    // on the include stack without anything being copied,
+                    // the file table keeps its own copy of a new name.
+                    char Filename[MAX_PATH_LENGTH];
+                    bool32 Angled = false;
+                    if(GetTokenType(Input, Token) == TokenType_String)
+                    {
+                        // Pattern 1: #include "foo.h"
+                        
+                        uint32 Length = GetTokenLength(Input, Token) - 2;
+                        if(Length >= sizeof(Filename))
+                        {
+                            ErrorInToken(Input, Token, "include path is too long");
+                        }
+                        
+                        MemCopy(Filename, GetTokenText(Input, Token) + 1, Length);
+                        Filename[Length] = 0;
+                        ++Token;
+                    }
+                    else if((GetTokenKind(Input, Token) == Punctuator_Less))
+                    {
+                        // Pattern 2: #include <foo.h>
+                        
+                        // NOTE(felipe): The name was lexed as ordinary
+                        // tokens, it is their text up to the '>' with a
+                        // space wherever there were blanks.
+                        Angled = true;
+                        
+                        uint32 Length = 0;
+                        for(++Token;
+                            ;
+                            ++Token)
+                        {
+                            if(TokenAtBeginningOfLine(Input, Token) || (GetTokenType(Input, Token) == TokenType_EOF))
+                            {
+                                ErrorInToken(Input, FilenameToken, "missing terminating > character");
+                            }
+                            
+                            bool32 Space = ((GetTokenFlags(Input, Token) & TokenFlag_SpaceBefore) != 0);
+                            bool32 Closing = (GetTokenKind(Input, Token) == Punctuator_Greater);
+                            uint32 TokenLength = Closing ? 0 : GetTokenLength(Input, Token);
+                            if(Length + Space + TokenLength >= sizeof(Filename))
+                            {
+                                ErrorInToken(Input, FilenameToken, "include path is too long");
+                            }
+                            
+                            if(Space)
+                            {
+                                Filename[Length++] = ' ';
+                            }
+                            
+                            if(Closing)
+                            {
+                                break;
+                            }
+                            
+                            MemCopy(Filename + Length, GetTokenText(Input, Token), TokenLength);
+                            Length += TokenLength;
+                        }
+                        Filename[Length] = 0;
+                        ++Token;
+                        
+                        if(!Length)
+                        {
+                            ErrorInToken(Input, FilenameToken, "empty filename in #include");
+                        }
+                    }
+                    else
+                    {
+                        ErrorInToken(Input, Token, "unexpected \"filename\" or <filename>");
+                    }
+                    
+                    // NOTE(felipe): The including file resumes after the
+                    // filename once the included one is done.
+                    Current->Token = Token;
+                    IncludeFile(Preprocessor, Filename, Angled, Input, FilenameToken);
+                }
+                else if(TokenIs(Input, Token, "pragma"))
+                {
+                    ++Token;
+                    
+                    if(!TokenAtBeginningOfLine(Input, Token) && TokenIs(Input, Token, "once"))
+                    {
+                        GetHeaderInfo(Preprocessor, Current->Lexer.File)->PragmaOnce = true;
+                        Token = SkipExtraTokens(Input, Token + 1, "pragma once");
+                    }
+                    else
+                    {
+                        // NOTE(felipe): Other pragmas are ignored.
+                        while(!TokenAtBeginningOfLine(Input, Token))
+                        {
+                            ++Token;
+                        }
+                    }
+                }
+                else if(TokenIs(Input, Token, "error"))
+                {
+                    ErrorInToken(Input, Token + 1, "error preprocessor directive");
+                }
+                else if(TokenIs(Input, Token, "warning"))
+                {
+                    WarningInToken(Input, Token + 1, "warning preprocessor directive");
+                    
+                    do
+                    {
+                        ++Token;
+                    } while(!TokenAtBeginningOfLine(Input, Token));
+                }
+                else
+                {
+                    ErrorInToken(Input, Token, "unsupported preprocessor directive");
+                }
+            }
+
+            
+            Current->Token = Token;
+            ReleaseTokens(Input, Token);
+        }
+    }
+    
+    // DEBUG: Print produced tokens.
+    if(Preprocessor->PrintTokens)
+    {
+        char *TokenTypes[] =
+            {
+                "Ident",
+                "Punct",
+                "Keywo",
+                "Numbe",
+                "Strin",
+                "EOF  ",
+            };
+        
+        for(token_index Token = Output->First + StartCount;
+            Token < Output->First + Output->Count;
+            ++Token)
+        {
+            printf(" Token %c (%s): %.*s\n", TokenAtBeginningOfLine(Output, Token)?'Y':'N',
+                   TokenTypes[GetTokenType(Output, Token)],
+                   GetTokenLength(Output, Token), GetTokenText(Output, Token));
+        }
+    }
+    //
+}
+
+internal token_buffer *
+BeginPreprocessor(preprocessor *Preprocessor, memory_arena *TokenArena, memory_arena *Arena,
+                  loaded_file *File, token_buffer *FileTokens)
+{
+    // NOTE(felipe): The returned buffer is a window over the preprocessed
+    // token stream, reading it runs the preprocessor and the lexer as needed.
+    // FileTokens, if given, are all the tokens of File lexed beforehand.
+    Preprocessor->TokenArena = TokenArena;
+    Preprocessor->Arena = Arena;
+    Preprocessor->MacroTokens = NewTokenBuffer(Arena, 0, 0);
+    Preprocessor->ScratchTokens = NewTokenBuffer(Arena, 0, 0);
+    Preprocessor->VariadicName = InternAtom("__VA_ARGS__", 11);
+    Preprocessor->DefinedName = InternAtom("defined", 7);
+    
+    if(FileTokens)
+    {
+        preprocessor_input *Input = PushStruct(TokenArena, preprocessor_input);
+        Input->Lexer = BeginLexer(File);
+        Input->Tokens = FileTokens;
+        Input->Conditional = 0;
+        Input->GuardState = GuardState_Start;
+        
+        Preprocessor->Input = Input;
+    }
+    else
+    {
+        PushInput(Preprocessor, File);
+    }
+    
+    token_buffer *Result = NewTokenBuffer(TokenArena, INPUT_WINDOW_SIZE, 0);
+    Result->Fill = PreprocessorFill;
+    Result->FillContext = Preprocessor;
+    
+    return Result;
+}
+
+internal void
+PrintHeaderStats(preprocessor *Preprocessor)
+{
+    // NOTE(felipe): Skipped includes are the hits, the rest had to be lexed.
+    printf("\nHeaders\n");
+    printf("  %8s %8s %8s\n", "included", "skipped", "lexed");
+    for(uint32 Index = 0;
+        Index < Preprocessor->HeaderCapacity;
+        ++Index)
+    {
+        header_info *Header = Preprocessor->Headers + Index;
+        if(Header->IncludeCount)
+        {
+            printf("  %8u %8u %8u  %s", Header->IncludeCount, Header->SkipCount,
+                   Header->IncludeCount - Header->SkipCount, GlobalFiles.Files[Index].Filename);
+            if(Header->PragmaOnce)
+            {
+                printf(" (#pragma once)");
+            }
+            else if(Header->GuardName)
+            {
+                printf(" (guarded by %s)", GetAtomString(Header->GuardName));
+            }
+            printf("\n");
+        }
+    }
+    
+    printf("  %u include directories listed\n", GlobalDirectories.ListedCount);
+}
+
+internal void
+PushMakeText(memory_arena *Text, char *String, bool32 Escape)
+{
+    // NOTE(felipe): Escaped names are read by make as one word, blanks and #
+    // get a backslash and $ is doubled.
+    for(char *At = String;
+        *At;
+        ++At)
+    {
+        if(Escape && ((*At == ' ') || (*At == '\t') || (*At == '#')))
+        {
+            *(char *)PushSize(Text, 1) = '\\';
+        }
+        else if(Escape && (*At == '$'))
+        {
+            *(char *)PushSize(Text, 1) = '$';
+        }
+        
+        *(char *)PushSize(Text, 1) = *At;
+    }
+}
+
+internal void
+WriteDependencies(preprocessor *Preprocessor, char *Filename, char *Target, bool32 QuoteTarget,
+                  loaded_file *InputFile, char *PchFilename)
+{
+    // NOTE(felipe): A make rule for Target with the input, the precompiled
+    // header and every file an #include reached as prerequisites. The header
+    // table already has all of them, included and skipped ones, so nothing is
+    // recorded while preprocessing. Target is written as it is unless it
+    // has to be quoted.
+    memory_arena Text = {0};
+    
+    PushMakeText(&Text, Target, QuoteTarget);
+    PushMakeText(&Text, ": ", false);
+    PushMakeText(&Text, InputFile->Filename, true);
+    
+    if(PchFilename)
+    {
+        PushMakeText(&Text, " \\\n  ", false);
+        PushMakeText(&Text, PchFilename, true);
+    }
+    
+    for(uint32 Index = 0;
+        Index < Preprocessor->HeaderCapacity;
+        ++Index)
+    {
+        if(Preprocessor->Headers[Index].IncludeCount)
+        {
+            PushMakeText(&Text, " \\\n  ", false);
+            PushMakeText(&Text, GlobalFiles.Files[Index].Filename, true);
+        }
+    }
+    PushMakeText(&Text, "\n", false);
+    
+    if(!PlatformWriteEntireFile(Filename, Text.Memory, Text.Used))
+    {
+        Error("could not write dependency file: %s", Filename);
+    }
+    
+    ReleaseArena(&Text);
+}
+
+internal void
+FlushTextOutput(text_output *Output)
+{
+    if(Output->Used)
+    {
+        if(!PlatformWriteStandardOutput(Output->Base, Output->Used))
+        {
+            Error("could not write the preprocessed output");
+        }
+        Output->Used = 0;
+    }
+}
+
+inline char *
+ReserveTextOutput(text_output *Output, uint32 Size)
+{
+    // NOTE(felipe): Size has to fit in the empty buffer, callers give back
+    // what they did not use by moving Used.
+    Assert(Size <= Output->Size);
+    if(Output->Used + Size > Output->Size)
+    {
+        FlushTextOutput(Output);
+    }
+    
+    char *Result = Output->Base + Output->Used;
+    Output->Used += Size;
+    
+    return Result;
+}
+
+internal void
+WriteLineMarker(text_output *Output, uint32 Line, char *Filename)
+{
+    // NOTE(felipe): # <line> "<file>", with quotes and backslashes in the
+    // name escaped.
+    uint32 Length = StringLength(Filename);
+    char *Start = ReserveTextOutput(Output, 2*Length + 16);
+    char *At = Start;
+    
+    *At++ = '#';
+    *At++ = ' ';
+    
+    char Digits[10];
+    uint32 DigitCount = 0;
+    do
+    {
+        Digits[DigitCount++] = (char)('0' + Line % 10);
+        Line /= 10;
+    } while(Line);
+    
+    while(DigitCount)
+    {
+        *At++ = Digits[--DigitCount];
+    }
+    
+    *At++ = ' ';
+    *At++ = '"';
+    for(uint32 Index = 0;
+        Index < Length;
+        ++Index)
+    {
+        if((Filename[Index] == '"') || (Filename[Index] == '\\'))
+        {
+            *At++ = '\\';
+        }
+        *At++ = Filename[Index];
+    }
+    *At++ = '"';
+    *At++ = '\n';
+    
+    Output->Used -= (uint32)(2*Length + 16 - (At - Start));
+}
+
+inline bool32
+IsWordToken(token_type Type)
+{
+    bool32 Result = ((Type == TokenType_Identifier) || (Type == TokenType_Keyword) ||
+                     (Type == TokenType_Number));
+    return Result;
+}
+
+internal bool32
+TokensWouldPaste(token_type LeftType, char LeftLast, token_type RightType, char RightFirst)
+{
+    // NOTE(felipe): True for every pair that could lex as something else
+    // once written without blanks between them, and some that would not.
+    bool32 Result = false;
+    if(IsWordToken(LeftType))
+    {
+        Result = (IsWordToken(RightType) || (RightType == TokenType_String) ||
+                  ((LeftType == TokenType_Number) &&
+                   ((RightFirst == '.') || (RightFirst == '+') || (RightFirst == '-'))));
+    }
+    else if(LeftType == TokenType_Punctuation)
+    {
+        if(LeftLast == '.')
+        {
+            Result = ((RightFirst == '.') || ((RightFirst >= '0') && (RightFirst <= '9')));
+        }
+        else if(RightType == TokenType_Punctuation)
+        {
+            char *Left = "+-*/%<>=!&|^#:";
+            char *Right = "+-*/%<>=&|#:.";
+            
+            bool32 LeftJoins = false;
+            for(char *At = Left; *At; ++At)
+            {
+                LeftJoins |= (*At == LeftLast);
+            }
+            
+            for(char *At = Right; LeftJoins && *At; ++At)
+            {
+                Result |= (*At == RightFirst);
+            }
+        }
+    }
+    
+    return Result;
+}
+
+internal void
+WritePreprocessedTokens(memory_arena *Arena, preprocessor *Preprocessor, token_buffer *Tokens)
+{
+    // NOTE(felipe): Writes the preprocessed stream as text, the way cpp does.
+    // The tokens of one fill all came from one input token, the first of them
+    // goes on that token's line when it starts a line. Lines are kept in step
+    // with the input with newlines for short gaps and line markers for the
+    // rest, including a file read again from the top. Other tokens get a
+    // space where there was one or where the two would lex as one token.
+    text_output Output = {0};
+    Output.Size = TEXT_OUTPUT_SIZE;
+    Output.Base = (char *)PushSize(Arena, Output.Size);
+    
+    loaded_file *File = 0;
+    uint32 Line = 0;
+    source_location LineLocation = 0;
+    bool32 AtLineStart = true;
+    
+    token_type PreviousType = TokenType_EOF;
+    char PreviousLast = 0;
+    source_location PreviousEnd = 0;
+    
+    token_index FillEnd = 0;
+    token_index Token = 0;
+    while(GetTokenType(Tokens, Token) != TokenType_EOF)
+    {
+        token_type Type = GetTokenType(Tokens, Token);
+        uint32 Flags = GetTokenFlags(Tokens, Token);
+        source_location Location = GetTokenLocation(Tokens, Token);
+        uint32 Length = GetTokenLength(Tokens, Token);
+        char *Text = GetSourcePointer(Location);
+        
+        bool32 Space = ((Flags & (TokenFlag_AtBeginningOfLine|TokenFlag_SpaceBefore)) ||
+                        ((Location != PreviousEnd) && TokensWouldPaste(PreviousType, PreviousLast, Type, Text[0])));
+        
+        if(Token >= FillEnd)
+        {
+            FillEnd = Tokens->First + Tokens->Count;
+            
+            bool32 WentBack = (Preprocessor->LineLocation <= LineLocation);
+            LineLocation = Preprocessor->LineLocation;
+            
+            if(!File || (Flags & TokenFlag_AtBeginningOfLine))
+            {
+                source_position Position = GetSourcePosition(LineLocation);
+                if((Position.File != File) || WentBack || (Position.Line > Line + MAX_LINE_GAP))
+                {
+                    if(!AtLineStart)
+                    {
+                        *ReserveTextOutput(&Output, 1) = '\n';
+                    }
+                    
+                    WriteLineMarker(&Output, Position.Line, Position.File->Filename);
+                    File = Position.File;
+                    Line = Position.Line;
+                    AtLineStart = true;
+                }
+                else if(Position.Line > Line)
+                {
+                    char *At = ReserveTextOutput(&Output, Position.Line - Line);
+                    while(Line < Position.Line)
+                    {
+                        *At++ = '\n';
+                        ++Line;
+                    }
+                    AtLineStart = true;
+                }
+            }
+        }
+        
+        if(Space && !AtLineStart)
+        {
+            *ReserveTextOutput(&Output, 1) = ' ';
+        }
+        
+        if(Length <= Output.Size)
+        {
+            char *At = ReserveTextOutput(&Output, Length);
+            if(Flags & TokenFlag_Spliced)
+            {
+                Output.Used -= Length - RemoveLineContinuations(Text, Length, At, Length);
+            }
+            else
+            {
+                MemCopy(At, Text, Length);
+            }
+        }
+        else
+        {
+            FlushTextOutput(&Output);
+            if(!PlatformWriteStandardOutput(Text, Length))
+            {
+                Error("could not write the preprocessed output");
+            }
+        }
+        AtLineStart = false;
+        
+        PreviousType = Type;
+        PreviousLast = Text[Length - 1];
+        PreviousEnd = Location + Length;
+        
+        ++Token;
+        ReleaseTokens(Tokens, Token);
+    }
+    
+    if(!AtLineStart)
+    {
+        *ReserveTextOutput(&Output, 1) = '\n';
+    }
+    FlushTextOutput(&Output);
+}
+
+internal void
+BenchmarkPreprocessor(memory_arena *Arena, loaded_file *File, struct precompiled_header *PrecompiledHeader)
+{
+    // NOTE(felipe): Pulls the whole preprocessed stream of the file, lexing
+    // included since it runs on demand. Installing the precompiled header,
+    // if there is one, is part of every run.
+    uint32 TokenCount = 0;
+    memory_index AllocatedSize = 0;
+    uint32 Runs = 0;
+    real64 BestSeconds = 0;
+    real64 TotalSeconds = 0;
+    for(uint32 Run = 0;
+        Run < 5 || TotalSeconds < 1.0;
+        ++Run)
+    {
+        temporary_memory PreprocessorMemory = BeginTemporaryMemory(Arena);
+        
+        uint64 Start = PlatformGetWallClock();
+        
+        preprocessor Preprocessor = {0};
+        token_buffer *Tokens = BeginPreprocessor(&Preprocessor, Arena, Arena, File, 0);
+        if(PrecompiledHeader)
+        {
+            UsePrecompiledHeader(&Preprocessor, PrecompiledHeader);
+        }
+        
+        token_index Token = 0;
+        while(GetTokenType(Tokens, Token) != TokenType_EOF)
+        {
+            ++Token;
+            ReleaseTokens(Tokens, Token);
+        }
+        
+        real64 Seconds = PlatformGetSecondsElapsed(Start, PlatformGetWallClock());
+        
+        AllocatedSize = Arena->Used - PreprocessorMemory.Used;
+        EndTemporaryMemory(PreprocessorMemory);
+        
+        TokenCount = Token;
+        if(Run == 0 || Seconds < BestSeconds)
+        {
+            BestSeconds = Seconds;
+        }
+        TotalSeconds += Seconds;
+        ++Runs;
+    }
+    
+    printf("Preprocessor benchmark: %s (%llu bytes, %u tokens out, best of %u runs)\n",
+           File->Filename, (unsigned long long)File->Size, TokenCount, Runs);
+    printf("  %10.2f Mtokens/s %10.2f MB/s %8.3f ms\n",
+           (real64)TokenCount / BestSeconds / 1000000.0,
+           (real64)File->Size / BestSeconds / (1024.0*1024.0), BestSeconds*1000.0);
+    printf("  %10zu bytes allocated\n", AllocatedSize);
+}
@@ -0,0 +1,256 @@
+#if !defined(CORSAC_PREPROCESSOR_H)
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Felipe Carlin $
+   $Notice: Copyright  2022 Felipe Carlin $
+   ======================================================================== */
+
+typedef struct macro
+{
+    // NOTE(felipe): Macros copy their name and replacement into a buffer of
+    // their own, the file they came from is not kept around.
+    token_buffer *Tokens;
+    token_index Identifier;
+    atom Name;
+    
+    // NOTE(felipe): Does include Start, does not include End.
+    token_index Start;
+    token_index End;
+    
+    // NOTE(felipe): ParameterRefs has an entry per replacement token of a
+    // function-like macro, one plus the parameter the token names or zero,
+    // with MACRO_PARAMETER_AS_WRITTEN set for operands of # and ##. The last
+    // parameter of a variadic macro is __VA_ARGS__.
+    bool32 FunctionLike;
+    bool32 Variadic;
+    uint32 ParameterCount;
+    uint8 *ParameterRefs;
+    
+    // NOTE(felipe): Object-like macros without ## are read in place, the
+    // rest are substituted into the scratch tokens first.
+    bool32 HasPaste;
+    
+    // NOTE(felipe): Set while the macro is on the expansion stack, its name
+    // is not expanded again inside its own replacement.
+    bool32 Expanding;
+} macro;
+
+#define MAX_MACRO_PARAMETER_COUNT 127
+#define MACRO_PARAMETER_INDEX_MASK 0x7f
+#define MACRO_PARAMETER_AS_WRITTEN 0x80
+
+// NOTE(felipe): The tokens of one argument of an invocation as written, in
+// the scratch tokens, and once a parameter needs it fully macro expanded.
+typedef struct macro_argument
+{
+    token_index Start;
+    token_index End;
+    
+    // NOTE(felipe): Variable arguments that were left out, not just empty.
+    bool32 Omitted;
+    
+    bool32 Expanded;
+    token_buffer *ExpandedTokens;
+    token_index ExpandedStart;
+    token_index ExpandedEnd;
+} macro_argument;
+
+// NOTE(felipe): Expanding an argument writes scratch tokens for the
+// invocations inside it, so its result goes to a buffer of its own. There is
+// one per level of arguments nested in arguments.
+typedef struct argument_buffer
+{
+    token_buffer *Tokens;
+    
+    struct argument_buffer *Previous;
+    struct argument_buffer *Next;
+} argument_buffer;
+
+typedef struct macro_slot
+{
+    atom Name;
+    macro *Macro;
+} macro_slot;
+
+// NOTE(felipe): The slots of Map are macro_slots, #undef only clears their
+// macro, so a redefinition lands in the same slot.
+typedef struct macro_table
+{
+    uint32 Count;
+    atom_map Map;
+} macro_table;
+
+#define MIN_MACRO_SLOT_COUNT 256
+
+// NOTE(felipe): An #if, #ifdef or #ifndef whose #endif was not reached yet.
+// Only groups that are taken are ever lexed, the rest are skipped by the
+// lexer.
+typedef struct conditional
+{
+    source_location Location;
+    
+    bool32 TookGroup;
+    bool32 SawElse;
+    
+    struct conditional *Previous;
+} conditional;
+
+// NOTE(felipe): Reads the macro expanded line of an #if or #elif. Operands
+// that short-circuiting skips are read without evaluating them, so that they
+// cannot fail.
+typedef struct condition_parser
+{
+    token_buffer *Tokens;
+    token_index Token;
+    token_index End;
+} condition_parser;
+
+// NOTE(felipe): #if computes in intmax_t and uintmax_t, both are 64 bits
+// here. Value holds the bits either way.
+typedef struct condition_value
+{
+    uint64 Value;
+    bool32 Unsigned;
+} condition_value;
+
+// NOTE(felipe): What the preprocessor learned about a file from including it,
+// indexed by the position of the file in the file table. A file whose
+// tokens and directives all sit inside #ifndef GuardName ... #endif is not
+// read again while GuardName is defined, neither is one that says
+// #pragma once.
+typedef struct header_info
+{
+    atom GuardName;
+    bool32 PragmaOnce;
+    
+    uint32 IncludeCount;
+    uint32 SkipCount;
+} header_info;
+
+// NOTE(felipe): Include guards are found as a file is preprocessed: its
+// first directive has to be an #ifndef, and nothing but blanks and comments
+// can come after the #endif that closes it.
+typedef enum guard_state
+{
+    GuardState_Start,
+    GuardState_Inside,
+    GuardState_After,
+    GuardState_None,
+} guard_state;
+
+// NOTE(felipe): One entry of the include stack, a file being lexed on demand
+// through a window of tokens. Conditionals have to end in the file they
+// start in.
+typedef struct preprocessor_input
+{
+    lexer Lexer;
+    token_buffer *Tokens;
+    token_index Token;
+    
+    conditional *Conditional;
+    
+    guard_state GuardState;
+    atom GuardName;
+    conditional *GuardConditional;
+    
+    struct preprocessor_input *Previous;
+} preprocessor_input;
+
+#define INPUT_WINDOW_SIZE 1024
+
+// NOTE(felipe): Counting the main file, a header that includes itself
+// without a guard stops here instead of running out of memory.
+#define MAX_INCLUDE_DEPTH 200
+
+// NOTE(felipe): One entry of the expansion stack, a cursor over the
+// replacement of Macro. That is the macro's own tokens, or the result of
+// substituting its arguments in the scratch tokens. An entry without a macro
+// is an argument being expanded, reading never goes past its end.
+typedef struct macro_expansion
+{
+    macro *Macro;
+    
+    token_buffer *Tokens;
+    token_index Token;
+    token_index End;
+    
+    struct macro_expansion *Previous;
+} macro_expansion;
+
+// NOTE(felipe): Tokens made by # and ## are lexed from text written here, so
+// that they have locations like any other token.
+#define SCRATCH_FILE_SIZE (64*1024)
+
+typedef struct preprocessor
+{
+    // NOTE(felipe): Token windows go on TokenArena, everything else the
+    // preprocessor needs goes on Arena.
+    memory_arena *TokenArena;
+    memory_arena *Arena;
+    
+    macro_table Macros;
+    token_buffer *MacroTokens;
+    
+    preprocessor_input *Input;
+    preprocessor_input *FirstFreeInput;
+    uint32 InputDepth;
+    
+    macro_expansion *Expansion;
+    macro_expansion *FirstFreeExpansion;
+    
+    conditional *FirstFreeConditional;
+    
+    uint32 HeaderCapacity;
+    header_info *Headers;
+    
+    // NOTE(felipe): Output of a precompiled header still to be handed out,
+    // it comes before the main file as it is.
+    token_buffer *PrefixTokens;
+    token_index PrefixToken;
+    token_index PrefixEnd;
+    
+    // NOTE(felipe): Arguments and substituted replacements, emptied along
+    // with the argument buffers every time the expansion stack is.
+    token_buffer *ScratchTokens;
+    argument_buffer *FirstArgumentBuffer;
+    argument_buffer *ArgumentBuffer;
+    
+    loaded_file *ScratchFile;
+    uint32 ScratchFileUsed;
+    
+    atom VariadicName;
+    atom DefinedName;
+    
+    // NOTE(felipe): Leading flags of the last macro name that was expanded,
+    // the first token that comes out of the expansion takes them.
+    uint32 PendingFlags;
+    
+    // NOTE(felipe): Location of the input token that the tokens of the last
+    // fill came from, -E writes them on its line.
+    source_location LineLocation;
+    
+    bool32 PrintTokens;
+} preprocessor;
+
+// NOTE(felipe): Text written by -E is gathered here and goes out in writes
+// of TEXT_OUTPUT_SIZE bytes.
+typedef struct text_output
+{
+    char *Base;
+    uint32 Size;
+    uint32 Used;
+} text_output;
+
+#define TEXT_OUTPUT_SIZE Megabytes(1)
+
+// NOTE(felipe): Gaps of up to this many lines are written as empty lines,
+// longer ones get a line marker.
+#define MAX_LINE_GAP 8
+
+struct precompiled_header;
+internal void UsePrecompiledHeader(preprocessor *Preprocessor, struct precompiled_header *PrecompiledHeader);
+
+#define CORSAC_PREPROCESSOR_H
+#endif
@@ -0,0 +1,501 @@
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Felipe Carlin $
+   $Notice: Copyright  2022 Felipe Carlin $
+   ======================================================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "corsac.h"
+#include "linux_corsac.h"
+
+// TODO(felipe): Remove globals
+global_variable bool32 GlobalUseColor;
+
+#define LINUX_COLOR_RED "\x1b[91m"
+#define LINUX_COLOR_YELLOW "\x1b[33m"
+#define LINUX_COLOR_GREEN "\x1b[32m"
+#define LINUX_COLOR_DEFAULT "\x1b[0m"
+
+internal void
+LinuxSetColor(FILE *Stream, char *Color)
+{
+    if(GlobalUseColor)
+    {
+        fputs(Color, Stream);
+    }
+}
+
+internal void
+Error(char *Format, ...)
+{
+    va_list AP;
+    va_start(AP, Format);
+    
+    LinuxSetColor(stderr, LINUX_COLOR_RED);
+    fprintf(stderr, "error: ");
+    LinuxSetColor(stderr, LINUX_COLOR_DEFAULT);
+    vfprintf(stderr, Format, AP);
+    fprintf(stderr, "\n");
+    
+    va_end(AP);
+    exit(1);
+}
+
+internal void
+LinuxPrintDiagnostic(char *Label, char *Color, source_location Location, char *Format, va_list AP)
+{
+    source_position Position = GetSourcePosition(Location);
+    
+    LinuxSetColor(stderr, Color);
+    uint32 Indent = fprintf(stderr, "%s: ", Label);
+    LinuxSetColor(stderr, LINUX_COLOR_DEFAULT);
+    
+    Indent += fprintf(stderr, "%s:%u:%u: ", Position.File->Filename, Position.Line, Position.Column);
+    
+    // NOTE(felipe): The caret goes under the column, a column past the end
+    // of the line is the newline or EOF.
+    fprintf(stderr, "%.*s\n%*s^ ", (int32)Position.LineLength, Position.LineStart,
+            (int32)(Indent + Position.Column - 1), "");
+    
+    vfprintf(stderr, Format, AP);
+    fprintf(stderr, "\n");
+}
+
+internal void
+ErrorAt(source_location Location, char *Format, ...)
+{
+    va_list AP;
+    va_start(AP, Format);
+    
+    LinuxPrintDiagnostic("error", LINUX_COLOR_RED, Location, Format, AP);
+    
+    va_end(AP);
+    exit(1);
+}
+
+internal void
+ErrorInToken(token_buffer *Tokens, token_index Token, char *Format, ...)
+{
+    va_list AP;
+    va_start(AP, Format);
+    
+    LinuxPrintDiagnostic("error", LINUX_COLOR_RED, GetTokenLocation(Tokens, Token), Format, AP);
+    
+    va_end(AP);
+    exit(1);
+}
+
+internal void
+Warning(char *Format, ...)
+{
+    va_list AP;
+    va_start(AP, Format);
+    
+    LinuxSetColor(stderr, LINUX_COLOR_YELLOW);
+    fprintf(stderr, "warning: ");
+    LinuxSetColor(stderr, LINUX_COLOR_DEFAULT);
+    vfprintf(stderr, Format, AP);
+    fprintf(stderr, "\n");
+    
+    va_end(AP);
+}
+
+internal void
+WarningAt(source_location Location, char *Format, ...)
+{
+    va_list AP;
+    va_start(AP, Format);
+    
+    LinuxPrintDiagnostic("warning", LINUX_COLOR_YELLOW, Location, Format, AP);
+    
+    va_end(AP);
+}
+
+internal void
+WarningInToken(token_buffer *Tokens, token_index Token, char *Format, ...)
+{
+    va_list AP;
+    va_start(AP, Format);
+    
+    LinuxPrintDiagnostic("warning", LINUX_COLOR_YELLOW, GetTokenLocation(Tokens, Token), Format, AP);
+    
+    va_end(AP);
+}
+
+internal uint32
+LinuxGetTime(void)
+{
+    uint32 Result = 0;
+    
+    time_t Time = time(0);
+    Result = (uint32)Time;
+    
+    return Result;
+}
+
+internal uint64
+LinuxGetWallClock(void)
+{
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    
+    uint64 Result = (uint64)Time.tv_sec*1000000000ULL + (uint64)Time.tv_nsec;
+    return Result;
+}
+
+internal real64
+LinuxGetSecondsElapsed(uint64 Start, uint64 End)
+{
+    real64 Result = (real64)(End - Start) / 1000000000.0;
+    return Result;
+}
+
+internal loaded_file
+LinuxReadEntireFile(char *Filename)
+{
+    loaded_file Result = {0};
+    
+    int FileHandle = open(Filename, O_RDONLY);
+    if(FileHandle != -1)
+    {
+        struct stat FileStat;
+        if(fstat(FileHandle, &FileStat) == 0)
+        {
+            uint32 FileSize32 = SafeTruncateUInt64(FileStat.st_size);
+            
+            // NOTE(felipe): Reserve the file rounded up to whole pages plus
+            // one extra page, then map the file read-only over the front of
+            // that range. Everything past the last byte of the file reads as
+            // zero, so the tokenizer always finds its NUL terminator and the
+            // file contents are never copied.
+            memory_index PageSize = (memory_index)sysconf(_SC_PAGESIZE);
+            memory_index MappedSize = ((FileSize32 + PageSize - 1) & ~(PageSize - 1)) + PageSize;
+            
+            void *Memory = mmap(0, MappedSize, PROT_READ, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+            if(Memory != MAP_FAILED)
+            {
+                if((FileSize32 == 0) ||
+                   (mmap(Memory, FileSize32, PROT_READ, MAP_PRIVATE|MAP_FIXED, FileHandle, 0) != MAP_FAILED))
+                {
+                    // NOTE(felipe): File mapped succesfully.
+                    madvise(Memory, FileSize32, MADV_SEQUENTIAL);
+                    
+                    Result.Filename = Filename;
+                    Result.Memory = Memory;
+                    Result.Size = FileSize32;
+                }
+                else
+                {
+                    munmap(Memory, MappedSize);
+                }
+            }
+        }
+        
+        close(FileHandle);
+    }
+    
+    return Result;
+}
+
+internal bool32
+LinuxGetCanonicalPath(char *Path, char *Buffer, uint32 BufferSize)
+{
+    // NOTE(felipe): Absolute, with no symbolic links, "." or "..", so every
+    // path to the same existing file gives the same string.
+    bool32 Result = false;
+    
+    char Resolved[PATH_MAX];
+    if(realpath(Path, Resolved))
+    {
+        uint32 Length = StringLength(Resolved);
+        if(Length < BufferSize)
+        {
+            MemCopy(Buffer, Resolved, Length + 1);
+            Result = true;
+        }
+    }
+    
+    return Result;
+}
+
+internal bool32
+LinuxListDirectory(char *Path, platform_directory_entry_callback *Callback, void *Data)
+{
+    bool32 Result = false;
+    
+    DIR *Directory = opendir(Path);
+    if(Directory)
+    {
+        struct dirent *Entry;
+        while((Entry = readdir(Directory)))
+        {
+            Callback(Data, Entry->d_name);
+        }
+        
+        closedir(Directory);
+        Result = true;
+    }
+    
+    return Result;
+}
+
+internal bool32
+LinuxWriteEntireFile(char *Filename, void *Memory, memory_index MemorySize)
+{
+    bool32 Result = false;
+    
+    int FileHandle = open(Filename, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if(FileHandle != -1)
+    {
+        memory_index BytesWritten = 0;
+        while(BytesWritten < MemorySize)
+        {
+            ssize_t Written = write(FileHandle, (uint8 *)Memory + BytesWritten, MemorySize - BytesWritten);
+            if(Written <= 0)
+            {
+                // TODO(felipe): Logging.
+                break;
+            }
+            
+            BytesWritten += Written;
+        }
+        
+        Result = (BytesWritten == MemorySize);
+        
+        close(FileHandle);
+    }
+    else
+    {
+        // TODO(felipe): Logging.
+    }
+    
+    return Result;
+}
+
+internal bool32
+LinuxWriteStandardOutput(void *Memory, memory_index MemorySize)
+{
+    // NOTE(felipe): Whatever printf still holds goes out first.
+    fflush(stdout);
+    
+    memory_index BytesWritten = 0;
+    while(BytesWritten < MemorySize)
+    {
+        ssize_t Written = write(STDOUT_FILENO, (uint8 *)Memory + BytesWritten, MemorySize - BytesWritten);
+        if(Written <= 0)
+        {
+            // TODO(felipe): Logging.
+            break;
+        }
+        
+        BytesWritten += Written;
+    }
+    
+    bool32 Result = (BytesWritten == MemorySize);
+    return Result;
+}
+
+internal void *
+LinuxReserveMemory(memory_index Size)
+{
+    void *Result = mmap(0, Size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if(Result == MAP_FAILED)
+    {
+        Result = 0;
+    }
+    
+    return Result;
+}
+
+internal bool32
+LinuxCommitMemory(void *Memory, memory_index Size)
+{
+    bool32 Result = (mprotect(Memory, Size, PROT_READ|PROT_WRITE) == 0);
+    return Result;
+}
+
+internal void
+LinuxReleaseMemory(void *Memory, memory_index Size)
+{
+    munmap(Memory, Size);
+}
+
+//
+// NOTE(felipe): Work queue
+//
+
+internal bool32
+LinuxDoNextWorkQueueEntry(platform_work_queue *Queue)
+{
+    bool32 ShouldSleep = false;
+    
+    uint32 OriginalNextEntryToRead = Queue->NextEntryToRead;
+    uint32 NewNextEntryToRead = (OriginalNextEntryToRead + 1) % WORK_QUEUE_ENTRY_COUNT;
+    if(OriginalNextEntryToRead != Queue->NextEntryToWrite)
+    {
+        uint32 Index = __sync_val_compare_and_swap(&Queue->NextEntryToRead,
+                                                   OriginalNextEntryToRead,
+                                                   NewNextEntryToRead);
+        if(Index == OriginalNextEntryToRead)
+        {
+            platform_work_queue_entry Entry = Queue->Entries[Index];
+            Entry.Callback(Queue, Entry.Data);
+            __sync_fetch_and_add(&Queue->CompletionCount, 1);
+        }
+    }
+    else
+    {
+        ShouldSleep = true;
+    }
+    
+    return ShouldSleep;
+}
+
+internal void *
+LinuxWorkerThreadProc(void *Parameter)
+{
+    platform_work_queue *Queue = (platform_work_queue *)Parameter;
+    
+    while(!Queue->Quit)
+    {
+        if(LinuxDoNextWorkQueueEntry(Queue) && !Queue->Quit)
+        {
+            sem_wait(&Queue->Semaphore);
+        }
+    }
+    
+    return 0;
+}
+
+internal platform_work_queue *
+LinuxCreateWorkQueue(uint32 ThreadCount)
+{
+    Assert((ThreadCount > 0) && (ThreadCount <= MAX_THREAD_COUNT));
+    
+    platform_work_queue *Queue = (platform_work_queue *)LinuxReserveMemory(sizeof(platform_work_queue));
+    if(!Queue || !LinuxCommitMemory(Queue, sizeof(platform_work_queue)))
+    {
+        Error("out of memory");
+    }
+    
+    sem_init(&Queue->Semaphore, 0, 0);
+    
+    // NOTE(felipe): The thread that completes the work is one of the
+    // threads, only the rest are workers.
+    for(uint32 WorkerIndex = 0;
+        WorkerIndex < ThreadCount - 1;
+        ++WorkerIndex)
+    {
+        if(pthread_create(Queue->Workers + WorkerIndex, 0, LinuxWorkerThreadProc, Queue) != 0)
+        {
+            Error("could not create worker thread");
+        }
+        ++Queue->WorkerCount;
+    }
+    
+    return Queue;
+}
+
+internal void
+LinuxDestroyWorkQueue(platform_work_queue *Queue)
+{
+    Queue->Quit = true;
+    __sync_synchronize();
+    
+    for(uint32 WorkerIndex = 0;
+        WorkerIndex < Queue->WorkerCount;
+        ++WorkerIndex)
+    {
+        sem_post(&Queue->Semaphore);
+    }
+    
+    for(uint32 WorkerIndex = 0;
+        WorkerIndex < Queue->WorkerCount;
+        ++WorkerIndex)
+    {
+        pthread_join(Queue->Workers[WorkerIndex], 0);
+    }
+    
+    sem_destroy(&Queue->Semaphore);
+    LinuxReleaseMemory(Queue, sizeof(platform_work_queue));
+}
+
+internal void
+LinuxAddWorkEntry(platform_work_queue *Queue, platform_work_queue_callback *Callback, void *Data)
+{
+    // NOTE(felipe): Only one thread adds entries.
+    uint32 NewNextEntryToWrite = (Queue->NextEntryToWrite + 1) % WORK_QUEUE_ENTRY_COUNT;
+    Assert(NewNextEntryToWrite != Queue->NextEntryToRead);
+    
+    platform_work_queue_entry *Entry = Queue->Entries + Queue->NextEntryToWrite;
+    Entry->Callback = Callback;
+    Entry->Data = Data;
+    ++Queue->CompletionGoal;
+    
+    __sync_synchronize();
+    
+    Queue->NextEntryToWrite = NewNextEntryToWrite;
+    sem_post(&Queue->Semaphore);
+}
+
+internal void
+LinuxCompleteAllWork(platform_work_queue *Queue)
+{
+    while(Queue->CompletionGoal != Queue->CompletionCount)
+    {
+        LinuxDoNextWorkQueueEntry(Queue);
+    }
+    
+    __sync_synchronize();
+    
+    Queue->CompletionGoal = 0;
+    Queue->CompletionCount = 0;
+}
+
+internal uint32
+LinuxGetProcessorCount(void)
+{
+    long Count = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32 Result = (Count > 0) ? (uint32)Count : 1;
+    
+    return Result;
+}
+
+#include "corsac.c"
+
+int
+main(int ArgumentCount, char **ArgumentVector)
+{
+    GlobalUseColor = isatty(STDERR_FILENO) && isatty(STDOUT_FILENO);
+    
+    // NOTE(felipe): Errors exit with 1 from where they are found, make and
+    // build scripts go by the status.
+    int Result = CorsacMain(ArgumentCount, ArgumentVector);
+    
+    // NOTE(felipe): The output of -E is the preprocessed text alone.
+    if(!Result && !GlobalOptions.Preprocess)
+    {
+        LinuxSetColor(stdout, LINUX_COLOR_GREEN);
+        fprintf(stdout, "\nsuccess\n");
+        LinuxSetColor(stdout, LINUX_COLOR_DEFAULT);
+    }
+    
+    return Result;
+}
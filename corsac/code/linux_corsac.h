@@ -0,0 +1,77 @@
+#if !defined(LINUX_CORSAC_H)
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Felipe Carlin $
+   $Notice: Copyright  2022 Felipe Carlin $
+   ======================================================================== */
+
+typedef struct platform_work_queue_entry
+{
+    platform_work_queue_callback *Callback;
+    void *Data;
+} platform_work_queue_entry;
+
+#define WORK_QUEUE_ENTRY_COUNT 256
+
+typedef struct platform_work_queue
+{
+    uint32 volatile CompletionGoal;
+    uint32 volatile CompletionCount;
+    
+    uint32 volatile NextEntryToWrite;
+    uint32 volatile NextEntryToRead;
+    
+    sem_t Semaphore;
+    bool32 volatile Quit;
+    
+    uint32 WorkerCount;
+    pthread_t Workers[MAX_THREAD_COUNT];
+    
+    platform_work_queue_entry Entries[WORK_QUEUE_ENTRY_COUNT];
+} platform_work_queue;
+
+internal void Error(char *Format, ...);
+internal void ErrorAt(source_location Location, char *Format, ...);
+internal void ErrorInToken(token_buffer *Tokens, token_index Token, char *Format, ...);
+internal void Warning(char *Format, ...);
+internal void WarningAt(source_location Location, char *Format, ...);
+internal void WarningInToken(token_buffer *Tokens, token_index Token, char *Format, ...);
+
+internal loaded_file LinuxReadEntireFile(char *Filename);
+internal bool32 LinuxWriteEntireFile(char *Filename, void *Memory, memory_index MemorySize);
+internal bool32 LinuxWriteStandardOutput(void *Memory, memory_index MemorySize);
+internal bool32 LinuxListDirectory(char *Path, platform_directory_entry_callback *Callback, void *Data);
+internal bool32 LinuxGetCanonicalPath(char *Path, char *Buffer, uint32 BufferSize);
+internal void *LinuxReserveMemory(memory_index Size);
+internal bool32 LinuxCommitMemory(void *Memory, memory_index Size);
+internal void LinuxReleaseMemory(void *Memory, memory_index Size);
+internal uint32 LinuxGetTime(void);
+internal uint64 LinuxGetWallClock(void);
+internal real64 LinuxGetSecondsElapsed(uint64 Start, uint64 End);
+internal platform_work_queue *LinuxCreateWorkQueue(uint32 ThreadCount);
+internal void LinuxDestroyWorkQueue(platform_work_queue *Queue);
+internal void LinuxAddWorkEntry(platform_work_queue *Queue, platform_work_queue_callback *Callback, void *Data);
+internal void LinuxCompleteAllWork(platform_work_queue *Queue);
+internal uint32 LinuxGetProcessorCount(void);
+
+#define PlatformReadEntireFile LinuxReadEntireFile
+#define PlatformWriteEntireFile LinuxWriteEntireFile
+#define PlatformGetCanonicalPath LinuxGetCanonicalPath
+#define PlatformListDirectory LinuxListDirectory
+#define PlatformWriteStandardOutput LinuxWriteStandardOutput
+#define PlatformReserveMemory LinuxReserveMemory
+#define PlatformCommitMemory LinuxCommitMemory
+#define PlatformReleaseMemory LinuxReleaseMemory
+#define PlatformGetTime LinuxGetTime
+#define PlatformGetWallClock LinuxGetWallClock
+#define PlatformGetSecondsElapsed LinuxGetSecondsElapsed
+#define PlatformCreateWorkQueue LinuxCreateWorkQueue
+#define PlatformDestroyWorkQueue LinuxDestroyWorkQueue
+#define PlatformAddWorkEntry LinuxAddWorkEntry
+#define PlatformCompleteAllWork LinuxCompleteAllWork
+#define PlatformGetProcessorCount LinuxGetProcessorCount
+
+#define LINUX_CORSAC_H
+#endif
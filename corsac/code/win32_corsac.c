@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include <windows.h>
 
@@ -18,6 +19,7 @@
 // TODO(felipe): Remove globals
 global_variable HANDLE GlobalConsole;
 global_variable uint16 GlobalDefaultConsoleAttribute;
+global_variable int64 GlobalPerfCountFrequency;
 
 internal void
 Error(char *Format, ...)
@@ -36,48 +38,44 @@ Error(char *Format, ...)
 }
 
 internal void
-ErrorInToken(token *Token, char *Format, ...)
+Win32PrintDiagnostic(char *Label, uint16 Color, source_location Location, char *Format, va_list AP)
 {
-    va_list AP;
-    va_start(AP, Format);
-    
-    char *Line = Token->Location;
-    char *End = Token->Location;
+    source_position Position = GetSourcePosition(Location);
     
-    if(Token->TokenType != TokenType_EOF)
-    {
-        while(Token->SourceFile->Memory < Line && Line[-1] != '\n' && Line[-1] != '\r')
-        {
-            --Line;
-        }
-        
-        while(*End && *End != '\n' && *End != '\r')
-        {
-            ++End;
-        }
-    }
-    else
-    {
-        Line = (uint8 *)Token->SourceFile->Memory + Token->SourceFile->Size - 1;
-        while(*Line && Line > Token->SourceFile->Memory && *Line != '\n' && *Line != '\r')
-        {
-            --Line;
-        }
-        
-        End = (uint8 *)Token->SourceFile->Memory + Token->SourceFile->Size;
-    }
-    
-    SetConsoleTextAttribute(GlobalConsole, 12); // NOTE(felipe): Reddish
-    uint32 Indent = fprintf(stderr, "error: ");
+    SetConsoleTextAttribute(GlobalConsole, Color);
+    uint32 Indent = fprintf(stderr, "%s: ", Label);
     SetConsoleTextAttribute(GlobalConsole, GlobalDefaultConsoleAttribute);
     
-    Indent += fprintf(stderr, "%s: ", Token->SourceFile->Filename);
+    Indent += fprintf(stderr, "%s:%u:%u: ", Position.File->Filename, Position.Line, Position.Column);
     
-    int32 Position = (uint32)((Token->Location ? Token->Location - Line : End - Line) + Indent);
-    fprintf(stderr, "%.*s\n%*s^ ", (int32)(End - Line), Line, Position, "");
+    // NOTE(felipe): The caret goes under the column, a column past the end
+    // of the line is the newline or EOF.
+    fprintf(stderr, "%.*s\n%*s^ ", (int32)Position.LineLength, Position.LineStart,
+            (int32)(Indent + Position.Column - 1), "");
     
     vfprintf(stderr, Format, AP);
     fprintf(stderr, "\n");
+}
+
+internal void
+ErrorAt(source_location Location, char *Format, ...)
+{
+    va_list AP;
+    va_start(AP, Format);
+    
+    Win32PrintDiagnostic("error", 12, Location, Format, AP); // NOTE(felipe): Reddish
+    
+    va_end(AP);
+    exit(0);
+}
+
+internal void
+ErrorInToken(token_buffer *Tokens, token_index Token, char *Format, ...)
+{
+    va_list AP;
+    va_start(AP, Format);
+    
+    Win32PrintDiagnostic("error", 12, GetTokenLocation(Tokens, Token), Format, AP); // NOTE(felipe): Reddish
     
     va_end(AP);
     exit(0);
@@ -99,33 +97,23 @@ Warning(char *Format, ...)
 }
 
 internal void
-WarningInToken(token *Token, char *Format, ...)
+WarningAt(source_location Location, char *Format, ...)
 {
     va_list AP;
     va_start(AP, Format);
     
-    char *Line = Token->Location;
-    while(Token->SourceFile->Memory < Line && Line[-1] != '\n' && Line[-1] != '\r')
-    {
-        --Line;
-    }
-    char *End = Token->Location;
-    while(*End && *End != '\n' && *End != '\r')
-    {
-        ++End;
-    }
-    
-    SetConsoleTextAttribute(GlobalConsole, 6); // NOTE(felipe): Yellowish
-    uint32 Indent = fprintf(stderr, "warning: ");
-    SetConsoleTextAttribute(GlobalConsole, GlobalDefaultConsoleAttribute);
-    
-    Indent += fprintf(stderr, "%s: ", Token->SourceFile->Filename);
+    Win32PrintDiagnostic("warning", 6, Location, Format, AP); // NOTE(felipe): Yellowish
     
-    int32 Position = (uint32)(Token->Location - Line + Indent);
-    fprintf(stderr, "%.*s\n%*s^ ", (int32)(End - Line), Line, Position, "");
+    va_end(AP);
+}
+
+internal void
+WarningInToken(token_buffer *Tokens, token_index Token, char *Format, ...)
+{
+    va_list AP;
+    va_start(AP, Format);
     
-    vfprintf(stderr, Format, AP);
-    fprintf(stderr, "\n");
+    Win32PrintDiagnostic("warning", 6, GetTokenLocation(Tokens, Token), Format, AP); // NOTE(felipe): Yellowish
     
     va_end(AP);
 }
@@ -141,6 +129,21 @@ Win32GetTime()
     return Result;
 }
 
+internal uint64
+Win32GetWallClock(void)
+{
+    LARGE_INTEGER Result;
+    QueryPerformanceCounter(&Result);
+    return (uint64)Result.QuadPart;
+}
+
+internal real64
+Win32GetSecondsElapsed(uint64 Start, uint64 End)
+{
+    real64 Result = (real64)(End - Start) / (real64)GlobalPerfCountFrequency;
+    return Result;
+}
+
 internal loaded_file
 Win32ReadEntireFile(char *Filename)
 {
@@ -155,7 +158,10 @@ Win32ReadEntireFile(char *Filename)
         if(GetFileSizeEx(FileHandle, &FileSize))
         {
             uint32 FileSize32 = SafeTruncateUInt64(FileSize.QuadPart);
-            Result.Memory = VirtualAlloc(0, FileSize32, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+            
+            // NOTE(felipe): One extra byte so the tokenizer always finds a
+            // NUL terminator, VirtualAlloc returns zeroed memory.
+            Result.Memory = VirtualAlloc(0, FileSize32 + 1, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
             if(Result.Memory)
             {
                 DWORD BytesRead;
@@ -180,6 +186,53 @@ Win32ReadEntireFile(char *Filename)
     return Result;
 }
 
+internal bool32
+Win32GetCanonicalPath(char *Path, char *Buffer, uint32 BufferSize)
+{
+    // NOTE(felipe): Absolute, with no "." or "..", so every path to the same
+    // existing file gives the same string. Case and links are not folded.
+    bool32 Result = false;
+    
+    DWORD Length = GetFullPathNameA(Path, BufferSize, Buffer, 0);
+    if(Length && (Length < BufferSize))
+    {
+        Result = (GetFileAttributesA(Buffer) != INVALID_FILE_ATTRIBUTES);
+    }
+    
+    return Result;
+}
+
+internal bool32
+Win32ListDirectory(char *Path, platform_directory_entry_callback *Callback, void *Data)
+{
+    bool32 Result = false;
+    
+    uint32 Length = StringLength(Path);
+    char Pattern[MAX_PATH_LENGTH];
+    if(Length + 3 <= sizeof(Pattern))
+    {
+        MemCopy(Pattern, Path, Length);
+        Pattern[Length] = '\\';
+        Pattern[Length + 1] = '*';
+        Pattern[Length + 2] = 0;
+        
+        WIN32_FIND_DATAA FindData;
+        HANDLE FindHandle = FindFirstFileA(Pattern, &FindData);
+        if(FindHandle != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                Callback(Data, FindData.cFileName);
+            } while(FindNextFileA(FindHandle, &FindData));
+            
+            FindClose(FindHandle);
+            Result = true;
+        }
+    }
+    
+    return Result;
+}
+
 internal bool32
 Win32WriteEntireFile(char *Filename, void *Memory, memory_index MemorySize)
 {
@@ -210,33 +263,174 @@ Win32WriteEntireFile(char *Filename, void *Memory, memory_index MemorySize)
     return Result;
 }
 
-typedef struct memory_arena
+internal bool32
+Win32WriteStandardOutput(void *Memory, memory_index MemorySize)
 {
-    void *Memory;
-    memory_index Size;
-    memory_index Used;
-} memory_arena;
-#define PushStruct(Arena, Type) (Type*)PushSize_(Arena, sizeof(Type))
-#define PushArray(Arena, Count, Type) (Type*)PushSize_(Arena, (Count)*sizeof(Type))
-#define PushSize(Arena, Size) PushSize_(Arena, Size)
-inline void* PushSize_(memory_arena* Arena, memory_index Size)
+    // NOTE(felipe): Whatever printf still holds goes out first.
+    fflush(stdout);
+    
+    DWORD BytesWritten = 0;
+    bool32 Result = (WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), Memory, (DWORD)MemorySize, &BytesWritten, 0) &&
+                     (BytesWritten == MemorySize));
+    return Result;
+}
+
+internal void *
+Win32ReserveMemory(memory_index Size)
 {
-    Assert((Arena->Used + Size) <= Arena->Size);
-    void *Result = (uint8 *)Arena->Memory + Arena->Used;
-    Arena->Used += Size;
+    void *Result = VirtualAlloc(0, Size, MEM_RESERVE, PAGE_NOACCESS);
     return Result;
 }
 
-internal memory_arena
-Win32AllocateArena(memory_index Size)
+internal bool32
+Win32CommitMemory(void *Memory, memory_index Size)
 {
-    memory_arena Arena = {0};
+    bool32 Result = (VirtualAlloc(Memory, Size, MEM_COMMIT, PAGE_READWRITE) != 0);
+    return Result;
+}
+
+internal void
+Win32ReleaseMemory(void *Memory, memory_index Size)
+{
+    VirtualFree(Memory, 0, MEM_RELEASE);
+}
+
+//
+// NOTE(felipe): Work queue
+//
+
+internal bool32
+Win32DoNextWorkQueueEntry(platform_work_queue *Queue)
+{
+    bool32 ShouldSleep = false;
     
-    Arena.Memory = VirtualAlloc(0, Size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-    Arena.Size = Size;
-    Arena.Used = 0;
+    uint32 OriginalNextEntryToRead = Queue->NextEntryToRead;
+    uint32 NewNextEntryToRead = (OriginalNextEntryToRead + 1) % WORK_QUEUE_ENTRY_COUNT;
+    if(OriginalNextEntryToRead != Queue->NextEntryToWrite)
+    {
+        uint32 Index = InterlockedCompareExchange((LONG volatile *)&Queue->NextEntryToRead,
+                                                  NewNextEntryToRead,
+                                                  OriginalNextEntryToRead);
+        if(Index == OriginalNextEntryToRead)
+        {
+            platform_work_queue_entry Entry = Queue->Entries[Index];
+            Entry.Callback(Queue, Entry.Data);
+            InterlockedIncrement((LONG volatile *)&Queue->CompletionCount);
+        }
+    }
+    else
+    {
+        ShouldSleep = true;
+    }
+    
+    return ShouldSleep;
+}
+
+internal DWORD WINAPI
+Win32WorkerThreadProc(LPVOID Parameter)
+{
+    platform_work_queue *Queue = (platform_work_queue *)Parameter;
+    
+    while(!Queue->Quit)
+    {
+        if(Win32DoNextWorkQueueEntry(Queue) && !Queue->Quit)
+        {
+            WaitForSingleObjectEx(Queue->Semaphore, INFINITE, FALSE);
+        }
+    }
     
-    return Arena;
+    return 0;
+}
+
+internal platform_work_queue *
+Win32CreateWorkQueue(uint32 ThreadCount)
+{
+    Assert((ThreadCount > 0) && (ThreadCount <= MAX_THREAD_COUNT));
+    
+    platform_work_queue *Queue = (platform_work_queue *)VirtualAlloc(0, sizeof(platform_work_queue),
+                                                                     MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    if(!Queue)
+    {
+        Error("out of memory");
+    }
+    
+    Queue->Semaphore = CreateSemaphoreEx(0, 0, MAX_THREAD_COUNT, 0, 0, SEMAPHORE_ALL_ACCESS);
+    
+    // NOTE(felipe): The thread that completes the work is one of the
+    // threads, only the rest are workers.
+    for(uint32 WorkerIndex = 0;
+        WorkerIndex < ThreadCount - 1;
+        ++WorkerIndex)
+    {
+        Queue->Workers[WorkerIndex] = CreateThread(0, 0, Win32WorkerThreadProc, Queue, 0, 0);
+        if(!Queue->Workers[WorkerIndex])
+        {
+            Error("could not create worker thread");
+        }
+        ++Queue->WorkerCount;
+    }
+    
+    return Queue;
+}
+
+internal void
+Win32DestroyWorkQueue(platform_work_queue *Queue)
+{
+    Queue->Quit = true;
+    MemoryBarrier();
+    
+    ReleaseSemaphore(Queue->Semaphore, Queue->WorkerCount, 0);
+    WaitForMultipleObjects(Queue->WorkerCount, Queue->Workers, TRUE, INFINITE);
+    
+    for(uint32 WorkerIndex = 0;
+        WorkerIndex < Queue->WorkerCount;
+        ++WorkerIndex)
+    {
+        CloseHandle(Queue->Workers[WorkerIndex]);
+    }
+    
+    CloseHandle(Queue->Semaphore);
+    VirtualFree(Queue, 0, MEM_RELEASE);
+}
+
+internal void
+Win32AddWorkEntry(platform_work_queue *Queue, platform_work_queue_callback *Callback, void *Data)
+{
+    // NOTE(felipe): Only one thread adds entries.
+    uint32 NewNextEntryToWrite = (Queue->NextEntryToWrite + 1) % WORK_QUEUE_ENTRY_COUNT;
+    Assert(NewNextEntryToWrite != Queue->NextEntryToRead);
+    
+    platform_work_queue_entry *Entry = Queue->Entries + Queue->NextEntryToWrite;
+    Entry->Callback = Callback;
+    Entry->Data = Data;
+    ++Queue->CompletionGoal;
+    
+    MemoryBarrier();
+    
+    Queue->NextEntryToWrite = NewNextEntryToWrite;
+    ReleaseSemaphore(Queue->Semaphore, 1, 0);
+}
+
+internal void
+Win32CompleteAllWork(platform_work_queue *Queue)
+{
+    while(Queue->CompletionGoal != Queue->CompletionCount)
+    {
+        Win32DoNextWorkQueueEntry(Queue);
+    }
+    
+    Queue->CompletionGoal = 0;
+    Queue->CompletionCount = 0;
+}
+
+internal uint32
+Win32GetProcessorCount(void)
+{
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+    
+    uint32 Result = SystemInfo.dwNumberOfProcessors;
+    return Result;
 }
 
 #include "corsac.c"
@@ -244,18 +438,24 @@ Win32AllocateArena(memory_index Size)
 internal int
 main(int ArgumentCount, char **ArgumentVector)
 {
-    char *InputFilename = ArgumentVector[1];
-    
     GlobalConsole = GetStdHandle(STD_OUTPUT_HANDLE);
     CONSOLE_SCREEN_BUFFER_INFO ConsoleInfo = {0};
     GetConsoleScreenBufferInfo(GlobalConsole, &ConsoleInfo);
     GlobalDefaultConsoleAttribute = ConsoleInfo.wAttributes;
     
-    CorsacMain(InputFilename);
+    LARGE_INTEGER PerfCountFrequencyResult;
+    QueryPerformanceFrequency(&PerfCountFrequencyResult);
+    GlobalPerfCountFrequency = PerfCountFrequencyResult.QuadPart;
     
-    SetConsoleTextAttribute(GlobalConsole, 2); // NOTE(felipe): Cyan
-    fprintf(stdout, "\nsuccess\n");
-    SetConsoleTextAttribute(GlobalConsole, GlobalDefaultConsoleAttribute);
+    CorsacMain(ArgumentCount, ArgumentVector);
+    
+    // NOTE(felipe): The output of -E is the preprocessed text alone.
+    if(!GlobalOptions.Preprocess)
+    {
+        SetConsoleTextAttribute(GlobalConsole, 2); // NOTE(felipe): Cyan
+        fprintf(stdout, "\nsuccess\n");
+        SetConsoleTextAttribute(GlobalConsole, GlobalDefaultConsoleAttribute);
+    }
     
     return 0;
 }
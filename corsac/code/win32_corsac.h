@@ -7,12 +7,71 @@
    $Notice: Copyright  2022 Felipe Carlin $
    ======================================================================== */
 
+typedef struct platform_work_queue_entry
+{
+    platform_work_queue_callback *Callback;
+    void *Data;
+} platform_work_queue_entry;
+
+#define WORK_QUEUE_ENTRY_COUNT 256
+
+typedef struct platform_work_queue
+{
+    uint32 volatile CompletionGoal;
+    uint32 volatile CompletionCount;
+    
+    uint32 volatile NextEntryToWrite;
+    uint32 volatile NextEntryToRead;
+    
+    HANDLE Semaphore;
+    bool32 volatile Quit;
+    
+    uint32 WorkerCount;
+    HANDLE Workers[MAX_THREAD_COUNT];
+    
+    platform_work_queue_entry Entries[WORK_QUEUE_ENTRY_COUNT];
+} platform_work_queue;
+
 internal void Error(char *Format, ...);
-internal void ErrorInToken(token *Token, char *Format, ...);
+internal void ErrorAt(source_location Location, char *Format, ...);
+internal void ErrorInToken(token_buffer *Tokens, token_index Token, char *Format, ...);
 internal void Warning(char *Format, ...);
-internal void WarningInToken(token *Token, char *Format, ...);
+internal void WarningAt(source_location Location, char *Format, ...);
+internal void WarningInToken(token_buffer *Tokens, token_index Token, char *Format, ...);
 
 internal loaded_file Win32ReadEntireFile(char *Filename);
+internal bool32 Win32WriteEntireFile(char *Filename, void *Memory, memory_index MemorySize);
+internal bool32 Win32WriteStandardOutput(void *Memory, memory_index MemorySize);
+internal bool32 Win32ListDirectory(char *Path, platform_directory_entry_callback *Callback, void *Data);
+internal bool32 Win32GetCanonicalPath(char *Path, char *Buffer, uint32 BufferSize);
+internal void *Win32ReserveMemory(memory_index Size);
+internal bool32 Win32CommitMemory(void *Memory, memory_index Size);
+internal void Win32ReleaseMemory(void *Memory, memory_index Size);
+internal uint32 Win32GetTime(void);
+internal uint64 Win32GetWallClock(void);
+internal real64 Win32GetSecondsElapsed(uint64 Start, uint64 End);
+internal platform_work_queue *Win32CreateWorkQueue(uint32 ThreadCount);
+internal void Win32DestroyWorkQueue(platform_work_queue *Queue);
+internal void Win32AddWorkEntry(platform_work_queue *Queue, platform_work_queue_callback *Callback, void *Data);
+internal void Win32CompleteAllWork(platform_work_queue *Queue);
+internal uint32 Win32GetProcessorCount(void);
+
+#define PlatformReadEntireFile Win32ReadEntireFile
+#define PlatformWriteEntireFile Win32WriteEntireFile
+#define PlatformGetCanonicalPath Win32GetCanonicalPath
+#define PlatformListDirectory Win32ListDirectory
+#define PlatformWriteStandardOutput Win32WriteStandardOutput
+#define PlatformReserveMemory Win32ReserveMemory
+#define PlatformCommitMemory Win32CommitMemory
+#define PlatformReleaseMemory Win32ReleaseMemory
+#define PlatformGetTime Win32GetTime
+#define PlatformGetWallClock Win32GetWallClock
+#define PlatformGetSecondsElapsed Win32GetSecondsElapsed
+#define PlatformCreateWorkQueue Win32CreateWorkQueue
+#define PlatformDestroyWorkQueue Win32DestroyWorkQueue
+#define PlatformAddWorkEntry Win32AddWorkEntry
+#define PlatformCompleteAllWork Win32CompleteAllWork
+#define PlatformGetProcessorCount Win32GetProcessorCount
 
 #define WIN32_CORSAC_H
 #endif
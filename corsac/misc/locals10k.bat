@@ -0,0 +1,18 @@
+@echo off
+@setlocal EnableDelayedExpansion
+
+:: Writes the input the parser was timed on for scopes: a function that
+:: assigns 10000 locals and then adds them all up. Use it as
+::     locals10k.bat > locals10k.c
+::     corsac locals10k.c -parse-bench
+
+echo main()
+echo {
+for /L %%i in (0,1,9999) do (
+    set /a value=%%i %% 100
+    echo     v%%i = !value!;
+)
+echo     s = 0;
+for /L %%i in (0,1,9999) do echo     s = s + v%%i;
+echo     return s;
+echo }